@@ -3,7 +3,7 @@
 
 ccl::ShaderGraph* create_shader_graph(std::string encoded_graph)
 {
-	CyclesNodeGraph input_graph(encoded_graph);
+	CyclesNodeGraph input_graph(encoded_graph, OutputParamLayout::Flat);
 
 	std::map<std::string, ccl::ShaderNode*> nodes_by_name;
 
@@ -48,8 +48,8 @@ ccl::ShaderNode* convert_node(OutputNode& node)
 	{
 		ccl::AnisotropicBsdfNode* aniso_node = new ccl::AnisotropicBsdfNode();
 		cycles_node = aniso_node;
-		if (node.string_values.count("distribution") == 1) {
-			std::string dist = node.string_values["distribution"];
+		if (const std::string* const distribution_value = node.params.find_string("distribution")) {
+			std::string dist = *distribution_value;
 			if (dist == "ashikhmin_shirley") {
 				aniso_node->distribution = ccl::ClosureType::CLOSURE_BSDF_ASHIKHMIN_SHIRLEY_ANISO_ID;
 			}
@@ -63,17 +63,17 @@ ccl::ShaderNode* convert_node(OutputNode& node)
 				aniso_node->distribution = ccl::ClosureType::CLOSURE_BSDF_MICROFACET_GGX_ANISO_ID;
 			}
 		}
-		if (node.float3_values.count("color") == 1) {
-			aniso_node->color = float3_to_ccl_float3(node.float3_values["color"]);
+		if (const Float3* const color_value = node.params.find_float3("color")) {
+			aniso_node->color = float3_to_ccl_float3(*color_value);
 		}
-		if (node.float_values.count("roughness") == 1) {
-			aniso_node->roughness = node.float_values["roughness"];
+		if (const float* const roughness_value = node.params.find_float("roughness")) {
+			aniso_node->roughness = *roughness_value;
 		}
-		if (node.float_values.count("anisotropy") == 1) {
-			aniso_node->anisotropy = node.float_values["anisotropy"];
+		if (const float* const anisotropy_value = node.params.find_float("anisotropy")) {
+			aniso_node->anisotropy = *anisotropy_value;
 		}
-		if (node.float_values.count("rotation") == 1) {
-			aniso_node->rotation = node.float_values["rotation"];
+		if (const float* const rotation_value = node.params.find_float("rotation")) {
+			aniso_node->rotation = *rotation_value;
 		}
 		break;
 	}
@@ -81,14 +81,14 @@ ccl::ShaderNode* convert_node(OutputNode& node)
 	{
 		ccl::CheckerTextureNode* tex_node = new ccl::CheckerTextureNode();
 		cycles_node = tex_node;
-		if (node.float3_values.count("color1") == 1) {
-			tex_node->color1 = float3_to_ccl_float3(node.float3_values["color1"]);
+		if (const Float3* const color1_value = node.params.find_float3("color1")) {
+			tex_node->color1 = float3_to_ccl_float3(*color1_value);
 		}
-		if (node.float3_values.count("color2") == 1) {
-			tex_node->color2 = float3_to_ccl_float3(node.float3_values["color2"]);
+		if (const Float3* const color2_value = node.params.find_float3("color2")) {
+			tex_node->color2 = float3_to_ccl_float3(*color2_value);
 		}
-		if (node.float_values.count("scale") == 1) {
-			tex_node->scale = node.float_values["scale"];
+		if (const float* const scale_value = node.params.find_float("scale")) {
+			tex_node->scale = *scale_value;
 		}
 		break;
 	}
@@ -96,11 +96,11 @@ ccl::ShaderNode* convert_node(OutputNode& node)
 	{
 		ccl::DiffuseBsdfNode* diffuse_node = new ccl::DiffuseBsdfNode();
 		cycles_node = diffuse_node;
-		if (node.float3_values.count("color") == 1) {
-			diffuse_node->color = float3_to_ccl_float3(node.float3_values["color"]);
+		if (const Float3* const color_value = node.params.find_float3("color")) {
+			diffuse_node->color = float3_to_ccl_float3(*color_value);
 		}
-		if (node.float_values.count("roughness") == 1) {
-			diffuse_node->roughness = node.float_values["roughness"];
+		if (const float* const roughness_value = node.params.find_float("roughness")) {
+			diffuse_node->roughness = *roughness_value;
 		}
 		break;
 	}
@@ -108,11 +108,11 @@ ccl::ShaderNode* convert_node(OutputNode& node)
 	{
 		ccl::EmissionNode* emission_node = new ccl::EmissionNode();
 		cycles_node = emission_node;
-		if (node.float3_values.count("color") == 1) {
-			emission_node->color = float3_to_ccl_float3(node.float3_values["color"]);
+		if (const Float3* const color_value = node.params.find_float3("color")) {
+			emission_node->color = float3_to_ccl_float3(*color_value);
 		}
-		if (node.float_values.count("strength") == 1) {
-			emission_node->strength = node.float_values["strength"];
+		if (const float* const strength_value = node.params.find_float("strength")) {
+			emission_node->strength = *strength_value;
 		}
 		break;
 	}
@@ -120,11 +120,11 @@ ccl::ShaderNode* convert_node(OutputNode& node)
 	{
 		ccl::GlassBsdfNode* glass_node = new ccl::GlassBsdfNode();
 		cycles_node = glass_node;
-		if (node.float3_values.count("color") == 1) {
-			glass_node->color = float3_to_ccl_float3(node.float3_values["color"]);
+		if (const Float3* const color_value = node.params.find_float3("color")) {
+			glass_node->color = float3_to_ccl_float3(*color_value);
 		}
-		if (node.string_values.count("distribution") == 1) {
-			std::string dist = node.string_values["distribution"];
+		if (const std::string* const distribution_value = node.params.find_string("distribution")) {
+			std::string dist = *distribution_value;
 			if (dist == "beckmann") {
 				glass_node->distribution = ccl::ClosureType::CLOSURE_BSDF_MICROFACET_BECKMANN_GLASS_ID;
 			}
@@ -138,11 +138,11 @@ ccl::ShaderNode* convert_node(OutputNode& node)
 				glass_node->distribution = ccl::ClosureType::CLOSURE_BSDF_REFLECTION_ID;
 			}
 		}
-		if (node.float_values.count("roughness") == 1) {
-			glass_node->roughness = node.float_values["roughness"];
+		if (const float* const roughness_value = node.params.find_float("roughness")) {
+			glass_node->roughness = *roughness_value;
 		}
-		if (node.float_values.count("IOR") == 1) {
-			glass_node->IOR = node.float_values["IOR"];
+		if (const float* const IOR_value = node.params.find_float("IOR")) {
+			glass_node->IOR = *IOR_value;
 		}
 		break;
 	}
@@ -150,11 +150,11 @@ ccl::ShaderNode* convert_node(OutputNode& node)
 	{
 		ccl::GlossyBsdfNode* glossy_node = new ccl::GlossyBsdfNode();
 		cycles_node = glossy_node;
-		if (node.float3_values.count("color") == 1) {
-			glossy_node->color = float3_to_ccl_float3(node.float3_values["color"]);
+		if (const Float3* const color_value = node.params.find_float3("color")) {
+			glossy_node->color = float3_to_ccl_float3(*color_value);
 		}
-		if (node.string_values.count("distribution") == 1) {
-			std::string dist = node.string_values["distribution"];
+		if (const std::string* const distribution_value = node.params.find_string("distribution")) {
+			std::string dist = *distribution_value;
 			if (dist == "ashikhmin_shirley") {
 				glossy_node->distribution = ccl::ClosureType::CLOSURE_BSDF_ASHIKHMIN_SHIRLEY_ID;
 			}
@@ -171,8 +171,8 @@ ccl::ShaderNode* convert_node(OutputNode& node)
 				glossy_node->distribution = ccl::ClosureType::CLOSURE_BSDF_REFLECTION_ID;
 			}
 		}
-		if (node.float_values.count("roughness") == 1) {
-			glossy_node->roughness = node.float_values["roughness"];
+		if (const float* const roughness_value = node.params.find_float("roughness")) {
+			glossy_node->roughness = *roughness_value;
 		}
 		break;
 	}
@@ -180,8 +180,8 @@ ccl::ShaderNode* convert_node(OutputNode& node)
 	{
 		ccl::GradientTextureNode* grad_node = new ccl::GradientTextureNode();
 		cycles_node = grad_node;
-		if (node.string_values.count("type") == 1) {
-			std::string type = node.string_values["type"];
+		if (const std::string* const type_value = node.params.find_string("type")) {
+			std::string type = *type_value;
 			if (type == "linear") {
 				grad_node->type = ccl::NodeGradientType::NODE_BLEND_LINEAR;
 			}
@@ -210,8 +210,8 @@ ccl::ShaderNode* convert_node(OutputNode& node)
 	{
 		ccl::HairBsdfNode* hair_node = new ccl::HairBsdfNode();
 		cycles_node = hair_node;
-		if (node.string_values.count("component") == 1) {
-			std::string comp = node.string_values["component"];
+		if (const std::string* const component_value = node.params.find_string("component")) {
+			std::string comp = *component_value;
 			if (comp == "transmission") {
 				hair_node->component = ccl::ClosureType::CLOSURE_BSDF_HAIR_TRANSMISSION_ID;
 			}
@@ -219,17 +219,17 @@ ccl::ShaderNode* convert_node(OutputNode& node)
 				hair_node->component = ccl::ClosureType::CLOSURE_BSDF_HAIR_REFLECTION_ID;
 			}
 		}
-		if (node.float3_values.count("color") == 1) {
-			hair_node->color = float3_to_ccl_float3(node.float3_values["color"]);
+		if (const Float3* const color_value = node.params.find_float3("color")) {
+			hair_node->color = float3_to_ccl_float3(*color_value);
 		}
-		if (node.float_values.count("offset") == 1) {
-			hair_node->offset = node.float_values["offset"];
+		if (const float* const offset_value = node.params.find_float("offset")) {
+			hair_node->offset = *offset_value;
 		}
-		if (node.float_values.count("roughness_u") == 1) {
-			hair_node->roughness_u = node.float_values["roughness_u"];
+		if (const float* const roughness_u_value = node.params.find_float("roughness_u")) {
+			hair_node->roughness_u = *roughness_u_value;
 		}
-		if (node.float_values.count("roughness_v") == 1) {
-			hair_node->roughness_v = node.float_values["roughness_v"];
+		if (const float* const roughness_v_value = node.params.find_float("roughness_v")) {
+			hair_node->roughness_v = *roughness_v_value;
 		}
 		break;
 	}
@@ -242,14 +242,14 @@ ccl::ShaderNode* convert_node(OutputNode& node)
 	{
 		ccl::MagicTextureNode* magic_node = new ccl::MagicTextureNode();
 		cycles_node = magic_node;
-		if (node.int_values.count("depth") == 1) {
-			magic_node->depth = node.int_values["depth"];
+		if (const int* const depth_value = node.params.find_int("depth")) {
+			magic_node->depth = *depth_value;
 		}
-		if (node.float_values.count("scale") == 1) {
-			magic_node->scale = node.float_values["scale"];
+		if (const float* const scale_value = node.params.find_float("scale")) {
+			magic_node->scale = *scale_value;
 		}
-		if (node.float_values.count("distortion") == 1) {
-			magic_node->distortion = node.float_values["distortion"];
+		if (const float* const distortion_value = node.params.find_float("distortion")) {
+			magic_node->distortion = *distortion_value;
 		}
 		break;
 	}
@@ -257,8 +257,8 @@ ccl::ShaderNode* convert_node(OutputNode& node)
 	{
 		ccl::MixClosureNode* mix_node = new ccl::MixClosureNode();
 		cycles_node = mix_node;
-		if (node.float_values.count("fac") == 1) {
-			mix_node->fac = node.float_values["fac"];
+		if (const float* const fac_value = node.params.find_float("fac")) {
+			mix_node->fac = *fac_value;
 		}
 		break;
 	}
@@ -266,8 +266,8 @@ ccl::ShaderNode* convert_node(OutputNode& node)
 	{
 		ccl::MusgraveTextureNode* musgrave_node = new ccl::MusgraveTextureNode();
 		cycles_node = musgrave_node;
-		if (node.string_values.count("type") == 1) {
-			std::string type = node.string_values["type"];
+		if (const std::string* const type_value = node.params.find_string("type")) {
+			std::string type = *type_value;
 			if (type == "fBM") {
 				musgrave_node->type = ccl::NodeMusgraveType::NODE_MUSGRAVE_FBM;
 			}
@@ -284,23 +284,23 @@ ccl::ShaderNode* convert_node(OutputNode& node)
 				musgrave_node->type = ccl::NodeMusgraveType::NODE_MUSGRAVE_RIDGED_MULTIFRACTAL;
 			}
 		}
-		if (node.float_values.count("scale") == 1) {
-			musgrave_node->scale = node.float_values["scale"];
+		if (const float* const scale_value = node.params.find_float("scale")) {
+			musgrave_node->scale = *scale_value;
 		}
-		if (node.float_values.count("detail") == 1) {
-			musgrave_node->detail = node.float_values["detail"];
+		if (const float* const detail_value = node.params.find_float("detail")) {
+			musgrave_node->detail = *detail_value;
 		}
-		if (node.float_values.count("dimension") == 1) {
-			musgrave_node->dimension = node.float_values["dimension"];
+		if (const float* const dimension_value = node.params.find_float("dimension")) {
+			musgrave_node->dimension = *dimension_value;
 		}
-		if (node.float_values.count("lacunarity") == 1) {
-			musgrave_node->lacunarity = node.float_values["lacunarity"];
+		if (const float* const lacunarity_value = node.params.find_float("lacunarity")) {
+			musgrave_node->lacunarity = *lacunarity_value;
 		}
-		if (node.float_values.count("offset") == 1) {
-			musgrave_node->offset = node.float_values["offset"];
+		if (const float* const offset_value = node.params.find_float("offset")) {
+			musgrave_node->offset = *offset_value;
 		}
-		if (node.float_values.count("gain") == 1) {
-			musgrave_node->gain = node.float_values["gain"];
+		if (const float* const gain_value = node.params.find_float("gain")) {
+			musgrave_node->gain = *gain_value;
 		}
 		break;
 	}
@@ -308,14 +308,14 @@ ccl::ShaderNode* convert_node(OutputNode& node)
 	{
 		ccl::NoiseTextureNode* noise_node = new ccl::NoiseTextureNode();
 		cycles_node = noise_node;
-		if (node.float_values.count("scale") == 1) {
-			noise_node->scale = node.float_values["scale"];
+		if (const float* const scale_value = node.params.find_float("scale")) {
+			noise_node->scale = *scale_value;
 		}
-		if (node.float_values.count("detail") == 1) {
-			noise_node->detail = node.float_values["detail"];
+		if (const float* const detail_value = node.params.find_float("detail")) {
+			noise_node->detail = *detail_value;
 		}
-		if (node.float_values.count("distortion") == 1) {
-			noise_node->distortion = node.float_values["distortion"];
+		if (const float* const distortion_value = node.params.find_float("distortion")) {
+			noise_node->distortion = *distortion_value;
 		}
 		break;
 	}
@@ -323,8 +323,8 @@ ccl::ShaderNode* convert_node(OutputNode& node)
 	{
 		ccl::PrincipledBsdfNode* principled_node = new ccl::PrincipledBsdfNode();
 		cycles_node = principled_node;
-		if (node.string_values.count("distribution") == 1) {
-			std::string dist = node.string_values["distribution"];
+		if (const std::string* const distribution_value = node.params.find_string("distribution")) {
+			std::string dist = *distribution_value;
 			if (dist == "ggx") {
 				principled_node->distribution = ccl::ClosureType::CLOSURE_BSDF_MICROFACET_GGX_GLASS_ID;
 			}
@@ -332,53 +332,53 @@ ccl::ShaderNode* convert_node(OutputNode& node)
 				principled_node->distribution = ccl::ClosureType::CLOSURE_BSDF_MICROFACET_MULTI_GGX_GLASS_ID;
 			}
 		}
-		if (node.float3_values.count("base_color") == 1) {
-			principled_node->base_color = float3_to_ccl_float3(node.float3_values["base_color"]);
+		if (const Float3* const base_color_value = node.params.find_float3("base_color")) {
+			principled_node->base_color = float3_to_ccl_float3(*base_color_value);
 		}
-		if (node.float_values.count("subsurface") == 1) {
-			principled_node->subsurface = node.float_values["subsurface"];
+		if (const float* const subsurface_value = node.params.find_float("subsurface")) {
+			principled_node->subsurface = *subsurface_value;
 		}
-		if (node.float3_values.count("subsurface_radius") == 1) {
-			principled_node->subsurface_radius = float3_to_ccl_float3(node.float3_values["subsurface_radius"]);
+		if (const Float3* const subsurface_radius_value = node.params.find_float3("subsurface_radius")) {
+			principled_node->subsurface_radius = float3_to_ccl_float3(*subsurface_radius_value);
 		}
-		if (node.float3_values.count("subsurface_color") == 1) {
-			principled_node->subsurface_color = float3_to_ccl_float3(node.float3_values["subsurface_color"]);
+		if (const Float3* const subsurface_color_value = node.params.find_float3("subsurface_color")) {
+			principled_node->subsurface_color = float3_to_ccl_float3(*subsurface_color_value);
 		}
-		if (node.float_values.count("metallic") == 1) {
-			principled_node->metallic = node.float_values["metallic"];
+		if (const float* const metallic_value = node.params.find_float("metallic")) {
+			principled_node->metallic = *metallic_value;
 		}
-		if (node.float_values.count("specular") == 1) {
-			principled_node->specular = node.float_values["specular"];
+		if (const float* const specular_value = node.params.find_float("specular")) {
+			principled_node->specular = *specular_value;
 		}
-		if (node.float_values.count("specular_tint") == 1) {
-			principled_node->specular_tint = node.float_values["specular_tint"];
+		if (const float* const specular_tint_value = node.params.find_float("specular_tint")) {
+			principled_node->specular_tint = *specular_tint_value;
 		}
-		if (node.float_values.count("roughness") == 1) {
-			principled_node->roughness = node.float_values["roughness"];
+		if (const float* const roughness_value = node.params.find_float("roughness")) {
+			principled_node->roughness = *roughness_value;
 		}
-		if (node.float_values.count("anisotropic") == 1) {
-			principled_node->anisotropic = node.float_values["anisotropic"];
+		if (const float* const anisotropic_value = node.params.find_float("anisotropic")) {
+			principled_node->anisotropic = *anisotropic_value;
 		}
-		if (node.float_values.count("anisotropic_rotation") == 1) {
-			principled_node->anisotropic_rotation = node.float_values["anisotropic_rotation"];
+		if (const float* const anisotropic_rotation_value = node.params.find_float("anisotropic_rotation")) {
+			principled_node->anisotropic_rotation = *anisotropic_rotation_value;
 		}
-		if (node.float_values.count("sheen") == 1) {
-			principled_node->sheen = node.float_values["sheen"];
+		if (const float* const sheen_value = node.params.find_float("sheen")) {
+			principled_node->sheen = *sheen_value;
 		}
-		if (node.float_values.count("sheen_tint") == 1) {
-			principled_node->sheen_tint = node.float_values["sheen_tint"];
+		if (const float* const sheen_tint_value = node.params.find_float("sheen_tint")) {
+			principled_node->sheen_tint = *sheen_tint_value;
 		}
-		if (node.float_values.count("clearcoat") == 1) {
-			principled_node->clearcoat = node.float_values["clearcoat"];
+		if (const float* const clearcoat_value = node.params.find_float("clearcoat")) {
+			principled_node->clearcoat = *clearcoat_value;
 		}
-		if (node.float_values.count("clearcoat_roughness") == 1) {
-			principled_node->clearcoat_roughness = node.float_values["clearcoat_roughness"];
+		if (const float* const clearcoat_roughness_value = node.params.find_float("clearcoat_roughness")) {
+			principled_node->clearcoat_roughness = *clearcoat_roughness_value;
 		}
-		if (node.float_values.count("ior") == 1) {
-			principled_node->ior = node.float_values["ior"];
+		if (const float* const ior_value = node.params.find_float("ior")) {
+			principled_node->ior = *ior_value;
 		}
-		if (node.float_values.count("transmission") == 1) {
-			principled_node->transmission = node.float_values["transmission"];
+		if (const float* const transmission_value = node.params.find_float("transmission")) {
+			principled_node->transmission = *transmission_value;
 		}
 		break;
 	}
@@ -386,8 +386,8 @@ ccl::ShaderNode* convert_node(OutputNode& node)
 	{
 		ccl::RefractionBsdfNode* refraction_node = new ccl::RefractionBsdfNode();
 		cycles_node = refraction_node;
-		if (node.string_values.count("distribution") == 1) {
-			std::string dist = node.string_values["distribution"];
+		if (const std::string* const distribution_value = node.params.find_string("distribution")) {
+			std::string dist = *distribution_value;
 			if (dist == "ggx") {
 				refraction_node->distribution = ccl::ClosureType::CLOSURE_BSDF_MICROFACET_GGX_REFRACTION_ID;
 			}
@@ -398,14 +398,14 @@ ccl::ShaderNode* convert_node(OutputNode& node)
 				refraction_node->distribution = ccl::ClosureType::CLOSURE_BSDF_REFRACTION_ID;
 			}
 		}
-		if (node.float3_values.count("color") == 1) {
-			refraction_node->color = float3_to_ccl_float3(node.float3_values["color"]);
+		if (const Float3* const color_value = node.params.find_float3("color")) {
+			refraction_node->color = float3_to_ccl_float3(*color_value);
 		}
-		if (node.float_values.count("roughness") == 1) {
-			refraction_node->roughness = node.float_values["roughness"];
+		if (const float* const roughness_value = node.params.find_float("roughness")) {
+			refraction_node->roughness = *roughness_value;
 		}
-		if (node.float_values.count("IOR") == 1) {
-			refraction_node->IOR = node.float_values["IOR"];
+		if (const float* const IOR_value = node.params.find_float("IOR")) {
+			refraction_node->IOR = *IOR_value;
 		}
 		break;
 	}
@@ -413,8 +413,8 @@ ccl::ShaderNode* convert_node(OutputNode& node)
 	{
 		ccl::SubsurfaceScatteringNode* sss_node = new ccl::SubsurfaceScatteringNode();
 		cycles_node = sss_node;
-		if (node.string_values.count("falloff") == 1) {
-			std::string falloff = node.string_values["falloff"];
+		if (const std::string* const falloff_value = node.params.find_string("falloff")) {
+			std::string falloff = *falloff_value;
 			if (falloff == "burley") {
 				sss_node->falloff = ccl::ClosureType::CLOSURE_BSSRDF_BURLEY_ID;
 			}
@@ -425,17 +425,17 @@ ccl::ShaderNode* convert_node(OutputNode& node)
 				sss_node->falloff = ccl::ClosureType::CLOSURE_BSSRDF_CUBIC_ID;
 			}
 		}
-		if (node.float3_values.count("color") == 1) {
-			sss_node->color = float3_to_ccl_float3(node.float3_values["color"]);
+		if (const Float3* const color_value = node.params.find_float3("color")) {
+			sss_node->color = float3_to_ccl_float3(*color_value);
 		}
-		if (node.float_values.count("scale") == 1) {
-			sss_node->scale = node.float_values["scale"];
+		if (const float* const scale_value = node.params.find_float("scale")) {
+			sss_node->scale = *scale_value;
 		}
-		if (node.float3_values.count("radius") == 1) {
-			sss_node->radius = float3_to_ccl_float3(node.float3_values["radius"]);
+		if (const Float3* const radius_value = node.params.find_float3("radius")) {
+			sss_node->radius = float3_to_ccl_float3(*radius_value);
 		}
-		if (node.float_values.count("texture_blur") == 1) {
-			sss_node->texture_blur = node.float_values["texture_blur"];
+		if (const float* const texture_blur_value = node.params.find_float("texture_blur")) {
+			sss_node->texture_blur = *texture_blur_value;
 		}
 		break;
 	}
@@ -444,8 +444,8 @@ ccl::ShaderNode* convert_node(OutputNode& node)
 		ccl::TangentNode* tangent_node = new ccl::TangentNode();
 		tangent_node->attribute = "";
 		cycles_node = tangent_node;
-		if (node.string_values.count("direction") == 1) {
-			std::string dir = node.string_values["direction"];
+		if (const std::string* const direction = node.params.find_string("direction")) {
+			std::string dir = *direction;
 			if (dir == "uv_map") {
 				tangent_node->direction_type = ccl::NodeTangentDirectionType::NODE_TANGENT_UVMAP;
 			}
@@ -453,8 +453,8 @@ ccl::ShaderNode* convert_node(OutputNode& node)
 				tangent_node->direction_type = ccl::NodeTangentDirectionType::NODE_TANGENT_RADIAL;
 			}
 		}
-		if (node.string_values.count("axis") == 1) {
-			std::string axis = node.string_values["axis"];
+		if (const std::string* const axis_value = node.params.find_string("axis")) {
+			std::string axis = *axis_value;
 			if (axis == "x") {
 				tangent_node->axis = ccl::NodeTangentAxis::NODE_TANGENT_AXIS_X;
 			}
@@ -476,8 +476,8 @@ ccl::ShaderNode* convert_node(OutputNode& node)
 	{
 		ccl::ToonBsdfNode* toon_node = new ccl::ToonBsdfNode();
 		cycles_node = toon_node;
-		if (node.string_values.count("component") == 1) {
-			std::string comp = node.string_values["component"];
+		if (const std::string* const component_value = node.params.find_string("component")) {
+			std::string comp = *component_value;
 			if (comp == "diffuse") {
 				toon_node->component = ccl::ClosureType::CLOSURE_BSDF_DIFFUSE_TOON_ID;
 			}
@@ -485,14 +485,14 @@ ccl::ShaderNode* convert_node(OutputNode& node)
 				toon_node->component = ccl::ClosureType::CLOSURE_BSDF_GLOSSY_TOON_ID;
 			}
 		}
-		if (node.float3_values.count("color") == 1) {
-			toon_node->color = float3_to_ccl_float3(node.float3_values["color"]);
+		if (const Float3* const color_value = node.params.find_float3("color")) {
+			toon_node->color = float3_to_ccl_float3(*color_value);
 		}
-		if (node.float_values.count("size") == 1) {
-			toon_node->size = node.float_values["size"];
+		if (const float* const size_value = node.params.find_float("size")) {
+			toon_node->size = *size_value;
 		}
-		if (node.float_values.count("smooth") == 1) {
-			toon_node->smooth = node.float_values["smooth"];
+		if (const float* const smooth_value = node.params.find_float("smooth")) {
+			toon_node->smooth = *smooth_value;
 		}
 		break;
 	}
@@ -500,8 +500,8 @@ ccl::ShaderNode* convert_node(OutputNode& node)
 	{
 		ccl::TranslucentBsdfNode* translucent_node = new ccl::TranslucentBsdfNode();
 		cycles_node = translucent_node;
-		if (node.float3_values.count("color") == 1) {
-			translucent_node->color = float3_to_ccl_float3(node.float3_values["color"]);
+		if (const Float3* const color_value = node.params.find_float3("color")) {
+			translucent_node->color = float3_to_ccl_float3(*color_value);
 		}
 		break;
 	}
@@ -509,8 +509,8 @@ ccl::ShaderNode* convert_node(OutputNode& node)
 	{
 		ccl::TransparentBsdfNode* transparent_node = new ccl::TransparentBsdfNode();
 		cycles_node = transparent_node;
-		if (node.float3_values.count("color") == 1) {
-			transparent_node->color = float3_to_ccl_float3(node.float3_values["color"]);
+		if (const Float3* const color_value = node.params.find_float3("color")) {
+			transparent_node->color = float3_to_ccl_float3(*color_value);
 		}
 		break;
 	}
@@ -518,11 +518,11 @@ ccl::ShaderNode* convert_node(OutputNode& node)
 	{
 		ccl::VelvetBsdfNode* velvet_node = new ccl::VelvetBsdfNode();
 		cycles_node = velvet_node;
-		if (node.float3_values.count("color") == 1) {
-			velvet_node->color = float3_to_ccl_float3(node.float3_values["color"]);
+		if (const Float3* const color_value = node.params.find_float3("color")) {
+			velvet_node->color = float3_to_ccl_float3(*color_value);
 		}
-		if (node.float_values.count("sigma") == 1) {
-			velvet_node->sigma = node.float_values["sigma"];
+		if (const float* const sigma_value = node.params.find_float("sigma")) {
+			velvet_node->sigma = *sigma_value;
 		}
 		break;
 	}
@@ -530,11 +530,11 @@ ccl::ShaderNode* convert_node(OutputNode& node)
 	{
 		ccl::AbsorptionVolumeNode* absorb_node = new ccl::AbsorptionVolumeNode();
 		cycles_node = absorb_node;
-		if (node.float3_values.count("color") == 1) {
-			absorb_node->color = float3_to_ccl_float3(node.float3_values["color"]);
+		if (const Float3* const color_value = node.params.find_float3("color")) {
+			absorb_node->color = float3_to_ccl_float3(*color_value);
 		}
-		if (node.float_values.count("density") == 1) {
-			absorb_node->density = node.float_values["density"];
+		if (const float* const density_value = node.params.find_float("density")) {
+			absorb_node->density = *density_value;
 		}
 		break;
 	}
@@ -542,14 +542,14 @@ ccl::ShaderNode* convert_node(OutputNode& node)
 	{
 		ccl::ScatterVolumeNode* scatter_node = new ccl::ScatterVolumeNode();
 		cycles_node = scatter_node;
-		if (node.float3_values.count("color") == 1) {
-			scatter_node->color = float3_to_ccl_float3(node.float3_values["color"]);
+		if (const Float3* const color_value = node.params.find_float3("color")) {
+			scatter_node->color = float3_to_ccl_float3(*color_value);
 		}
-		if (node.float_values.count("density") == 1) {
-			scatter_node->density = node.float_values["density"];
+		if (const float* const density_value = node.params.find_float("density")) {
+			scatter_node->density = *density_value;
 		}
-		if (node.float_values.count("anisotropy") == 1) {
-			scatter_node->anisotropy = node.float_values["anisotropy"];
+		if (const float* const anisotropy_value = node.params.find_float("anisotropy")) {
+			scatter_node->anisotropy = *anisotropy_value;
 		}
 		break;
 	}
@@ -557,8 +557,8 @@ ccl::ShaderNode* convert_node(OutputNode& node)
 	{
 		ccl::VoronoiTextureNode* voronoi_node = new ccl::VoronoiTextureNode();
 		cycles_node = voronoi_node;
-		if (node.string_values.count("coloring") == 1) {
-			std::string coloring = node.string_values["coloring"];
+		if (const std::string* const coloring_value = node.params.find_string("coloring")) {
+			std::string coloring = *coloring_value;
 			if (coloring == "cells") {
 				voronoi_node->coloring = ccl::NodeVoronoiColoring::NODE_VORONOI_CELLS;
 			}
@@ -566,8 +566,8 @@ ccl::ShaderNode* convert_node(OutputNode& node)
 				voronoi_node->coloring = ccl::NodeVoronoiColoring::NODE_VORONOI_INTENSITY;
 			}
 		}
-		if (node.float_values.count("scale") == 1) {
-			voronoi_node->scale = node.float_values["scale"];
+		if (const float* const scale_value = node.params.find_float("scale")) {
+			voronoi_node->scale = *scale_value;
 		}
 		break;
 	}
@@ -575,8 +575,8 @@ ccl::ShaderNode* convert_node(OutputNode& node)
 	{
 		ccl::WaveTextureNode* wave_node = new ccl::WaveTextureNode();
 		cycles_node = wave_node;
-		if (node.string_values.count("type") == 1) {
-			std::string type = node.string_values["type"];
+		if (const std::string* const type_value = node.params.find_string("type")) {
+			std::string type = *type_value;
 			if (type == "bands") {
 				wave_node->type = ccl::NodeWaveType::NODE_WAVE_BANDS;
 			}
@@ -584,8 +584,8 @@ ccl::ShaderNode* convert_node(OutputNode& node)
 				wave_node->type = ccl::NodeWaveType::NODE_WAVE_RINGS;
 			}
 		}
-		if (node.string_values.count("profile") == 1) {
-			std::string profile = node.string_values["profile"];
+		if (const std::string* const profile_value = node.params.find_string("profile")) {
+			std::string profile = *profile_value;
 			if (profile == "saw") {
 				wave_node->profile = ccl::NodeWaveProfile::NODE_WAVE_PROFILE_SAW;
 			}
@@ -593,17 +593,17 @@ ccl::ShaderNode* convert_node(OutputNode& node)
 				wave_node->profile = ccl::NodeWaveProfile::NODE_WAVE_PROFILE_SIN;
 			}
 		}
-		if (node.float_values.count("scale") == 1) {
-			wave_node->scale = node.float_values["scale"];
+		if (const float* const scale_value = node.params.find_float("scale")) {
+			wave_node->scale = *scale_value;
 		}
-		if (node.float_values.count("distortion") == 1) {
-			wave_node->distortion = node.float_values["distortion"];
+		if (const float* const distortion_value = node.params.find_float("distortion")) {
+			wave_node->distortion = *distortion_value;
 		}
-		if (node.float_values.count("detail") == 1) {
-			wave_node->detail = node.float_values["detail"];
+		if (const float* const detail_value = node.params.find_float("detail")) {
+			wave_node->detail = *detail_value;
 		}
-		if (node.float_values.count("detail_scale") == 1) {
-			wave_node->detail_scale = node.float_values["detail_scale"];
+		if (const float* const detail_scale_value = node.params.find_float("detail_scale")) {
+			wave_node->detail_scale = *detail_scale_value;
 		}
 		break;
 	}
@@ -616,8 +616,8 @@ ccl::ShaderNode* convert_node(OutputNode& node)
 	{
 		ccl::FresnelNode* fresnel_node = new ccl::FresnelNode();
 		cycles_node = fresnel_node;
-		if (node.float_values.count("IOR") == 1) {
-			fresnel_node->IOR = node.float_values["IOR"];
+		if (const float* const IOR_value = node.params.find_float("IOR")) {
+			fresnel_node->IOR = *IOR_value;
 		}
 		break;
 	}
@@ -625,8 +625,8 @@ ccl::ShaderNode* convert_node(OutputNode& node)
 	{
 		ccl::LayerWeightNode* lw_node = new ccl::LayerWeightNode();
 		cycles_node = lw_node;
-		if (node.float_values.count("blend") == 1) {
-			lw_node->blend = node.float_values["blend"];
+		if (const float* const blend_value = node.params.find_float("blend")) {
+			lw_node->blend = *blend_value;
 		}
 		break;
 	}
@@ -639,8 +639,8 @@ ccl::ShaderNode* convert_node(OutputNode& node)
 	{
 		ccl::MixNode* mix_node = new ccl::MixNode();
 		cycles_node = mix_node;
-		if (node.string_values.count("type") == 1) {
-			std::string type = node.string_values["type"];
+		if (const std::string* const type_value = node.params.find_string("type")) {
+			std::string type = *type_value;
 			if (type == "linear_light") {
 				mix_node->type = ccl::NodeMix::NODE_MIX_LINEAR;
 			}
@@ -696,17 +696,17 @@ ccl::ShaderNode* convert_node(OutputNode& node)
 				mix_node->type = ccl::NodeMix::NODE_MIX_BLEND;
 			}
 		}
-		if (node.bool_values.count("use_clamp") == 1) {
-			mix_node->use_clamp = node.bool_values["use_clamp"];
+		if (const bool* const use_clamp_value = node.params.find_bool("use_clamp")) {
+			mix_node->use_clamp = *use_clamp_value;
 		}
-		if (node.float_values.count("fac") == 1) {
-			mix_node->fac = node.float_values["fac"];
+		if (const float* const fac_value = node.params.find_float("fac")) {
+			mix_node->fac = *fac_value;
 		}
-		if (node.float3_values.count("color1") == 1) {
-			mix_node->color1 = float3_to_ccl_float3(node.float3_values["color1"]);
+		if (const Float3* const color1_value = node.params.find_float3("color1")) {
+			mix_node->color1 = float3_to_ccl_float3(*color1_value);
 		}
-		if (node.float3_values.count("color2") == 1) {
-			mix_node->color2 = float3_to_ccl_float3(node.float3_values["color2"]);
+		if (const Float3* const color2_value = node.params.find_float3("color2")) {
+			mix_node->color2 = float3_to_ccl_float3(*color2_value);
 		}
 		break;
 	}
@@ -714,11 +714,11 @@ ccl::ShaderNode* convert_node(OutputNode& node)
 	{
 		ccl::InvertNode* invert_node = new ccl::InvertNode();
 		cycles_node = invert_node;
-		if (node.float_values.count("fac") == 1) {
-			invert_node->fac = node.float_values["fac"];
+		if (const float* const fac_value = node.params.find_float("fac")) {
+			invert_node->fac = *fac_value;
 		}
-		if (node.float3_values.count("color") == 1) {
-			invert_node->color = float3_to_ccl_float3(node.float3_values["color"]);
+		if (const Float3* const color_value = node.params.find_float3("color")) {
+			invert_node->color = float3_to_ccl_float3(*color_value);
 		}
 		break;
 	}
@@ -726,11 +726,11 @@ ccl::ShaderNode* convert_node(OutputNode& node)
 	{
 		ccl::LightFalloffNode* falloff_node = new ccl::LightFalloffNode();
 		cycles_node = falloff_node;
-		if (node.float_values.count("strength") == 1) {
-			falloff_node->strength = node.float_values["strength"];
+		if (const float* const strength_value = node.params.find_float("strength")) {
+			falloff_node->strength = *strength_value;
 		}
-		if (node.float_values.count("smooth") == 1) {
-			falloff_node->smooth = node.float_values["smooth"];
+		if (const float* const smooth_value = node.params.find_float("smooth")) {
+			falloff_node->smooth = *smooth_value;
 		}
 		break;
 	}
@@ -738,20 +738,20 @@ ccl::ShaderNode* convert_node(OutputNode& node)
 	{
 		ccl::HSVNode* hsv_node = new ccl::HSVNode();
 		cycles_node = hsv_node;
-		if (node.float_values.count("hue") == 1) {
-			hsv_node->hue = node.float_values["hue"];
+		if (const float* const hue_value = node.params.find_float("hue")) {
+			hsv_node->hue = *hue_value;
 		}
-		if (node.float_values.count("saturation") == 1) {
-			hsv_node->saturation = node.float_values["saturation"];
+		if (const float* const saturation_value = node.params.find_float("saturation")) {
+			hsv_node->saturation = *saturation_value;
 		}
-		if (node.float_values.count("value") == 1) {
-			hsv_node->value = node.float_values["value"];
+		if (const float* const value_value = node.params.find_float("value")) {
+			hsv_node->value = *value_value;
 		}
-		if (node.float_values.count("fac") == 1) {
-			hsv_node->fac = node.float_values["fac"];
+		if (const float* const fac_value = node.params.find_float("fac")) {
+			hsv_node->fac = *fac_value;
 		}
-		if (node.float3_values.count("color") == 1) {
-			hsv_node->color = float3_to_ccl_float3(node.float3_values["color"]);
+		if (const Float3* const color_value = node.params.find_float3("color")) {
+			hsv_node->color = float3_to_ccl_float3(*color_value);
 		}
 		break;
 	}
@@ -759,11 +759,11 @@ ccl::ShaderNode* convert_node(OutputNode& node)
 	{
 		ccl::GammaNode* gamma_node = new ccl::GammaNode();
 		cycles_node = gamma_node;
-		if (node.float3_values.count("color") == 1) {
-			gamma_node->color = float3_to_ccl_float3(node.float3_values["color"]);
+		if (const Float3* const color_value = node.params.find_float3("color")) {
+			gamma_node->color = float3_to_ccl_float3(*color_value);
 		}
-		if (node.float_values.count("gamma") == 1) {
-			gamma_node->gamma = node.float_values["gamma"];
+		if (const float* const gamma_value = node.params.find_float("gamma")) {
+			gamma_node->gamma = *gamma_value;
 		}
 		break;
 	}
@@ -771,14 +771,14 @@ ccl::ShaderNode* convert_node(OutputNode& node)
 	{
 		ccl::BrightContrastNode* bc_node = new ccl::BrightContrastNode();
 		cycles_node = bc_node;
-		if (node.float3_values.count("color") == 1) {
-			bc_node->color = float3_to_ccl_float3(node.float3_values["color"]);
+		if (const Float3* const color_value = node.params.find_float3("color")) {
+			bc_node->color = float3_to_ccl_float3(*color_value);
 		}
-		if (node.float_values.count("bright") == 1) {
-			bc_node->bright = node.float_values["bright"];
+		if (const float* const bright_value = node.params.find_float("bright")) {
+			bc_node->bright = *bright_value;
 		}
-		if (node.float_values.count("contrast") == 1) {
-			bc_node->contrast = node.float_values["contrast"];
+		if (const float* const contrast_value = node.params.find_float("contrast")) {
+			bc_node->contrast = *contrast_value;
 		}
 		break;
 	}
@@ -786,17 +786,17 @@ ccl::ShaderNode* convert_node(OutputNode& node)
 	{
 		ccl::BumpNode* bump_node = new ccl::BumpNode();
 		cycles_node = bump_node;
-		if (node.bool_values.count("invert") == 1) {
-			bump_node->invert = node.bool_values["invert"];
+		if (const bool* const invert_value = node.params.find_bool("invert")) {
+			bump_node->invert = *invert_value;
 		}
-		if (node.float_values.count("strength") == 1) {
-			bump_node->strength = node.float_values["strength"];
+		if (const float* const strength_value = node.params.find_float("strength")) {
+			bump_node->strength = *strength_value;
 		}
-		if (node.float_values.count("distance") == 1) {
-			bump_node->distance = node.float_values["distance"];
+		if (const float* const distance_value = node.params.find_float("distance")) {
+			bump_node->distance = *distance_value;
 		}
-		if (node.float_values.count("height") == 1) {
-			bump_node->height = node.float_values["height"];
+		if (const float* const height_value = node.params.find_float("height")) {
+			bump_node->height = *height_value;
 		}
 		break;
 	}
@@ -805,8 +805,8 @@ ccl::ShaderNode* convert_node(OutputNode& node)
 		ccl::NormalMapNode* normal_node = new ccl::NormalMapNode();
 		normal_node->attribute = "";
 		cycles_node = normal_node;
-		if (node.string_values.count("space") == 1) {
-			std::string space = node.string_values["space"];
+		if (const std::string* const space_value = node.params.find_string("space")) {
+			std::string space = *space_value;
 			if (space == "tangent") {
 				normal_node->space = ccl::NodeNormalMapSpace::NODE_NORMAL_MAP_TANGENT;
 			}
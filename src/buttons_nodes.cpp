@@ -2,12 +2,7 @@
 
 #include "drawing.h"
 #include "gui_sizes.h"
-#include "node_colors.h"
-#include "node_inputs.h"
-#include "node_interop_max.h"
-#include "node_shaders.h"
-#include "node_textures.h"
-#include "node_vector.h"
+#include "node_registry.h"
 
 float CyclesShaderEditor::NodeCreationButton::draw(NVGcontext* draw_context, Point2 draw_origin, Point2 parent_local_mouse_pos, float parent_width)
 {
@@ -39,3 +34,14 @@ bool CyclesShaderEditor::NodeCreationButton::is_mouse_over_button()
 
 	return false;
 }
+
+CyclesShaderEditor::NodeTypeButton::NodeTypeButton(const NodeTypeInfo& type_info) :
+	type_info(type_info)
+{
+	label = type_info.title;
+}
+
+CyclesShaderEditor::EditorNode* CyclesShaderEditor::NodeTypeButton::create_node(Point2 world_position)
+{
+	return type_info.create(world_position);
+}
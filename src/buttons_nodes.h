@@ -9,6 +9,7 @@ struct NVGcontext;
 namespace CyclesShaderEditor {
 
 	class EditorNode;
+	struct NodeTypeInfo;
 
 	class NodeCreationButton {
 	public:
@@ -31,21 +32,15 @@ namespace CyclesShaderEditor {
 		float button_width;
 	};
 
-	// Generic
-
-	template<typename T>
-	class GenericNodeButton : public NodeCreationButton {
+	// Creates nodes of one type from the node type registry
+	class NodeTypeButton : public NodeCreationButton {
 	public:
-		GenericNodeButton() {
-			Point2 fake_position(0.0f, 0.0f);
-			T* tmp_node = new T(fake_position);
-			this->label = tmp_node->get_title();
-			delete tmp_node;
-		}
-
-		virtual EditorNode* create_node(Point2 world_position) override {
-			return new T(world_position);
-		}
+		NodeTypeButton(const NodeTypeInfo& type_info);
+
+		virtual EditorNode* create_node(Point2 world_position) override;
+
+	private:
+		const NodeTypeInfo& type_info;
 	};
 
 }
\ No newline at end of file
@@ -3,10 +3,14 @@
 #include "sockets.h"
 #include "util_hermite_spline.h"
 
-CyclesShaderEditor::CurveEvaluator::CurveEvaluator(CurveSocketValue* curve_socket_val, int segments)
+CyclesShaderEditor::CurveEvaluator::CurveEvaluator(CurveSocketValue* curve_socket_val, int segments) :
+	CurveEvaluator(curve_socket_val->curve_points, curve_socket_val->curve_interp, segments)
 {
-	const std::vector<Point2>& curve_control_points = curve_socket_val->curve_points;
 
+}
+
+CyclesShaderEditor::CurveEvaluator::CurveEvaluator(const std::vector<Point2>& curve_control_points, CurveInterpolation curve_interp, int segments)
+{
 	// No points, in this case treat as output = input
 	if (curve_control_points.size() == 0) {
 		const Point2 point_0(0.0f, 0.0f);
@@ -25,7 +29,7 @@ CyclesShaderEditor::CurveEvaluator::CurveEvaluator(CurveSocketValue* curve_socke
 		return;
 	}
 
-	if (curve_socket_val->curve_interp == CurveInterpolation::CUBIC_HERMITE) {
+	if (curve_interp == CurveInterpolation::CUBIC_HERMITE) {
 		// Sample as a series of cubic hermite splines
 		constexpr float FIRST_SAMPLE_X = 0.0f;
 		constexpr float LAST_SAMPLE_X = 1.0f;
@@ -2,6 +2,7 @@
 
 #include <vector>
 
+#include "common_enums.h"
 #include "point2.h"
 
 namespace CyclesShaderEditor {
@@ -13,6 +14,7 @@ namespace CyclesShaderEditor {
 	class CurveEvaluator {
 	public:
 		CurveEvaluator(CurveSocketValue* curve_socket_val, int segments = 512);
+		CurveEvaluator(const std::vector<Point2>& curve_control_points, CurveInterpolation curve_interp, int segments = 512);
 		CurveEvaluator(Point2 a, Point2 b, Point2 c, Point2 d, int segments = 128);
 
 		int compare_to_range(float in_value) const;
@@ -0,0 +1,306 @@
+#include "edit_journal.h"
+
+#include <cstring>
+#include <utility>
+
+#include "serialize.h"
+#include "util_bytes.h"
+
+// File layout, all integers are little-endian:
+// header: 8 byte magic, u32 version
+// records: u8 kind, u64 payload length, u64 payload hash, payload
+// The first record is the saved graph, each one after it is an encoded GraphPatch from the graph before it
+static const char JOURNAL_MAGIC[8] = { 'C', 'S', 'E', 'J', 'R', 'N', 'A', 'L' };
+static const unsigned int JOURNAL_VERSION = 1;
+
+static constexpr size_t HEADER_SIZE = 12;
+static constexpr size_t RECORD_HEADER_SIZE = 17;
+
+static const char RECORD_SAVED_GRAPH = 'G';
+static const char RECORD_PATCH = 'P';
+
+static void append_record(std::string& out, char kind, const std::string& payload)
+{
+	out.push_back(kind);
+	CyclesShaderEditor::append_u64(out, payload.size());
+	CyclesShaderEditor::append_u64(out, CyclesShaderEditor::hash_bytes(payload.data(), payload.size()));
+	out.append(payload);
+}
+
+CyclesShaderEditor::EditJournal::EditJournal()
+{
+
+}
+
+CyclesShaderEditor::EditJournal::~EditJournal()
+{
+	close();
+}
+
+bool CyclesShaderEditor::EditJournal::open(const PathString& path, const std::string& saved_graph)
+{
+	close();
+
+	// Opened here so a path that can not be written is reported straight away
+	file = open_file_for_write(path);
+	if (file == nullptr) {
+		return false;
+	}
+	this->path = path;
+
+	stopping = false;
+	flush_pending = false;
+	has_state = false;
+	has_base = true;
+	pending_base = saved_graph;
+	requested = 1;
+	completed = 0;
+	last_sync = std::chrono::steady_clock::now();
+	thread = std::thread(&EditJournal::run, this);
+
+	return true;
+}
+
+void CyclesShaderEditor::EditJournal::close()
+{
+	if (thread.joinable() == false) {
+		return;
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		stopping = true;
+	}
+	wake_writer.notify_one();
+	thread.join();
+
+	if (file != nullptr) {
+		fclose(file);
+		file = nullptr;
+	}
+	graph = CyclesNodeGraph();
+	graph_index.clear();
+}
+
+bool CyclesShaderEditor::EditJournal::is_open() const
+{
+	return thread.joinable();
+}
+
+void CyclesShaderEditor::EditJournal::append(const std::string& state)
+{
+	if (is_open() == false) {
+		return;
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		// Assigned into the same buffer every time so its memory is reused
+		pending_state.assign(state);
+		has_state = true;
+		requested++;
+	}
+	wake_writer.notify_one();
+}
+
+void CyclesShaderEditor::EditJournal::reset(const std::string& saved_graph)
+{
+	if (is_open() == false) {
+		return;
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		// A state appended before the save is part of the saved graph
+		has_state = false;
+		pending_base.assign(saved_graph);
+		has_base = true;
+		requested++;
+	}
+	wake_writer.notify_one();
+}
+
+void CyclesShaderEditor::EditJournal::flush()
+{
+	if (is_open() == false) {
+		return;
+	}
+
+	std::unique_lock<std::mutex> lock(mutex);
+	// Counted as a request of its own so the writer runs even if nothing is pending
+	flush_pending = true;
+	const unsigned long long target = ++requested;
+	wake_writer.notify_one();
+	wake_flush.wait(lock, [&]() {
+		return completed >= target || stopping;
+	});
+}
+
+void CyclesShaderEditor::EditJournal::run()
+{
+	std::unique_lock<std::mutex> lock(mutex);
+	while (true) {
+		const bool work_waiting = (completed < requested);
+		if (work_waiting == false && stopping) {
+			break;
+		}
+		if (work_waiting == false) {
+			// Sleeps until there is something to do, or until written changes are due to be synced
+			if (unsynced) {
+				wake_writer.wait_until(lock, last_sync + std::chrono::milliseconds(SYNC_INTERVAL_MS));
+			}
+			else {
+				wake_writer.wait(lock);
+			}
+		}
+		write_pending(lock);
+	}
+
+	if (file != nullptr && unsynced) {
+		sync_file(file);
+		unsynced = false;
+	}
+	wake_flush.notify_all();
+}
+
+void CyclesShaderEditor::EditJournal::write_pending(std::unique_lock<std::mutex>& lock)
+{
+	// Everything queued so far is taken at once, so changes that arrive faster than they can be written are batched
+	const unsigned long long target = requested;
+	const bool write_base = has_base;
+	const bool write_state = has_state;
+	const bool flush_requested = flush_pending;
+	flush_pending = false;
+	std::string base;
+	std::string state;
+	if (write_base) {
+		base.swap(pending_base);
+		has_base = false;
+	}
+	if (write_state) {
+		state.swap(pending_state);
+		has_state = false;
+	}
+	lock.unlock();
+
+	if (write_base) {
+		start_file(base);
+	}
+	if (write_state && file != nullptr) {
+		const CyclesNodeGraph new_graph(state, OutputParamLayout::Flat);
+		const GraphPatch patch = diff_graphs(graph, new_graph);
+		if (patch.empty() == false && apply_graph_patch(graph, patch, graph_index)) {
+			patch_text.clear();
+			encode_graph_patch(patch, patch_text);
+			record.clear();
+			append_record(record, RECORD_PATCH, patch_text);
+			if (fwrite(record.data(), 1, record.size(), file) == record.size() && fflush(file) == 0) {
+				unsynced = true;
+			}
+		}
+	}
+
+	const std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+	if (file != nullptr && unsynced && (flush_requested || now - last_sync >= std::chrono::milliseconds(SYNC_INTERVAL_MS))) {
+		sync_file(file);
+		unsynced = false;
+		last_sync = now;
+	}
+
+	lock.lock();
+	// The state buffer is handed back so the next append reuses its memory
+	if (has_state == false && write_state) {
+		pending_state.swap(state);
+	}
+	if (completed < target) {
+		completed = target;
+	}
+	wake_flush.notify_all();
+}
+
+bool CyclesShaderEditor::EditJournal::start_file(const std::string& saved_graph)
+{
+	// The file is only opened again for a reset, the first one is opened by open
+	if (file == nullptr || ftell(file) != 0) {
+		if (file != nullptr) {
+			fclose(file);
+		}
+		file = open_file_for_write(path);
+		if (file == nullptr) {
+			return false;
+		}
+	}
+
+	graph = CyclesNodeGraph(saved_graph, OutputParamLayout::Flat);
+	graph_index.build(graph);
+
+	record.clear();
+	record.append(JOURNAL_MAGIC, sizeof(JOURNAL_MAGIC));
+	append_u32(record, JOURNAL_VERSION);
+	append_record(record, RECORD_SAVED_GRAPH, saved_graph);
+	if (fwrite(record.data(), 1, record.size(), file) != record.size() || sync_file(file) == false) {
+		// Changes made against a saved graph that was not written could not be recovered, so none are written
+		fclose(file);
+		file = nullptr;
+		return false;
+	}
+	unsynced = false;
+	last_sync = std::chrono::steady_clock::now();
+	return true;
+}
+
+bool CyclesShaderEditor::recover_edit_journal(const PathString& path, std::string& graph)
+{
+	MappedFile file;
+	if (file.open(path) == false) {
+		return false;
+	}
+
+	const char* const data = file.data();
+	const size_t size = file.size();
+	if (size < HEADER_SIZE || memcmp(data, JOURNAL_MAGIC, sizeof(JOURNAL_MAGIC)) != 0 || read_u32(data + 8) != JOURNAL_VERSION) {
+		return false;
+	}
+
+	CyclesNodeGraph recovered;
+	GraphPatchIndex recovered_index;
+	bool has_saved_graph = false;
+	GraphPatch patch;
+	size_t pos = HEADER_SIZE;
+	while (size - pos >= RECORD_HEADER_SIZE) {
+		const char kind = data[pos];
+		const unsigned long long length = read_u64(data + pos + 1);
+		const unsigned long long hash = read_u64(data + pos + 9);
+		const char* const payload = data + pos + RECORD_HEADER_SIZE;
+		// A record cut short or garbled by a crash ends the journal
+		if (length > size - pos - RECORD_HEADER_SIZE || hash_bytes(payload, static_cast<size_t>(length)) != hash) {
+			break;
+		}
+		pos += RECORD_HEADER_SIZE + static_cast<size_t>(length);
+
+		if (kind == RECORD_SAVED_GRAPH && has_saved_graph == false) {
+			SerializedGraphView saved_graph;
+			saved_graph.data = payload;
+			saved_graph.length = static_cast<size_t>(length);
+			recovered = CyclesNodeGraph(saved_graph, OutputParamLayout::Flat);
+			recovered_index.build(recovered);
+			has_saved_graph = true;
+		}
+		else if (kind == RECORD_PATCH && has_saved_graph) {
+			if (decode_graph_patch(StringSlice(payload, static_cast<size_t>(length)), patch) == false || apply_graph_patch(recovered, patch, recovered_index) == false) {
+				break;
+			}
+		}
+		else {
+			break;
+		}
+	}
+
+	if (has_saved_graph == false) {
+		return false;
+	}
+
+	graph.clear();
+	serialize_graph(recovered.nodes, recovered.connections, graph);
+	return true;
+}
@@ -0,0 +1,88 @@
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdio>
+#include <mutex>
+#include <string>
+#include <thread>
+
+#include "graph_decoder.h"
+#include "graph_patch.h"
+#include "util_platform.h"
+
+namespace CyclesShaderEditor {
+
+	// Append-only log of edits made since a graph was last saved, so they can be recovered if the process dies
+	// The file starts with the saved graph and then holds one GraphPatch for each change after it
+	// Changes are worked out, written and synced on a background thread, append only copies the state into a queue
+	class EditJournal {
+	public:
+		// Longest time a written change can wait before it is synced to disk
+		static const int SYNC_INTERVAL_MS = 500;
+
+		EditJournal();
+		~EditJournal();
+
+		EditJournal(const EditJournal&) = delete;
+		EditJournal& operator=(const EditJournal&) = delete;
+
+		// Starts a journal at path on top of saved_graph, any file already there is replaced
+		// saved_graph may be text or binary, as CyclesNodeGraph reads it
+		bool open(const PathString& path, const std::string& saved_graph);
+		// Writes and syncs everything appended so far, then stops the background thread
+		void close();
+
+		bool is_open() const;
+
+		// Records the graph as it is after an edit
+		// Several states appended before the background thread gets to them are written as one change
+		void append(const std::string& state);
+
+		// Starts the journal over on top of a graph that was just saved, the edits before it are no longer needed
+		void reset(const std::string& saved_graph);
+
+		// Blocks until everything appended so far is written and synced
+		void flush();
+
+	private:
+		void run();
+		void write_pending(std::unique_lock<std::mutex>& lock);
+		bool start_file(const std::string& saved_graph);
+
+		PathString path;
+		FILE* file = nullptr;
+		std::thread thread;
+
+		// Everything below up to the graph is shared with the background thread and guarded by the mutex
+		std::mutex mutex;
+		std::condition_variable wake_writer;
+		std::condition_variable wake_flush;
+		bool stopping = false;
+		// Set by flush, the batch that takes it is synced whatever else it holds
+		bool flush_pending = false;
+		bool has_base = false;
+		std::string pending_base;
+		bool has_state = false;
+		std::string pending_state;
+		// Number of appends, resets and flushes asked for and done, flush waits for done to catch up
+		unsigned long long requested = 0;
+		unsigned long long completed = 0;
+
+		// Only used by the background thread
+		// The saved graph with every written change applied, patches are made against it so they apply in turn on recovery
+		CyclesNodeGraph graph;
+		GraphPatchIndex graph_index;
+		std::string record;
+		std::string patch_text;
+		bool unsynced = false;
+		std::chrono::steady_clock::time_point last_sync;
+	};
+
+	// Rebuilds the last graph recorded in a journal by applying its changes to the saved graph it starts with
+	// A change cut short by a crash, and anything after it, is ignored
+	// Returns false if the file is not a journal or its saved graph can not be read
+	bool recover_edit_journal(const PathString& path, std::string& graph);
+
+}
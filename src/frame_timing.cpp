@@ -0,0 +1,99 @@
+#include "frame_timing.h"
+
+#include <algorithm>
+
+const char* CyclesShaderEditor::get_frame_phase_name(const FramePhase phase)
+{
+	switch (phase) {
+	case FramePhase::PreDraw:
+		return "pre_draw";
+	case FramePhase::ServiceRequests:
+		return "requests";
+	case FramePhase::ViewUpdate:
+		return "view update";
+	case FramePhase::ViewDraw:
+		return "view draw";
+	case FramePhase::Subwindows:
+		return "subwindows";
+	case FramePhase::Bars:
+		return "bars";
+	case FramePhase::EndFrame:
+		return "end frame";
+	case FramePhase::SwapBuffers:
+		return "swap";
+	case FramePhase::Frame:
+		return "frame";
+	default:
+		return "";
+	}
+}
+
+CyclesShaderEditor::FrameTimer::FrameTimer()
+{
+	for (PhaseSamples& this_phase : phases) {
+		this_phase.samples.reserve(SAMPLE_COUNT);
+	}
+	sorted.reserve(SAMPLE_COUNT);
+}
+
+void CyclesShaderEditor::FrameTimer::add_sample(const FramePhase phase, const double ms)
+{
+	PhaseSamples& this_phase = phases[static_cast<size_t>(phase)];
+	if (this_phase.samples.size() < SAMPLE_COUNT) {
+		this_phase.samples.push_back(ms);
+		return;
+	}
+	this_phase.samples[this_phase.next] = ms;
+	this_phase.next = (this_phase.next + 1) % SAMPLE_COUNT;
+}
+
+CyclesShaderEditor::FramePhaseStats CyclesShaderEditor::FrameTimer::get_stats(const FramePhase phase) const
+{
+	FramePhaseStats result;
+	const PhaseSamples& this_phase = phases[static_cast<size_t>(phase)];
+	if (this_phase.samples.empty()) {
+		return result;
+	}
+
+	const size_t count = this_phase.samples.size();
+	const size_t last_index = (count < SAMPLE_COUNT || this_phase.next == 0) ? count - 1 : this_phase.next - 1;
+	result.samples = count;
+	result.last_ms = this_phase.samples[last_index];
+	result.min_ms = this_phase.samples[0];
+	double total = 0.0;
+	for (const double sample : this_phase.samples) {
+		result.min_ms = std::min(result.min_ms, sample);
+		total += sample;
+	}
+	result.avg_ms = total / count;
+
+	// Smallest sample that at least 99% of samples are no larger than
+	sorted.assign(this_phase.samples.begin(), this_phase.samples.end());
+	const size_t p99_index = (count * 99 + 99) / 100 - 1;
+	std::nth_element(sorted.begin(), sorted.begin() + p99_index, sorted.end());
+	result.p99_ms = sorted[p99_index];
+
+	return result;
+}
+
+void CyclesShaderEditor::FrameTimer::clear()
+{
+	for (PhaseSamples& this_phase : phases) {
+		this_phase.samples.clear();
+		this_phase.next = 0;
+	}
+}
+
+CyclesShaderEditor::ScopedPhaseTimer::ScopedPhaseTimer(FrameTimer& timer, const FramePhase phase) :
+	timer(timer),
+	phase(phase),
+	begin(std::chrono::steady_clock::now())
+{
+
+}
+
+CyclesShaderEditor::ScopedPhaseTimer::~ScopedPhaseTimer()
+{
+	const std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now();
+	timer.add_sample(phase, std::chrono::duration<double, std::milli>(end - begin).count());
+}
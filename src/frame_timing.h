@@ -0,0 +1,75 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <vector>
+
+namespace CyclesShaderEditor {
+
+	// Parts of one iteration of the window loop, pre_draw includes service_requests and the view update
+	enum class FramePhase {
+		PreDraw,
+		ServiceRequests,
+		ViewUpdate,
+		ViewDraw,
+		Subwindows,
+		// Toolbar and status bar
+		Bars,
+		// nvgEndFrame, where NanoVG sends the frame's geometry to the GPU
+		EndFrame,
+		SwapBuffers,
+		// The whole iteration, not counting time spent waiting for the next frame
+		Frame,
+		COUNT,
+	};
+
+	const char* get_frame_phase_name(FramePhase phase);
+
+	// Statistics of the most recent samples of one phase, all zero if there are none
+	struct FramePhaseStats {
+		double min_ms = 0.0;
+		double avg_ms = 0.0;
+		double p99_ms = 0.0;
+		double last_ms = 0.0;
+		size_t samples = 0;
+	};
+
+	// Keeps the last SAMPLE_COUNT durations of each phase
+	class FrameTimer {
+	public:
+		static const size_t SAMPLE_COUNT = 240;
+
+		FrameTimer();
+
+		void add_sample(FramePhase phase, double ms);
+		FramePhaseStats get_stats(FramePhase phase) const;
+		void clear();
+
+	private:
+		struct PhaseSamples {
+			// Ring buffer, next is where the next sample goes once it is full
+			std::vector<double> samples;
+			size_t next = 0;
+		};
+
+		PhaseSamples phases[static_cast<size_t>(FramePhase::COUNT)];
+		// Reused by get_stats to find the 99th percentile
+		mutable std::vector<double> sorted;
+	};
+
+	// Adds the time between its construction and destruction to a phase
+	class ScopedPhaseTimer {
+	public:
+		ScopedPhaseTimer(FrameTimer& timer, FramePhase phase);
+		~ScopedPhaseTimer();
+
+		ScopedPhaseTimer(const ScopedPhaseTimer&) = delete;
+		ScopedPhaseTimer& operator=(const ScopedPhaseTimer&) = delete;
+
+	private:
+		FrameTimer& timer;
+		const FramePhase phase;
+		const std::chrono::steady_clock::time_point begin;
+	};
+
+}
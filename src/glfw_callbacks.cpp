@@ -44,4 +44,31 @@ void CyclesShaderEditor::scroll_callback(GLFWwindow* window, double xoffset, dou
 		EditorMainWindow* node_editor = window_map_ptr->operator[](window);
 		node_editor->handle_scroll(xoffset, yoffset);
 	}
+}
+
+void CyclesShaderEditor::cursor_position_callback(GLFWwindow* window, double xpos, double ypos)
+{
+	std::map<GLFWwindow*, EditorMainWindow*>* window_map_ptr = get_callback_window_map();
+	if (window_map_ptr->count(window) == 1) {
+		EditorMainWindow* node_editor = window_map_ptr->operator[](window);
+		node_editor->handle_cursor_position(xpos, ypos);
+	}
+}
+
+void CyclesShaderEditor::framebuffer_size_callback(GLFWwindow* window, int /*width*/, int /*height*/)
+{
+	std::map<GLFWwindow*, EditorMainWindow*>* window_map_ptr = get_callback_window_map();
+	if (window_map_ptr->count(window) == 1) {
+		EditorMainWindow* node_editor = window_map_ptr->operator[](window);
+		node_editor->handle_window_changed();
+	}
+}
+
+void CyclesShaderEditor::window_refresh_callback(GLFWwindow* window)
+{
+	std::map<GLFWwindow*, EditorMainWindow*>* window_map_ptr = get_callback_window_map();
+	if (window_map_ptr->count(window) == 1) {
+		EditorMainWindow* node_editor = window_map_ptr->operator[](window);
+		node_editor->handle_window_changed();
+	}
 }
\ No newline at end of file
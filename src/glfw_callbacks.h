@@ -14,5 +14,8 @@ namespace CyclesShaderEditor {
 	void key_callback(GLFWwindow* window, int key, int scancode, int action, int mods);
 	void character_callback(GLFWwindow* window, unsigned int codepoint);
 	void scroll_callback(GLFWwindow* window, double xoffset, double yoffset);
+	void cursor_position_callback(GLFWwindow* window, double xpos, double ypos);
+	void framebuffer_size_callback(GLFWwindow* window, int width, int height);
+	void window_refresh_callback(GLFWwindow* window);
 
 }
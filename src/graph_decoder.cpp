@@ -1,18 +1,157 @@
 #include "graph_decoder.h"
 
+#include <atomic>
+#include <istream>
+#include <thread>
+
+#include "graph_hash.h"
 #include "serialize.h"
+#include "util_arena.h"
+#include "util_platform.h"
+
+static CyclesShaderEditor::StringSlice get_graph_slice(const std::string& encoded_graph)
+{
+	return CyclesShaderEditor::StringSlice(encoded_graph);
+}
+
+static CyclesShaderEditor::StringSlice get_graph_slice(const CyclesShaderEditor::SerializedGraphView& encoded_graph)
+{
+	return CyclesShaderEditor::StringSlice(encoded_graph.data, encoded_graph.length);
+}
+
+template <typename T>
+static std::vector<CyclesShaderEditor::CyclesNodeGraph> decode_graph_batch(const std::vector<T>& encoded_graphs, unsigned int thread_count, CyclesShaderEditor::OutputParamLayout layout)
+{
+	using namespace CyclesShaderEditor;
+
+	std::vector<CyclesNodeGraph> result(encoded_graphs.size());
+
+	if (thread_count == 0) {
+		thread_count = std::thread::hardware_concurrency();
+	}
+	if (thread_count == 0) {
+		thread_count = 1;
+	}
+	if (thread_count > encoded_graphs.size()) {
+		thread_count = static_cast<unsigned int>(encoded_graphs.size());
+	}
+
+	// Workers take one graph at a time so a few large graphs do not leave other threads idle
+	std::atomic<size_t> next_index(0);
+	const auto worker = [&]() {
+		// Each worker reuses one scratch arena, once it has grown to fit the largest graph the decoder's temporaries
+		// no longer allocate
+		MonotonicArena scratch;
+		while (true) {
+			const size_t index = next_index++;
+			if (index >= encoded_graphs.size()) {
+				break;
+			}
+			deserialize_output_lists(get_graph_slice(encoded_graphs[index]), result[index].nodes, result[index].connections, layout, scratch);
+			scratch.reset();
+		}
+	};
+
+	// The calling thread is one of the workers
+	std::vector<std::thread> threads;
+	for (unsigned int i = 1; i < thread_count; i++) {
+		threads.push_back(std::thread(worker));
+	}
+	worker();
+	for (std::thread& this_thread : threads) {
+		this_thread.join();
+	}
+
+	return result;
+}
+
+CyclesShaderEditor::FileGraphInputStream::FileGraphInputStream(FILE* const file) :
+	file(file)
+{
+
+}
+
+size_t CyclesShaderEditor::FileGraphInputStream::read(char* const buffer, const size_t size)
+{
+	return fread(buffer, 1, size, file);
+}
+
+CyclesShaderEditor::StdGraphInputStream::StdGraphInputStream(std::istream& stream) :
+	stream(stream)
+{
+
+}
 
-CyclesShaderEditor::CyclesNodeGraph::CyclesNodeGraph(std::string encoded_graph)
+size_t CyclesShaderEditor::StdGraphInputStream::read(char* const buffer, const size_t size)
 {
-	std::list<EditorNode*> tmp_nodes;
-	std::list<NodeConnection> tmp_connections;
+	stream.read(buffer, static_cast<std::streamsize>(size));
+	return static_cast<size_t>(stream.gcount());
+}
 
-	deserialize_graph(encoded_graph, tmp_nodes, tmp_connections);
+CyclesShaderEditor::FdGraphInputStream::FdGraphInputStream(const int fd) :
+	fd(fd)
+{
+
+}
 
-	generate_output_lists(tmp_nodes, tmp_connections, nodes, connections);
+size_t CyclesShaderEditor::FdGraphInputStream::read(char* const buffer, const size_t size)
+{
+	return read_file_descriptor(fd, buffer, size);
+}
 
-	for (EditorNode* node : tmp_nodes) {
-		delete node;
+CyclesShaderEditor::CyclesNodeGraph::CyclesNodeGraph()
+{
+
+}
+
+CyclesShaderEditor::CyclesNodeGraph::CyclesNodeGraph(const std::string& encoded_graph, OutputParamLayout layout)
+{
+	deserialize_output_lists(encoded_graph, nodes, connections, layout);
+}
+
+CyclesShaderEditor::CyclesNodeGraph::CyclesNodeGraph(SerializedGraphView encoded_graph, OutputParamLayout layout)
+{
+	deserialize_output_lists(StringSlice(encoded_graph.data, encoded_graph.length), nodes, connections, layout);
+}
+
+CyclesShaderEditor::CyclesNodeGraph::CyclesNodeGraph(GraphInputStream& encoded_graph, OutputParamLayout layout)
+{
+	deserialize_output_lists(encoded_graph, nodes, connections, layout);
+}
+
+void CyclesShaderEditor::CyclesNodeGraph::expand_params()
+{
+	for (OutputNode& node : nodes) {
+		expand_output_params(node);
 	}
-	tmp_nodes.clear();
+}
+
+unsigned long long CyclesShaderEditor::CyclesNodeGraph::get_structural_hash() const
+{
+	return hash_graph_structure(nodes, connections);
+}
+
+std::vector<CyclesShaderEditor::CyclesNodeGraph> CyclesShaderEditor::decode_graphs(const std::vector<std::string>& encoded_graphs, unsigned int thread_count, OutputParamLayout layout)
+{
+	return decode_graph_batch(encoded_graphs, thread_count, layout);
+}
+
+std::vector<CyclesShaderEditor::CyclesNodeGraph> CyclesShaderEditor::decode_graphs(const std::vector<SerializedGraphView>& encoded_graphs, unsigned int thread_count, OutputParamLayout layout)
+{
+	return decode_graph_batch(encoded_graphs, thread_count, layout);
+}
+
+bool CyclesShaderEditor::decode_graph(const std::string& encoded_graph, GraphVisitor& visitor)
+{
+	return deserialize_to_visitor(StringSlice(encoded_graph), visitor);
+}
+
+bool CyclesShaderEditor::decode_graph(SerializedGraphView encoded_graph, GraphVisitor& visitor)
+{
+	return deserialize_to_visitor(StringSlice(encoded_graph.data, encoded_graph.length), visitor);
+}
+
+bool CyclesShaderEditor::decode_graph(GraphInputStream& encoded_graph, GraphVisitor& visitor)
+{
+	return deserialize_to_visitor(encoded_graph, visitor);
 }
\ No newline at end of file
@@ -1,20 +1,125 @@
 #pragma once
 
+#include <cstddef>
+#include <cstdio>
+#include <iosfwd>
 #include <list>
 #include <string>
 #include <vector>
 
 #include "output.h"
+#include "util_tokenizer.h"
 
 namespace CyclesShaderEditor {
 
+	// Non-owning reference to a serialized graph, such as one inside a MaterialBundle
+	struct SerializedGraphView {
+		const char* data = nullptr;
+		size_t length = 0;
+	};
+
+	// Source of a graph that is decoded as it is read, rather than loaded into memory whole first
+	// Decoding only keeps the node being read and each node's name, so very large generated graphs can be read in
+	// bounded memory
+	class GraphInputStream {
+	public:
+		virtual ~GraphInputStream() {}
+
+		// Reads up to size bytes into buffer, returns the number of bytes read or 0 at the end of the input
+		virtual size_t read(char* buffer, size_t size) = 0;
+	};
+
+	// Reads from a FILE* opened in binary mode, the file is not closed
+	class FileGraphInputStream : public GraphInputStream {
+	public:
+		FileGraphInputStream(FILE* file);
+
+		virtual size_t read(char* buffer, size_t size) override;
+
+	private:
+		FILE* file;
+	};
+
+	class StdGraphInputStream : public GraphInputStream {
+	public:
+		StdGraphInputStream(std::istream& stream);
+
+		virtual size_t read(char* buffer, size_t size) override;
+
+	private:
+		std::istream& stream;
+	};
+
+	// Reads from a file descriptor, such as a pipe from the program generating the graph, the descriptor is not closed
+	class FdGraphInputStream : public GraphInputStream {
+	public:
+		FdGraphInputStream(int fd);
+
+		virtual size_t read(char* buffer, size_t size) override;
+
+	private:
+		int fd;
+	};
+
 	// Description of a Cycles shader graph
+	// Node params are decoded into OutputNode's per-type maps unless OutputParamLayout::Flat is given
 	class CyclesNodeGraph {
 	public:
-		CyclesNodeGraph(std::string encoded_graph);
+		CyclesNodeGraph();
+		CyclesNodeGraph(const std::string& encoded_graph, OutputParamLayout layout = OutputParamLayout::Maps);
+		CyclesNodeGraph(SerializedGraphView encoded_graph, OutputParamLayout layout = OutputParamLayout::Maps);
+		// The encoded graph is never held in memory whole, only the decoded nodes and connections are
+		CyclesNodeGraph(GraphInputStream& encoded_graph, OutputParamLayout layout = OutputParamLayout::Maps);
+
+		// Moves every node's params into the maps, for code written against the map form
+		void expand_params();
+
+		// Fingerprint of everything in the graph that affects the rendered material, for use as a shader cache key
+		// Covers node types, param values and connections of the nodes that reach the material output
+		// Node names and positions are ignored, as are nodes that are not connected to the output
+		// Returns 0 for a graph with no material output
+		unsigned long long get_structural_hash() const;
 
 		std::vector<OutputNode> nodes;
 		std::vector<OutputConnection> connections;
 	};
 
+	// Receives the contents of a graph one piece at a time while it is decoded, see decode_graph
+	// Every callback does nothing by default, so a visitor only needs to override the ones it uses
+	class GraphVisitor {
+	public:
+		virtual ~GraphVisitor() {}
+
+		// Called for each node in the order the nodes are stored, followed by one call per param and then on_node_end
+		// Params get the same values CyclesNodeGraph would hold, params missing from the graph are given their default
+		virtual void on_node_begin(CyclesNodeType type, StringSlice name, float world_x, float world_y) {}
+		virtual void on_float(StringSlice param_name, float value) {}
+		virtual void on_float3(StringSlice param_name, Float3 value) {}
+		virtual void on_string(StringSlice param_name, StringSlice value) {}
+		virtual void on_int(StringSlice param_name, int value) {}
+		virtual void on_bool(StringSlice param_name, bool value) {}
+		// The curve is reused for the next call, it is only valid until this call returns
+		virtual void on_curve(StringSlice param_name, const OutputCurve& value) {}
+		virtual void on_node_end() {}
+
+		// Called after all nodes, only for connections between nodes that were passed to on_node_begin
+		virtual void on_connection(StringSlice source_node, StringSlice source_socket, StringSlice dest_node, StringSlice dest_socket) {}
+	};
+
+	// Decodes a graph straight into a visitor without building a CyclesNodeGraph
+	// Nodes keep the names they are stored under, graphs written by the editor are already in canonical order
+	// If two nodes share a name both are visited and connections refer to the later one
+	// Slices are valid until decode_graph returns
+	// Returns false if the graph is not valid, calls made before the problem was found still happen
+	bool decode_graph(const std::string& encoded_graph, GraphVisitor& visitor);
+	bool decode_graph(SerializedGraphView encoded_graph, GraphVisitor& visitor);
+	// Reads the graph in chunks, memory use depends on the largest node rather than the size of the graph
+	// Node names passed to on_node_begin are valid until decode_graph returns, every other slice only until its callback returns
+	bool decode_graph(GraphInputStream& encoded_graph, GraphVisitor& visitor);
+
+	// Decodes many graphs at once on a pool of worker threads, results are in the same order as the input
+	// A thread_count of 0 uses one thread per hardware core
+	std::vector<CyclesNodeGraph> decode_graphs(const std::vector<std::string>& encoded_graphs, unsigned int thread_count = 0, OutputParamLayout layout = OutputParamLayout::Maps);
+	std::vector<CyclesNodeGraph> decode_graphs(const std::vector<SerializedGraphView>& encoded_graphs, unsigned int thread_count = 0, OutputParamLayout layout = OutputParamLayout::Maps);
+
 }
@@ -34,7 +34,72 @@ void CyclesShaderEditor::GraphEditor::set_target_frame_rate(double fps)
 	main_window->set_target_frame_rate(fps);
 }
 
+void CyclesShaderEditor::GraphEditor::set_redraw_mode(RedrawMode mode)
+{
+	main_window->set_redraw_mode(mode);
+}
+
+void CyclesShaderEditor::GraphEditor::request_redraw()
+{
+	main_window->request_redraw();
+}
+
+CyclesShaderEditor::FramePhaseStats CyclesShaderEditor::GraphEditor::get_frame_phase_stats(FramePhase phase) const
+{
+	return main_window->get_frame_phase_stats(phase);
+}
+
+void CyclesShaderEditor::GraphEditor::set_frame_timing_overlay(bool enabled)
+{
+	main_window->set_frame_timing_overlay(enabled);
+}
+
+void CyclesShaderEditor::GraphEditor::set_output_format(SerializedGraphFormat format)
+{
+	main_window->set_output_format(format);
+}
+
 void CyclesShaderEditor::GraphEditor::load_serialized_graph(std::string graph)
 {
 	main_window->load_serialized_graph(graph);
 }
+
+unsigned long long CyclesShaderEditor::GraphEditor::get_graph_hash() const
+{
+	return main_window->get_graph_hash();
+}
+
+bool CyclesShaderEditor::GraphEditor::apply_graph_patch(const GraphPatch& patch)
+{
+	return main_window->apply_graph_patch(patch);
+}
+
+void CyclesShaderEditor::GraphEditor::set_undo_memory_budget(size_t bytes)
+{
+	main_window->set_undo_memory_budget(bytes);
+}
+
+size_t CyclesShaderEditor::GraphEditor::get_undo_memory_usage() const
+{
+	return main_window->get_undo_memory_usage();
+}
+
+void CyclesShaderEditor::GraphEditor::begin_undo_transaction()
+{
+	main_window->begin_undo_transaction();
+}
+
+void CyclesShaderEditor::GraphEditor::commit_undo_transaction()
+{
+	main_window->commit_undo_transaction();
+}
+
+bool CyclesShaderEditor::GraphEditor::enable_edit_journal(PathString path)
+{
+	return main_window->enable_edit_journal(path);
+}
+
+void CyclesShaderEditor::GraphEditor::disable_edit_journal()
+{
+	main_window->disable_edit_journal();
+}
@@ -1,12 +1,23 @@
 #pragma once
 
+#include "frame_timing.h"
+#include "output.h"
 #include "util_platform.h"
 
+#include <cstddef>
 #include <string>
 
 namespace CyclesShaderEditor {
 
 	class EditorMainWindow;
+	struct GraphPatch;
+
+	enum class RedrawMode {
+		// Draws every iteration of the window loop, paced to the target frame rate
+		Continuous,
+		// Draws only after input or a change to the graph, otherwise the window loop waits for input
+		OnDemand,
+	};
 
 	class GraphEditor {
 	public:
@@ -20,9 +31,54 @@ namespace CyclesShaderEditor {
 
 		void set_target_frame_rate(double fps);
 
+		// Continuous by default
+		// In OnDemand mode run_window_loop_iteration blocks for up to a quarter of a second when nothing has changed,
+		// and returns without drawing
+		void set_redraw_mode(RedrawMode mode);
+		// Draws the next frame in OnDemand mode, for changes the editor can not see for itself
+		// Can be called from any thread, it wakes a loop that is waiting for input
+		void request_redraw();
+
+		// Durations of each part of the most recent frames the window drew, see frame_timing.h
+		FramePhaseStats get_frame_phase_stats(FramePhase phase) const;
+		// Shows the average and 99th percentile of the main phases in the status bar
+		void set_frame_timing_overlay(bool enabled);
+
+		// Format of serialized_output, text by default
+		void set_output_format(SerializedGraphFormat format);
+
 		void load_serialized_graph(std::string graph);
 
+		// Structural hash of the graph in the editor as of the last completed edit
+		// This is the same value CyclesNodeGraph::get_structural_hash gives for the graph once it is saved
+		unsigned long long get_graph_hash() const;
+
+		// Changes the graph in the editor by a patch made against the graph as the editor would save it now, for example
+		// one from diff_graphs against a graph decoded from serialized_output right after a save, see graph_patch.h
+		// The change can be undone like any other edit, returns false if the patch does not fit the graph
+		bool apply_graph_patch(const GraphPatch& patch);
+
+		// Undo history is kept as changes between states and is trimmed, oldest first, to stay within this many bytes
+		void set_undo_memory_budget(size_t bytes);
+		// Bytes held by the undo history
+		size_t get_undo_memory_usage() const;
+
+		// Edits made between these two calls, including apply_graph_patch, become a single undo step that is recorded on commit
+		// Transactions can be nested, only the outermost commit records the step
+		void begin_undo_transaction();
+		void commit_undo_transaction();
+
+		// Keeps a journal of every edit since the last save or load at path, see edit_journal.h
+		// If the process dies, recover_edit_journal gives back the graph as it was at the last edit
+		// Any file already at path is replaced, returns false if it can not be written
+		bool enable_edit_journal(PathString path);
+		void disable_edit_journal();
+
 		std::string serialized_output;
+		// Encoded GraphPatch from the graph given by the previous save, or by load_serialized_graph, to this one
+		// Applying every patch in turn keeps a renderer's CyclesNodeGraph up to date without decoding serialized_output,
+		// only its node names and order differ from a freshly decoded graph
+		std::string serialized_output_patch;
 		bool output_updated = false;
 
 	private:
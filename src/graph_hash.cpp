@@ -0,0 +1,255 @@
+#include "graph_hash.h"
+
+#include <algorithm>
+#include <cstring>
+#include <unordered_map>
+
+#include "node_registry.h"
+#include "output_visit.h"
+#include "util_bytes.h"
+
+// Used in place of a node's hash when a connection loops back to a node that is still being hashed
+static const unsigned long long LOOP_HASH = 0x6c6f6f705f6e6f64ull;
+
+// Adds each param of a node to the hash, see visit_output_params
+// Each kind of param gets its own tag so a float and an int with the same name and bits do not hash the same
+class ParamHasher {
+public:
+	ParamHasher(unsigned long long hash) : hash(hash) {}
+
+	void visit_float(const std::string& name, float value)
+	{
+		hash = CyclesShaderEditor::mix_hash(mix_param_name(1, name), value);
+	}
+
+	void visit_float3(const std::string& name, const CyclesShaderEditor::Float3& value)
+	{
+		hash = CyclesShaderEditor::mix_hash(CyclesShaderEditor::mix_hash(CyclesShaderEditor::mix_hash(mix_param_name(2, name), value.x), value.y), value.z);
+	}
+
+	void visit_string(const std::string& name, const std::string& value)
+	{
+		hash = CyclesShaderEditor::mix_hash(mix_param_name(3, name), value);
+	}
+
+	void visit_int(const std::string& name, int value)
+	{
+		hash = CyclesShaderEditor::mix_hash(mix_param_name(4, name), static_cast<unsigned long long>(static_cast<unsigned int>(value)));
+	}
+
+	void visit_bool(const std::string& name, bool value)
+	{
+		hash = CyclesShaderEditor::mix_hash(mix_param_name(5, name), static_cast<unsigned long long>(value ? 1 : 0));
+	}
+
+	// Samples are worked out from the control points and interpolation, so they are left out
+	void visit_curve(const std::string& name, const CyclesShaderEditor::OutputCurve& value)
+	{
+		hash = mix_param_name(6, name);
+		hash = CyclesShaderEditor::mix_hash(hash, static_cast<unsigned long long>(static_cast<unsigned int>(value.enum_curve_interp)));
+		hash = CyclesShaderEditor::mix_hash(hash, static_cast<unsigned long long>(value.control_points.size()));
+		for (const CyclesShaderEditor::Float2& point : value.control_points) {
+			hash = CyclesShaderEditor::mix_hash(CyclesShaderEditor::mix_hash(hash, point.x), point.y);
+		}
+	}
+
+	unsigned long long hash;
+
+private:
+	unsigned long long mix_param_name(unsigned long long kind_tag, const std::string& name) const
+	{
+		return CyclesShaderEditor::mix_hash(CyclesShaderEditor::mix_hash(hash, kind_tag), name);
+	}
+};
+
+unsigned long long CyclesShaderEditor::mix_hash(const unsigned long long hash, const unsigned long long value)
+{
+	unsigned long long x = (hash ^ value) + 0x9e3779b97f4a7c15ull;
+	x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ull;
+	x = (x ^ (x >> 27)) * 0x94d049bb133111ebull;
+	return x ^ (x >> 31);
+}
+
+unsigned long long CyclesShaderEditor::mix_hash(const unsigned long long hash, float value)
+{
+	if (value == 0.0f) {
+		value = 0.0f;
+	}
+	unsigned int bits = 0;
+	memcpy(&bits, &value, sizeof(bits));
+	return mix_hash(hash, static_cast<unsigned long long>(bits));
+}
+
+unsigned long long CyclesShaderEditor::mix_hash(const unsigned long long hash, const char* const data, const size_t length)
+{
+	return mix_hash(mix_hash(hash, static_cast<unsigned long long>(length)), hash_bytes(data, length));
+}
+
+unsigned long long CyclesShaderEditor::mix_hash(const unsigned long long hash, const std::string& value)
+{
+	return mix_hash(hash, value.data(), value.size());
+}
+
+unsigned long long CyclesShaderEditor::hash_node_content(const OutputNode& node)
+{
+	// The type's code is used rather than its enum value so the hash does not depend on how CyclesNodeType is numbered
+	unsigned long long hash = 0;
+	const NodeTypeInfo* const type_info = get_node_type_info(node.type);
+	if (type_info != nullptr) {
+		hash = mix_hash(hash, type_info->code, strlen(type_info->code));
+	}
+	else {
+		hash = mix_hash(hash, static_cast<unsigned long long>(node.type));
+	}
+
+	hash = mix_hash(hash, static_cast<unsigned long long>(get_output_param_count(node)));
+	ParamHasher param_hasher(hash);
+	visit_output_params(node, param_hasher);
+
+	return param_hasher.hash;
+}
+
+static bool hashed_input_less(const CyclesShaderEditor::GraphHashScratch::Input& a, const CyclesShaderEditor::GraphHashScratch::Input& b)
+{
+	if (*a.dest_socket != *b.dest_socket) {
+		return *a.dest_socket < *b.dest_socket;
+	}
+	if (*a.source_socket != *b.source_socket) {
+		return *a.source_socket < *b.source_socket;
+	}
+	return a.source_hash < b.source_hash;
+}
+
+unsigned long long CyclesShaderEditor::hash_graph_node(const unsigned long long content_hash, std::vector<GraphHashScratch::Input>& inputs)
+{
+	std::sort(inputs.begin(), inputs.end(), hashed_input_less);
+
+	unsigned long long hash = mix_hash(content_hash, static_cast<unsigned long long>(inputs.size()));
+	for (const GraphHashScratch::Input& input : inputs) {
+		hash = mix_hash(hash, *input.dest_socket);
+		hash = mix_hash(hash, *input.source_socket);
+		hash = mix_hash(hash, input.source_hash);
+	}
+	return hash;
+}
+
+unsigned long long CyclesShaderEditor::hash_graph_structure(const std::vector<unsigned long long>& content_hashes, const size_t output_node, std::vector<GraphHashEdge>& edges)
+{
+	GraphHashScratch scratch;
+	return hash_graph_structure(content_hashes, output_node, edges, scratch);
+}
+
+unsigned long long CyclesShaderEditor::hash_graph_structure(const std::vector<unsigned long long>& content_hashes, const size_t output_node, std::vector<GraphHashEdge>& edges, GraphHashScratch& scratch)
+{
+	typedef GraphHashScratch::VisitState HashVisitState;
+
+	const size_t node_count = content_hashes.size();
+	if (output_node >= node_count) {
+		return 0;
+	}
+
+	edges.erase(std::remove_if(edges.begin(), edges.end(), [node_count](const GraphHashEdge& edge) {
+		return edge.source_node >= node_count || edge.dest_node >= node_count;
+	}), edges.end());
+
+	// Edges grouped by destination, each node's inputs are the range first_edge[node] to first_edge[node + 1]
+	// Inputs are ordered by content rather than by node index, so graphs with loops are still walked in the same order
+	// however their nodes are listed
+	std::sort(edges.begin(), edges.end(), [&content_hashes](const GraphHashEdge& a, const GraphHashEdge& b) {
+		if (a.dest_node != b.dest_node) {
+			return a.dest_node < b.dest_node;
+		}
+		if (*a.dest_socket != *b.dest_socket) {
+			return *a.dest_socket < *b.dest_socket;
+		}
+		if (*a.source_socket != *b.source_socket) {
+			return *a.source_socket < *b.source_socket;
+		}
+		return content_hashes[a.source_node] < content_hashes[b.source_node];
+	});
+	std::vector<size_t>& first_edge = scratch.first_edge;
+	first_edge.assign(node_count + 1, 0);
+	for (const GraphHashEdge& edge : edges) {
+		first_edge[edge.dest_node + 1]++;
+	}
+	for (size_t i = 0; i < node_count; i++) {
+		first_edge[i + 1] += first_edge[i];
+	}
+
+	// Depth-first from the output without recursion, long chains of nodes would otherwise overflow the stack
+	// A node is hashed when it comes back to the top of the stack, by then everything connected to its inputs is done
+	std::vector<HashVisitState>& states = scratch.states;
+	states.assign(node_count, HashVisitState::NotVisited);
+	std::vector<unsigned long long>& node_hashes = scratch.node_hashes;
+	node_hashes.assign(node_count, 0);
+	std::vector<size_t>& stack = scratch.stack;
+	stack.clear();
+	std::vector<GraphHashScratch::Input>& inputs = scratch.inputs;
+	stack.push_back(output_node);
+	while (stack.empty() == false) {
+		const size_t node = stack.back();
+		if (states[node] == HashVisitState::NotVisited) {
+			states[node] = HashVisitState::InProgress;
+			for (size_t i = first_edge[node]; i < first_edge[node + 1]; i++) {
+				if (states[edges[i].source_node] == HashVisitState::NotVisited) {
+					stack.push_back(edges[i].source_node);
+				}
+			}
+			continue;
+		}
+
+		stack.pop_back();
+		if (states[node] == HashVisitState::Done) {
+			continue;
+		}
+
+		inputs.clear();
+		for (size_t i = first_edge[node]; i < first_edge[node + 1]; i++) {
+			const GraphHashEdge& edge = edges[i];
+			GraphHashScratch::Input input;
+			input.dest_socket = edge.dest_socket;
+			input.source_socket = edge.source_socket;
+			input.source_hash = (states[edge.source_node] == HashVisitState::Done) ? node_hashes[edge.source_node] : LOOP_HASH;
+			inputs.push_back(input);
+		}
+		node_hashes[node] = hash_graph_node(content_hashes[node], inputs);
+		states[node] = HashVisitState::Done;
+	}
+
+	return node_hashes[output_node];
+}
+
+unsigned long long CyclesShaderEditor::hash_graph_structure(const std::vector<OutputNode>& nodes, const std::vector<OutputConnection>& connections)
+{
+	std::vector<unsigned long long> content_hashes;
+	content_hashes.reserve(nodes.size());
+	std::unordered_map<std::string, size_t> node_indices;
+	node_indices.reserve(nodes.size());
+	size_t output_node = nodes.size();
+	for (size_t i = 0; i < nodes.size(); i++) {
+		content_hashes.push_back(hash_node_content(nodes[i]));
+		node_indices.insert(std::make_pair(nodes[i].name, i));
+		if (nodes[i].type == CyclesNodeType::MaterialOutput && output_node == nodes.size()) {
+			output_node = i;
+		}
+	}
+
+	std::vector<GraphHashEdge> edges;
+	edges.reserve(connections.size());
+	for (const OutputConnection& connection : connections) {
+		const std::unordered_map<std::string, size_t>::const_iterator source_iter = node_indices.find(connection.source_node);
+		const std::unordered_map<std::string, size_t>::const_iterator dest_iter = node_indices.find(connection.dest_node);
+		if (source_iter == node_indices.end() || dest_iter == node_indices.end()) {
+			continue;
+		}
+
+		GraphHashEdge edge;
+		edge.source_node = source_iter->second;
+		edge.source_socket = &connection.source_socket;
+		edge.dest_node = dest_iter->second;
+		edge.dest_socket = &connection.dest_socket;
+		edges.push_back(edge);
+	}
+
+	return hash_graph_structure(content_hashes, output_node, edges);
+}
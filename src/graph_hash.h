@@ -0,0 +1,67 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+#include "output.h"
+
+namespace CyclesShaderEditor {
+
+	// Connection between two nodes given by their positions in a node list
+	struct GraphHashEdge {
+		size_t source_node;
+		const std::string* source_socket;
+		size_t dest_node;
+		const std::string* dest_socket;
+	};
+
+	// Working lists of hash_graph_structure, passing the same one to every call lets their memory be reused
+	struct GraphHashScratch {
+		// One connected input of the node being hashed
+		struct Input {
+			const std::string* dest_socket;
+			const std::string* source_socket;
+			unsigned long long source_hash;
+		};
+
+		enum class VisitState : unsigned char {
+			NotVisited,
+			InProgress,
+			Done,
+		};
+
+		std::vector<size_t> first_edge;
+		std::vector<VisitState> states;
+		std::vector<unsigned long long> node_hashes;
+		std::vector<size_t> stack;
+		std::vector<Input> inputs;
+	};
+
+	// splitmix64 finalizer, every bit of the result depends on every bit of the hash and the value
+	unsigned long long mix_hash(unsigned long long hash, unsigned long long value);
+	// -0 and 0 give the same hash, they compare equal and behave the same in a shader
+	unsigned long long mix_hash(unsigned long long hash, float value);
+	// Bytes are hashed with FNV-1a, see hash_bytes, and mixed in along with their length
+	unsigned long long mix_hash(unsigned long long hash, const char* data, size_t length);
+	unsigned long long mix_hash(unsigned long long hash, const std::string& value);
+
+	// Hash of a node's type and parameter values, the node's name and position are not included
+	unsigned long long hash_node_content(const OutputNode& node);
+
+	// Hash of one node of a graph with no loops, from its content hash and the hashes of the nodes connected to its inputs
+	// This is the hash hash_graph_structure gives each node, so it can be kept per node and only worked out again for a node
+	// whose content or inputs changed and for the nodes downstream of it
+	// inputs is sorted in place
+	unsigned long long hash_graph_node(unsigned long long content_hash, std::vector<GraphHashScratch::Input>& inputs);
+
+	// Merkle-style hash of the part of a graph that feeds into output_node
+	// Each node's hash combines its content hash with the hashes of the nodes connected to its inputs, so nodes that
+	// can not reach the output have no effect on the result
+	// Returns 0 if output_node is not a valid index, edges is sorted in place
+	unsigned long long hash_graph_structure(const std::vector<unsigned long long>& content_hashes, size_t output_node, std::vector<GraphHashEdge>& edges);
+	unsigned long long hash_graph_structure(const std::vector<unsigned long long>& content_hashes, size_t output_node, std::vector<GraphHashEdge>& edges, GraphHashScratch& scratch);
+
+	unsigned long long hash_graph_structure(const std::vector<OutputNode>& nodes, const std::vector<OutputConnection>& connections);
+
+}
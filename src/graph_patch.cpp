@@ -0,0 +1,1157 @@
+#include "graph_patch.h"
+
+#include <algorithm>
+#include <functional>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+
+#include "config.h"
+#include "curve.h"
+#include "graph_hash.h"
+#include "node_registry.h"
+#include "node_schema.h"
+#include "point2.h"
+#include "util_number.h"
+
+static const char SEPARATOR = '|';
+
+static const char* PATCH_MAGIC_WORD = "cycles_patch";
+static const char* PATCH_VERSION = "1";
+
+static const char* SECTION_LABEL_REMOVED_NODES = "removed_nodes";
+static const char* SECTION_LABEL_ADDED_NODES = "added_nodes";
+static const char* SECTION_LABEL_CHANGED_NODES = "changed_nodes";
+static const char* SECTION_LABEL_REMOVED_CONNECTIONS = "removed_connections";
+static const char* SECTION_LABEL_ADDED_CONNECTIONS = "added_connections";
+
+static const size_t NO_MATCH = static_cast<size_t>(-1);
+
+static unsigned long long get_position_key(const CyclesShaderEditor::OutputNode& node, unsigned long long hash)
+{
+	return CyclesShaderEditor::mix_hash(CyclesShaderEditor::mix_hash(hash, node.world_x), node.world_y);
+}
+
+static bool same_position(const CyclesShaderEditor::OutputNode& a, const CyclesShaderEditor::OutputNode& b)
+{
+	return a.world_x == b.world_x && a.world_y == b.world_y;
+}
+
+// NaN is treated as equal to itself so a graph holding one does not always differ from itself
+static bool same_float(float a, float b)
+{
+	return a == b || (a != a && b != b);
+}
+
+static bool same_curve(const CyclesShaderEditor::OutputCurve& a, const CyclesShaderEditor::OutputCurve& b)
+{
+	if (a.enum_curve_interp != b.enum_curve_interp || a.control_points.size() != b.control_points.size() || a.samples.size() != b.samples.size()) {
+		return false;
+	}
+	for (size_t i = 0; i < a.control_points.size(); i++) {
+		if (!same_float(a.control_points[i].x, b.control_points[i].x) || !same_float(a.control_points[i].y, b.control_points[i].y)) {
+			return false;
+		}
+	}
+	for (size_t i = 0; i < a.samples.size(); i++) {
+		if (!same_float(a.samples[i], b.samples[i])) {
+			return false;
+		}
+	}
+	return true;
+}
+
+static bool same_param_value(const CyclesShaderEditor::OutputParams& a_params, const CyclesShaderEditor::OutputParam& a, const CyclesShaderEditor::OutputParams& b_params, const CyclesShaderEditor::OutputParam& b)
+{
+	using namespace CyclesShaderEditor;
+
+	if (a.type != b.type) {
+		return false;
+	}
+
+	switch (a.type) {
+	case OutputParamType::Float:
+		return same_float(a.float3_value.x, b.float3_value.x);
+	case OutputParamType::Float3:
+		return same_float(a.float3_value.x, b.float3_value.x) && same_float(a.float3_value.y, b.float3_value.y) && same_float(a.float3_value.z, b.float3_value.z);
+	case OutputParamType::String:
+		return a_params.string_values[a.value_index] == b_params.string_values[b.value_index];
+	case OutputParamType::Int:
+		return a.int_value == b.int_value;
+	case OutputParamType::Bool:
+		return a.bool_value == b.bool_value;
+	case OutputParamType::Curve:
+		return same_curve(a_params.curve_values[a.value_index], b_params.curve_values[b.value_index]);
+	}
+
+	return false;
+}
+
+// Copies one param and its value from source into target
+static void copy_param(const CyclesShaderEditor::OutputParams& source, const CyclesShaderEditor::OutputParam& param, CyclesShaderEditor::OutputParams& target)
+{
+	using namespace CyclesShaderEditor;
+
+	switch (param.type) {
+	case OutputParamType::Float:
+		target.set_float(param.id, param.float3_value.x);
+		break;
+	case OutputParamType::Float3:
+		target.set_float3(param.id, param.float3_value);
+		break;
+	case OutputParamType::String:
+		target.set_string(param.id, source.string_values[param.value_index]);
+		break;
+	case OutputParamType::Int:
+		target.set_int(param.id, param.int_value);
+		break;
+	case OutputParamType::Bool:
+		target.set_bool(param.id, param.bool_value);
+		break;
+	case OutputParamType::Curve:
+		target.set_curve(param.id, source.curve_values[param.value_index]);
+		break;
+	}
+}
+
+static bool node_uses_maps(const CyclesShaderEditor::OutputNode& node)
+{
+	return !node.float_values.empty() || !node.float3_values.empty() || !node.string_values.empty() ||
+		!node.int_values.empty() || !node.bool_values.empty() || !node.curve_values.empty();
+}
+
+// Copy of a node with its params in the flat form, params the flat form can not hold are dropped
+static CyclesShaderEditor::OutputNode get_flat_node(const CyclesShaderEditor::OutputNode& node)
+{
+	CyclesShaderEditor::OutputNode result = node;
+	CyclesShaderEditor::flatten_patch_node(result);
+	return result;
+}
+
+// Params of a node in the flat form, a node that uses the maps is flattened into storage
+static const CyclesShaderEditor::OutputParams& get_flat_params(const CyclesShaderEditor::OutputNode& node, CyclesShaderEditor::OutputNode& storage)
+{
+	if (!node_uses_maps(node)) {
+		return node.params;
+	}
+	storage = get_flat_node(node);
+	return storage.params;
+}
+
+static void erase_node_param(CyclesShaderEditor::OutputNode& node, CyclesShaderEditor::OutputParamId id)
+{
+	const std::string& name = CyclesShaderEditor::get_output_param_name(id);
+	node.params.erase(id);
+	node.float_values.erase(name);
+	node.float3_values.erase(name);
+	node.string_values.erase(name);
+	node.int_values.erase(name);
+	node.bool_values.erase(name);
+	node.curve_values.erase(name);
+}
+
+// Sets a param in whichever form the node already uses
+static void set_node_param(CyclesShaderEditor::OutputNode& node, const CyclesShaderEditor::OutputParams& source, const CyclesShaderEditor::OutputParam& param)
+{
+	using namespace CyclesShaderEditor;
+
+	if (!node_uses_maps(node)) {
+		copy_param(source, param, node.params);
+		return;
+	}
+
+	// A param that changes type must not be left behind in its old map
+	erase_node_param(node, param.id);
+	const std::string& name = get_output_param_name(param.id);
+	switch (param.type) {
+	case OutputParamType::Float:
+		node.float_values[name] = param.float3_value.x;
+		break;
+	case OutputParamType::Float3:
+		node.float3_values[name] = param.float3_value;
+		break;
+	case OutputParamType::String:
+		node.string_values[name] = source.string_values[param.value_index];
+		break;
+	case OutputParamType::Int:
+		node.int_values[name] = param.int_value;
+		break;
+	case OutputParamType::Bool:
+		node.bool_values[name] = param.bool_value;
+		break;
+	case OutputParamType::Curve:
+		node.curve_values[name] = source.curve_values[param.value_index];
+		break;
+	}
+}
+
+// Records every param that differs between two nodes, both param lists are sorted by id so they are walked together
+static void diff_params(const CyclesShaderEditor::OutputParams& from, const CyclesShaderEditor::OutputParams& to, CyclesShaderEditor::GraphPatchNodeChange& change)
+{
+	size_t from_index = 0;
+	size_t to_index = 0;
+	while (from_index < from.params.size() || to_index < to.params.size()) {
+		if (to_index == to.params.size() || (from_index < from.params.size() && from.params[from_index].id < to.params[to_index].id)) {
+			copy_param(from, from.params[from_index], change.old_params);
+			from_index++;
+		}
+		else if (from_index == from.params.size() || to.params[to_index].id < from.params[from_index].id) {
+			copy_param(to, to.params[to_index], change.new_params);
+			to_index++;
+		}
+		else {
+			if (!same_param_value(from, from.params[from_index], to, to.params[to_index])) {
+				copy_param(from, from.params[from_index], change.old_params);
+				copy_param(to, to.params[to_index], change.new_params);
+			}
+			from_index++;
+			to_index++;
+		}
+	}
+}
+
+// One round of matching, each node of to that is still unmatched is paired with the first unmatched node of from that has
+// the same key and passes same_node
+// Keys only pick the bucket, same_node decides
+template <typename FromKeyFunc, typename ToKeyFunc, typename SameFunc>
+static void match_nodes(std::vector<size_t>& from_match, std::vector<size_t>& to_match, FromKeyFunc from_key, ToKeyFunc to_key, SameFunc same_node)
+{
+	struct Bucket {
+		std::vector<size_t> nodes;
+		// Everything before this is already matched
+		size_t first_unmatched = 0;
+	};
+
+	std::unordered_map<unsigned long long, Bucket> buckets;
+	for (size_t i = 0; i < from_match.size(); i++) {
+		if (from_match[i] == NO_MATCH) {
+			buckets[from_key(i)].nodes.push_back(i);
+		}
+	}
+	if (buckets.empty()) {
+		return;
+	}
+
+	for (size_t j = 0; j < to_match.size(); j++) {
+		if (to_match[j] != NO_MATCH) {
+			continue;
+		}
+		const typename std::unordered_map<unsigned long long, Bucket>::iterator bucket_iter = buckets.find(to_key(j));
+		if (bucket_iter == buckets.end()) {
+			continue;
+		}
+		Bucket& bucket = bucket_iter->second;
+		while (bucket.first_unmatched < bucket.nodes.size() && from_match[bucket.nodes[bucket.first_unmatched]] != NO_MATCH) {
+			bucket.first_unmatched++;
+		}
+		for (size_t k = bucket.first_unmatched; k < bucket.nodes.size(); k++) {
+			const size_t i = bucket.nodes[k];
+			if (from_match[i] == NO_MATCH && same_node(i, j)) {
+				from_match[i] = j;
+				to_match[j] = i;
+				break;
+			}
+		}
+	}
+}
+
+template <typename T>
+static size_t get_vector_memory_size(const std::vector<T>& values)
+{
+	return values.capacity() * sizeof(T);
+}
+
+static size_t get_string_memory_size(const std::string& value)
+{
+	// Short strings are held inside the string object
+	return (value.capacity() > 15) ? value.capacity() + 1 : 0;
+}
+
+static size_t get_curve_memory_size(const CyclesShaderEditor::OutputCurve& curve)
+{
+	return get_vector_memory_size(curve.control_points) + get_vector_memory_size(curve.samples);
+}
+
+static size_t get_params_memory_size(const CyclesShaderEditor::OutputParams& params)
+{
+	size_t result = get_vector_memory_size(params.params) + get_vector_memory_size(params.string_values) + get_vector_memory_size(params.curve_values);
+	for (const std::string& value : params.string_values) {
+		result += get_string_memory_size(value);
+	}
+	for (const CyclesShaderEditor::OutputCurve& curve : params.curve_values) {
+		result += get_curve_memory_size(curve);
+	}
+	return result;
+}
+
+// Each map entry is counted as its value plus a tree node of about 64 bytes
+template <typename T>
+static size_t get_map_memory_size(const std::map<std::string, T>& values)
+{
+	size_t result = 0;
+	for (const std::pair<const std::string, T>& this_pair : values) {
+		result += 64 + sizeof(T) + get_string_memory_size(this_pair.first);
+	}
+	return result;
+}
+
+static size_t get_node_memory_size(const CyclesShaderEditor::OutputNode& node)
+{
+	size_t result = get_string_memory_size(node.name) + get_params_memory_size(node.params);
+	result += get_map_memory_size(node.float_values) + get_map_memory_size(node.float3_values) + get_map_memory_size(node.string_values);
+	result += get_map_memory_size(node.int_values) + get_map_memory_size(node.bool_values) + get_map_memory_size(node.curve_values);
+	for (const std::pair<const std::string, std::string>& this_pair : node.string_values) {
+		result += get_string_memory_size(this_pair.second);
+	}
+	for (const std::pair<const std::string, CyclesShaderEditor::OutputCurve>& this_pair : node.curve_values) {
+		result += get_curve_memory_size(this_pair.second);
+	}
+	return result;
+}
+
+static size_t get_connection_memory_size(const CyclesShaderEditor::OutputConnection& connection)
+{
+	return get_string_memory_size(connection.source_node) + get_string_memory_size(connection.source_socket) +
+		get_string_memory_size(connection.dest_node) + get_string_memory_size(connection.dest_socket);
+}
+
+bool CyclesShaderEditor::GraphPatch::empty() const
+{
+	return removed_nodes.empty() && added_nodes.empty() && changed_nodes.empty() && removed_connections.empty() && added_connections.empty();
+}
+
+size_t CyclesShaderEditor::GraphPatch::get_memory_size() const
+{
+	size_t result = sizeof(GraphPatch);
+	result += get_vector_memory_size(removed_nodes) + get_vector_memory_size(added_nodes) + get_vector_memory_size(changed_nodes);
+	result += get_vector_memory_size(removed_connections) + get_vector_memory_size(added_connections);
+	for (const OutputNode& node : removed_nodes) {
+		result += get_node_memory_size(node);
+	}
+	for (const OutputNode& node : added_nodes) {
+		result += get_node_memory_size(node);
+	}
+	for (const GraphPatchNodeChange& change : changed_nodes) {
+		result += get_string_memory_size(change.name) + get_params_memory_size(change.old_params) + get_params_memory_size(change.new_params);
+	}
+	for (const OutputConnection& connection : removed_connections) {
+		result += get_connection_memory_size(connection);
+	}
+	for (const OutputConnection& connection : added_connections) {
+		result += get_connection_memory_size(connection);
+	}
+	return result;
+}
+
+void CyclesShaderEditor::GraphPatchIndex::build(const CyclesNodeGraph& graph)
+{
+	clear();
+	node_indices.reserve(graph.nodes.size());
+	for (size_t i = 0; i < graph.nodes.size(); i++) {
+		node_indices[graph.nodes[i].name] = i;
+	}
+	connection_indices.reserve(graph.connections.size());
+	for (size_t i = 0; i < graph.connections.size(); i++) {
+		connection_indices.insert(std::make_pair(get_connection_key(graph.connections[i]), i));
+	}
+}
+
+void CyclesShaderEditor::GraphPatchIndex::clear()
+{
+	node_indices.clear();
+	connection_indices.clear();
+}
+
+std::string CyclesShaderEditor::get_connection_key(const OutputConnection& connection)
+{
+	std::string result;
+	result.reserve(connection.source_node.size() + connection.source_socket.size() + connection.dest_node.size() + connection.dest_socket.size() + 3);
+	result.append(connection.source_node);
+	result.push_back(SEPARATOR);
+	result.append(connection.source_socket);
+	result.push_back(SEPARATOR);
+	result.append(connection.dest_node);
+	result.push_back(SEPARATOR);
+	result.append(connection.dest_socket);
+	return result;
+}
+
+CyclesShaderEditor::GraphPatch CyclesShaderEditor::diff_graphs(const CyclesNodeGraph& from, const CyclesNodeGraph& to)
+{
+	GraphPatch patch;
+
+	std::vector<unsigned long long> from_hashes;
+	from_hashes.reserve(from.nodes.size());
+	for (const OutputNode& node : from.nodes) {
+		from_hashes.push_back(hash_node_content(node));
+	}
+	std::vector<unsigned long long> to_hashes;
+	to_hashes.reserve(to.nodes.size());
+	for (const OutputNode& node : to.nodes) {
+		to_hashes.push_back(hash_node_content(node));
+	}
+
+	// Position in the other graph of each node's match, NO_MATCH for nodes only in one graph
+	std::vector<size_t> from_match(from.nodes.size(), NO_MATCH);
+	std::vector<size_t> to_match(to.nodes.size(), NO_MATCH);
+
+	// Untouched nodes
+	match_nodes(from_match, to_match,
+		[&](size_t i) { return get_position_key(from.nodes[i], from_hashes[i]); },
+		[&](size_t j) { return get_position_key(to.nodes[j], to_hashes[j]); },
+		[&](size_t i, size_t j) { return from_hashes[i] == to_hashes[j] && same_position(from.nodes[i], to.nodes[j]); });
+	// Nodes with edited params
+	match_nodes(from_match, to_match,
+		[&](size_t i) { return get_position_key(from.nodes[i], static_cast<unsigned long long>(from.nodes[i].type)); },
+		[&](size_t j) { return get_position_key(to.nodes[j], static_cast<unsigned long long>(to.nodes[j].type)); },
+		[&](size_t i, size_t j) { return from.nodes[i].type == to.nodes[j].type && same_position(from.nodes[i], to.nodes[j]); });
+	// Moved nodes
+	match_nodes(from_match, to_match,
+		[&](size_t i) { return from_hashes[i]; },
+		[&](size_t j) { return to_hashes[j]; },
+		[&](size_t i, size_t j) { return from_hashes[i] == to_hashes[j]; });
+	// Nodes that were moved and edited can only be told apart by name
+	const std::hash<std::string> hash_string;
+	match_nodes(from_match, to_match,
+		[&](size_t i) { return mix_hash(static_cast<unsigned long long>(from.nodes[i].type), static_cast<unsigned long long>(hash_string(from.nodes[i].name))); },
+		[&](size_t j) { return mix_hash(static_cast<unsigned long long>(to.nodes[j].type), static_cast<unsigned long long>(hash_string(to.nodes[j].name))); },
+		[&](size_t i, size_t j) { return from.nodes[i].type == to.nodes[j].type && from.nodes[i].name == to.nodes[j].name; });
+
+	// Names that stay in the graph
+	std::unordered_set<std::string> used_names;
+	used_names.reserve(from.nodes.size());
+	OutputNode from_storage;
+	OutputNode to_storage;
+	for (size_t i = 0; i < from.nodes.size(); i++) {
+		const OutputNode& from_node = from.nodes[i];
+		if (from_match[i] == NO_MATCH) {
+			patch.removed_nodes.push_back(get_flat_node(from_node));
+			continue;
+		}
+		used_names.insert(from_node.name);
+
+		const OutputNode& to_node = to.nodes[from_match[i]];
+		GraphPatchNodeChange change;
+		diff_params(get_flat_params(from_node, from_storage), get_flat_params(to_node, to_storage), change);
+		if (change.old_params.empty() && change.new_params.empty() && same_position(from_node, to_node)) {
+			continue;
+		}
+		change.name = from_node.name;
+		change.old_world_x = from_node.world_x;
+		change.old_world_y = from_node.world_y;
+		change.new_world_x = to_node.world_x;
+		change.new_world_y = to_node.world_y;
+		patch.changed_nodes.push_back(std::move(change));
+	}
+
+	// Name of each node of to once the patch is applied
+	std::vector<const std::string*> to_names(to.nodes.size(), nullptr);
+	// Reserved up front so names of added nodes can be pointed to
+	patch.added_nodes.reserve(std::count(to_match.begin(), to_match.end(), NO_MATCH));
+	for (size_t j = 0; j < to.nodes.size(); j++) {
+		if (to_match[j] != NO_MATCH) {
+			to_names[j] = &from.nodes[to_match[j]].name;
+			continue;
+		}
+		patch.added_nodes.push_back(get_flat_node(to.nodes[j]));
+		OutputNode& added = patch.added_nodes.back();
+		if (used_names.count(added.name) != 0) {
+			const std::string base_name = added.name;
+			for (int suffix = 1; used_names.count(added.name) != 0; suffix++) {
+				added.name = base_name + "_" + std::to_string(suffix);
+			}
+		}
+		used_names.insert(added.name);
+		to_names[j] = &added.name;
+	}
+
+	// Connections of to with their ends renamed, counted so a connection that appears twice is handled
+	std::unordered_map<std::string, size_t> to_node_indices;
+	to_node_indices.reserve(to.nodes.size());
+	for (size_t j = 0; j < to.nodes.size(); j++) {
+		to_node_indices[to.nodes[j].name] = j;
+	}
+	std::unordered_map<std::string, size_t> from_connection_counts;
+	from_connection_counts.reserve(from.connections.size());
+	for (const OutputConnection& connection : from.connections) {
+		from_connection_counts[get_connection_key(connection)]++;
+	}
+	for (const OutputConnection& connection : to.connections) {
+		const std::unordered_map<std::string, size_t>::const_iterator source_iter = to_node_indices.find(connection.source_node);
+		const std::unordered_map<std::string, size_t>::const_iterator dest_iter = to_node_indices.find(connection.dest_node);
+		if (source_iter == to_node_indices.end() || dest_iter == to_node_indices.end()) {
+			continue;
+		}
+		OutputConnection renamed;
+		renamed.source_node = *to_names[source_iter->second];
+		renamed.source_socket = connection.source_socket;
+		renamed.dest_node = *to_names[dest_iter->second];
+		renamed.dest_socket = connection.dest_socket;
+
+		const std::unordered_map<std::string, size_t>::iterator count_iter = from_connection_counts.find(get_connection_key(renamed));
+		if (count_iter != from_connection_counts.end() && count_iter->second > 0) {
+			count_iter->second--;
+		}
+		else {
+			patch.added_connections.push_back(std::move(renamed));
+		}
+	}
+	// Whatever was not used up by to is removed
+	for (const OutputConnection& connection : from.connections) {
+		const std::unordered_map<std::string, size_t>::iterator count_iter = from_connection_counts.find(get_connection_key(connection));
+		if (count_iter->second > 0) {
+			count_iter->second--;
+			patch.removed_connections.push_back(connection);
+		}
+	}
+
+	return patch;
+}
+
+bool CyclesShaderEditor::diff_graph_node(const OutputNode& from, const OutputNode& to, GraphPatchNodeChange& change)
+{
+	OutputNode from_storage;
+	OutputNode to_storage;
+	change.old_params.clear();
+	change.new_params.clear();
+	diff_params(get_flat_params(from, from_storage), get_flat_params(to, to_storage), change);
+	change.old_world_x = from.world_x;
+	change.old_world_y = from.world_y;
+	change.new_world_x = to.world_x;
+	change.new_world_y = to.world_y;
+	return !change.old_params.empty() || !change.new_params.empty() || !same_position(from, to);
+}
+
+void CyclesShaderEditor::flatten_patch_node(OutputNode& node)
+{
+	if (node_uses_maps(node)) {
+		flatten_output_params(node);
+		node.float_values.clear();
+		node.float3_values.clear();
+		node.string_values.clear();
+		node.int_values.clear();
+		node.bool_values.clear();
+		node.curve_values.clear();
+	}
+}
+
+CyclesShaderEditor::GraphPatch CyclesShaderEditor::invert_graph_patch(const GraphPatch& patch)
+{
+	GraphPatch result;
+	result.removed_nodes = patch.added_nodes;
+	result.added_nodes = patch.removed_nodes;
+	result.removed_connections = patch.added_connections;
+	result.added_connections = patch.removed_connections;
+
+	result.changed_nodes.reserve(patch.changed_nodes.size());
+	for (const GraphPatchNodeChange& change : patch.changed_nodes) {
+		GraphPatchNodeChange inverse;
+		inverse.name = change.name;
+		inverse.old_world_x = change.new_world_x;
+		inverse.old_world_y = change.new_world_y;
+		inverse.new_world_x = change.old_world_x;
+		inverse.new_world_y = change.old_world_y;
+		inverse.old_params = change.new_params;
+		inverse.new_params = change.old_params;
+		result.changed_nodes.push_back(std::move(inverse));
+	}
+
+	return result;
+}
+
+bool CyclesShaderEditor::combine_graph_patches(const GraphPatch& first, const GraphPatch& second, GraphPatch& result)
+{
+	for (const GraphPatch* const patch : { &first, &second }) {
+		if (!patch->removed_nodes.empty() || !patch->added_nodes.empty() || !patch->removed_connections.empty() || !patch->added_connections.empty()) {
+			return false;
+		}
+	}
+
+	std::unordered_map<std::string, const GraphPatchNodeChange*> second_changes;
+	for (const GraphPatchNodeChange& change : second.changed_nodes) {
+		second_changes[change.name] = &change;
+	}
+
+	// Each param's value before first and after second, a param that either patch touches starts out as first found it
+	// and ends up as second left it
+	GraphPatch combined;
+	std::vector<OutputParamId> param_ids;
+	const auto combine_change = [&](const GraphPatchNodeChange* first_change, const GraphPatchNodeChange* second_change) {
+		GraphPatchNodeChange change;
+		change.name = (first_change != nullptr) ? first_change->name : second_change->name;
+		change.old_world_x = (first_change != nullptr) ? first_change->old_world_x : second_change->old_world_x;
+		change.old_world_y = (first_change != nullptr) ? first_change->old_world_y : second_change->old_world_y;
+		change.new_world_x = (second_change != nullptr) ? second_change->new_world_x : first_change->new_world_x;
+		change.new_world_y = (second_change != nullptr) ? second_change->new_world_y : first_change->new_world_y;
+
+		param_ids.clear();
+		for (const GraphPatchNodeChange* const source : { first_change, second_change }) {
+			if (source == nullptr) {
+				continue;
+			}
+			for (const OutputParam& param : source->old_params.params) {
+				param_ids.push_back(param.id);
+			}
+			for (const OutputParam& param : source->new_params.params) {
+				param_ids.push_back(param.id);
+			}
+		}
+		std::sort(param_ids.begin(), param_ids.end());
+		param_ids.erase(std::unique(param_ids.begin(), param_ids.end()), param_ids.end());
+
+		for (const OutputParamId id : param_ids) {
+			const bool in_first = first_change != nullptr && (first_change->old_params.find(id) != nullptr || first_change->new_params.find(id) != nullptr);
+			const bool in_second = second_change != nullptr && (second_change->old_params.find(id) != nullptr || second_change->new_params.find(id) != nullptr);
+			const OutputParams& old_params = in_first ? first_change->old_params : second_change->old_params;
+			const OutputParams& new_params = in_second ? second_change->new_params : first_change->new_params;
+			const OutputParam* const old_param = old_params.find(id);
+			const OutputParam* const new_param = new_params.find(id);
+			if (old_param != nullptr && new_param != nullptr && same_param_value(old_params, *old_param, new_params, *new_param)) {
+				continue;
+			}
+			if (old_param != nullptr) {
+				copy_param(old_params, *old_param, change.old_params);
+			}
+			if (new_param != nullptr) {
+				copy_param(new_params, *new_param, change.new_params);
+			}
+		}
+
+		const bool moved = change.old_world_x != change.new_world_x || change.old_world_y != change.new_world_y;
+		if (moved || !change.old_params.empty() || !change.new_params.empty()) {
+			combined.changed_nodes.push_back(std::move(change));
+		}
+	};
+
+	for (const GraphPatchNodeChange& change : first.changed_nodes) {
+		const std::unordered_map<std::string, const GraphPatchNodeChange*>::iterator second_iter = second_changes.find(change.name);
+		if (second_iter == second_changes.end()) {
+			combine_change(&change, nullptr);
+			continue;
+		}
+		combine_change(&change, second_iter->second);
+		second_changes.erase(second_iter);
+	}
+	for (const GraphPatchNodeChange& change : second.changed_nodes) {
+		if (second_changes.count(change.name) != 0) {
+			combine_change(nullptr, &change);
+		}
+	}
+
+	result = std::move(combined);
+	return true;
+}
+
+bool CyclesShaderEditor::apply_graph_patch(CyclesNodeGraph& graph, const GraphPatch& patch)
+{
+	GraphPatchIndex index;
+	index.build(graph);
+	return apply_graph_patch(graph, patch, index);
+}
+
+bool CyclesShaderEditor::apply_graph_patch(CyclesNodeGraph& graph, const GraphPatch& patch, GraphPatchIndex& index)
+{
+	// Everything the patch refers to is checked before anything is changed
+	std::unordered_map<std::string, size_t> removed_connection_counts;
+	for (const OutputConnection& connection : patch.removed_connections) {
+		const std::string key = get_connection_key(connection);
+		if (++removed_connection_counts[key] > index.connection_indices.count(key)) {
+			return false;
+		}
+	}
+	std::unordered_set<std::string> removed_names;
+	for (const OutputNode& node : patch.removed_nodes) {
+		if (index.node_indices.count(node.name) == 0 || removed_names.insert(node.name).second == false) {
+			return false;
+		}
+	}
+	for (const GraphPatchNodeChange& change : patch.changed_nodes) {
+		if (index.node_indices.count(change.name) == 0 || removed_names.count(change.name) != 0) {
+			return false;
+		}
+	}
+	std::unordered_set<std::string> added_names;
+	for (const OutputNode& node : patch.added_nodes) {
+		const bool name_in_use = index.node_indices.count(node.name) != 0 && removed_names.count(node.name) == 0;
+		if (name_in_use || added_names.insert(node.name).second == false) {
+			return false;
+		}
+	}
+
+	// Decided before any node is removed, in case the patch removes them all
+	const bool use_maps = !graph.nodes.empty() && node_uses_maps(graph.nodes.front());
+
+	for (const OutputConnection& connection : patch.removed_connections) {
+		const std::unordered_multimap<std::string, size_t>::iterator iter = index.connection_indices.find(get_connection_key(connection));
+		const size_t removed_index = iter->second;
+		index.connection_indices.erase(iter);
+
+		const size_t last_index = graph.connections.size() - 1;
+		if (removed_index != last_index) {
+			graph.connections[removed_index] = std::move(graph.connections[last_index]);
+			typedef std::unordered_multimap<std::string, size_t>::iterator ConnectionIterator;
+			const std::pair<ConnectionIterator, ConnectionIterator> moved_range = index.connection_indices.equal_range(get_connection_key(graph.connections[removed_index]));
+			for (ConnectionIterator moved_iter = moved_range.first; moved_iter != moved_range.second; ++moved_iter) {
+				if (moved_iter->second == last_index) {
+					moved_iter->second = removed_index;
+					break;
+				}
+			}
+		}
+		graph.connections.pop_back();
+	}
+
+	for (const OutputNode& node : patch.removed_nodes) {
+		const std::unordered_map<std::string, size_t>::iterator iter = index.node_indices.find(node.name);
+		const size_t removed_index = iter->second;
+		index.node_indices.erase(iter);
+
+		const size_t last_index = graph.nodes.size() - 1;
+		if (removed_index != last_index) {
+			graph.nodes[removed_index] = std::move(graph.nodes[last_index]);
+			// Only the indexed node of a shared name is pointed at
+			const std::unordered_map<std::string, size_t>::iterator moved_iter = index.node_indices.find(graph.nodes[removed_index].name);
+			if (moved_iter != index.node_indices.end() && moved_iter->second == last_index) {
+				moved_iter->second = removed_index;
+			}
+		}
+		graph.nodes.pop_back();
+	}
+
+	for (const GraphPatchNodeChange& change : patch.changed_nodes) {
+		OutputNode& node = graph.nodes[index.node_indices[change.name]];
+		node.world_x = change.new_world_x;
+		node.world_y = change.new_world_y;
+		for (const OutputParam& param : change.new_params.params) {
+			set_node_param(node, change.new_params, param);
+		}
+		for (const OutputParam& param : change.old_params.params) {
+			if (change.new_params.find(param.id) == nullptr) {
+				erase_node_param(node, param.id);
+			}
+		}
+	}
+
+	for (const OutputNode& node : patch.added_nodes) {
+		index.node_indices[node.name] = graph.nodes.size();
+		graph.nodes.push_back(node);
+		if (use_maps) {
+			expand_output_params(graph.nodes.back());
+		}
+	}
+
+	for (const OutputConnection& connection : patch.added_connections) {
+		index.connection_indices.insert(std::make_pair(get_connection_key(connection), graph.connections.size()));
+		graph.connections.push_back(connection);
+	}
+
+	return true;
+}
+
+// Appends a token followed by the separator
+static void append_token(std::string& out, const std::string& token)
+{
+	out.append(token);
+	out.push_back(SEPARATOR);
+}
+
+static void append_token(std::string& out, const char* token)
+{
+	out.append(token);
+	out.push_back(SEPARATOR);
+}
+
+static void append_float_token(std::string& out, float value)
+{
+	CyclesShaderEditor::append_float(out, value);
+	out.push_back(SEPARATOR);
+}
+
+static void append_int_token(std::string& out, int value)
+{
+	CyclesShaderEditor::append_int(out, value);
+	out.push_back(SEPARATOR);
+}
+
+static void append_count_token(std::string& out, size_t count)
+{
+	append_int_token(out, static_cast<int>(count));
+}
+
+// Each param is its name, a one letter type tag and its value, so a patch can be read without knowing the node types
+static void encode_params(const CyclesShaderEditor::OutputParams& params, std::string& out)
+{
+	using namespace CyclesShaderEditor;
+
+	append_count_token(out, params.params.size());
+	for (const OutputParam& param : params.params) {
+		append_token(out, get_output_param_name(param.id));
+		switch (param.type) {
+		case OutputParamType::Float:
+			append_token(out, "f");
+			append_float_token(out, param.float3_value.x);
+			break;
+		case OutputParamType::Float3:
+			append_token(out, "v");
+			append_float_token(out, param.float3_value.x);
+			append_float_token(out, param.float3_value.y);
+			append_float_token(out, param.float3_value.z);
+			break;
+		case OutputParamType::String:
+			append_token(out, "s");
+			append_token(out, params.string_values[param.value_index]);
+			break;
+		case OutputParamType::Int:
+			append_token(out, "i");
+			append_int_token(out, param.int_value);
+			break;
+		case OutputParamType::Bool:
+			append_token(out, "b");
+			append_int_token(out, param.bool_value ? 1 : 0);
+			break;
+		case OutputParamType::Curve:
+		{
+			const OutputCurve& curve = params.curve_values[param.value_index];
+			append_token(out, "c");
+			append_int_token(out, curve.enum_curve_interp);
+			append_count_token(out, curve.control_points.size());
+			for (const Float2& point : curve.control_points) {
+				append_float_token(out, point.x);
+				append_float_token(out, point.y);
+			}
+			// Samples of a curve with control points are worked out again when the patch is decoded
+			if (curve.control_points.empty()) {
+				append_count_token(out, curve.samples.size());
+				for (const float sample : curve.samples) {
+					append_float_token(out, sample);
+				}
+			}
+			else {
+				append_count_token(out, 0);
+			}
+			break;
+		}
+		}
+	}
+}
+
+static void encode_node(const CyclesShaderEditor::OutputNode& node, std::string& out)
+{
+	using namespace CyclesShaderEditor;
+
+	const NodeTypeInfo* const type_info = get_node_type_info(node.type);
+	append_token(out, (type_info == nullptr) ? "" : type_info->code);
+	append_token(out, node.name);
+	append_float_token(out, node.world_x);
+	append_float_token(out, node.world_y);
+	// Patch nodes are already flat, this only happens for patches that were put together by hand
+	if (node_uses_maps(node)) {
+		encode_params(get_flat_node(node).params, out);
+	}
+	else {
+		encode_params(node.params, out);
+	}
+}
+
+static void encode_connection(const CyclesShaderEditor::OutputConnection& connection, std::string& out)
+{
+	append_token(out, connection.source_node);
+	append_token(out, connection.source_socket);
+	append_token(out, connection.dest_node);
+	append_token(out, connection.dest_socket);
+}
+
+std::string CyclesShaderEditor::encode_graph_patch(const GraphPatch& patch)
+{
+	std::string result;
+	encode_graph_patch(patch, result);
+	return result;
+}
+
+void CyclesShaderEditor::encode_graph_patch(const GraphPatch& patch, std::string& out)
+{
+	append_token(out, PATCH_MAGIC_WORD);
+	append_token(out, PATCH_VERSION);
+
+	append_token(out, SECTION_LABEL_REMOVED_NODES);
+	append_count_token(out, patch.removed_nodes.size());
+	for (const OutputNode& node : patch.removed_nodes) {
+		encode_node(node, out);
+	}
+
+	append_token(out, SECTION_LABEL_ADDED_NODES);
+	append_count_token(out, patch.added_nodes.size());
+	for (const OutputNode& node : patch.added_nodes) {
+		encode_node(node, out);
+	}
+
+	append_token(out, SECTION_LABEL_CHANGED_NODES);
+	append_count_token(out, patch.changed_nodes.size());
+	for (const GraphPatchNodeChange& change : patch.changed_nodes) {
+		append_token(out, change.name);
+		append_float_token(out, change.old_world_x);
+		append_float_token(out, change.old_world_y);
+		append_float_token(out, change.new_world_x);
+		append_float_token(out, change.new_world_y);
+		encode_params(change.old_params, out);
+		encode_params(change.new_params, out);
+	}
+
+	append_token(out, SECTION_LABEL_REMOVED_CONNECTIONS);
+	append_count_token(out, patch.removed_connections.size());
+	for (const OutputConnection& connection : patch.removed_connections) {
+		encode_connection(connection, out);
+	}
+
+	append_token(out, SECTION_LABEL_ADDED_CONNECTIONS);
+	append_count_token(out, patch.added_connections.size());
+	for (const OutputConnection& connection : patch.added_connections) {
+		encode_connection(connection, out);
+	}
+}
+
+// Reads the tokens of an encoded patch, any failure makes every later read fail too
+class PatchReader {
+public:
+	PatchReader(CyclesShaderEditor::StringSlice encoded_patch) : tokenizer(encoded_patch, SEPARATOR) {}
+
+	bool next(CyclesShaderEditor::StringSlice& token)
+	{
+		return tokenizer.next(token);
+	}
+
+	bool expect(const char* expected)
+	{
+		CyclesShaderEditor::StringSlice token;
+		return tokenizer.next(token) && token == expected;
+	}
+
+	bool read_string(std::string& result)
+	{
+		CyclesShaderEditor::StringSlice token;
+		if (!tokenizer.next(token)) {
+			return false;
+		}
+		result = token.to_string();
+		return true;
+	}
+
+	bool read_float(float& result)
+	{
+		CyclesShaderEditor::StringSlice token;
+		return tokenizer.next(token) && CyclesShaderEditor::parse_float(token, result) == CyclesShaderEditor::NumberParseResult::Success;
+	}
+
+	bool read_int(int& result)
+	{
+		CyclesShaderEditor::StringSlice token;
+		return tokenizer.next(token) && CyclesShaderEditor::parse_int(token, result) == CyclesShaderEditor::NumberParseResult::Success;
+	}
+
+	bool read_count(size_t& result)
+	{
+		int count = 0;
+		if (!read_int(count) || count < 0) {
+			return false;
+		}
+		result = static_cast<size_t>(count);
+		return true;
+	}
+
+	// Every token ends with a separator, so only the empty text after the last one may be left
+	bool at_end()
+	{
+		CyclesShaderEditor::StringSlice token;
+		return tokenizer.at_end() || (tokenizer.next(token) && token.empty() && tokenizer.at_end());
+	}
+
+private:
+	CyclesShaderEditor::Tokenizer tokenizer;
+};
+
+// Counts come from the input, so they are not trusted for reserving more than this
+static const size_t MAX_RESERVE = 1024;
+
+static bool decode_curve(PatchReader& reader, CyclesShaderEditor::OutputCurve& curve)
+{
+	using namespace CyclesShaderEditor;
+
+	size_t point_count = 0;
+	if (!reader.read_int(curve.enum_curve_interp) || !reader.read_count(point_count)) {
+		return false;
+	}
+	std::vector<Point2> points;
+	points.reserve(std::min(point_count, MAX_RESERVE));
+	curve.control_points.reserve(std::min(point_count, MAX_RESERVE));
+	for (size_t i = 0; i < point_count; i++) {
+		float x = 0.0f;
+		float y = 0.0f;
+		if (!reader.read_float(x) || !reader.read_float(y)) {
+			return false;
+		}
+		curve.control_points.push_back(Float2(x, y));
+		points.push_back(Point2(x, y));
+	}
+
+	size_t sample_count = 0;
+	if (!reader.read_count(sample_count)) {
+		return false;
+	}
+	curve.samples.reserve(std::min(sample_count, MAX_RESERVE));
+	for (size_t i = 0; i < sample_count; i++) {
+		float sample = 0.0f;
+		if (!reader.read_float(sample)) {
+			return false;
+		}
+		curve.samples.push_back(sample);
+	}
+
+	// Same sampling as decoded graphs
+	if (!points.empty()) {
+		CurveEvaluator evaluator(points, static_cast<CurveInterpolation>(curve.enum_curve_interp));
+		curve.samples.clear();
+		curve.samples.reserve(CURVE_TABLE_SIZE);
+		for (size_t i = 0; i < CURVE_TABLE_SIZE; i++) {
+			const float x = static_cast<float>(i) / (CURVE_TABLE_SIZE - 1.0f);
+			curve.samples.push_back(evaluator.eval(x));
+		}
+	}
+
+	return true;
+}
+
+static bool decode_params(PatchReader& reader, CyclesShaderEditor::OutputParams& params)
+{
+	using namespace CyclesShaderEditor;
+
+	size_t param_count = 0;
+	if (!reader.read_count(param_count)) {
+		return false;
+	}
+	for (size_t i = 0; i < param_count; i++) {
+		StringSlice name;
+		StringSlice tag;
+		if (!reader.next(name) || !reader.next(tag)) {
+			return false;
+		}
+		const OutputParamId id = find_output_param_id(name);
+		if (id == INVALID_OUTPUT_PARAM_ID) {
+			return false;
+		}
+
+		if (tag == "f") {
+			float value = 0.0f;
+			if (!reader.read_float(value)) {
+				return false;
+			}
+			params.set_float(id, value);
+		}
+		else if (tag == "v") {
+			Float3 value;
+			if (!reader.read_float(value.x) || !reader.read_float(value.y) || !reader.read_float(value.z)) {
+				return false;
+			}
+			params.set_float3(id, value);
+		}
+		else if (tag == "s") {
+			std::string value;
+			if (!reader.read_string(value)) {
+				return false;
+			}
+			params.set_string(id, std::move(value));
+		}
+		else if (tag == "i") {
+			int value = 0;
+			if (!reader.read_int(value)) {
+				return false;
+			}
+			params.set_int(id, value);
+		}
+		else if (tag == "b") {
+			int value = 0;
+			if (!reader.read_int(value)) {
+				return false;
+			}
+			params.set_bool(id, value != 0);
+		}
+		else if (tag == "c") {
+			OutputCurve value;
+			if (!decode_curve(reader, value)) {
+				return false;
+			}
+			params.set_curve(id, std::move(value));
+		}
+		else {
+			return false;
+		}
+	}
+	return true;
+}
+
+static bool decode_node(PatchReader& reader, CyclesShaderEditor::OutputNode& node)
+{
+	using namespace CyclesShaderEditor;
+
+	StringSlice type_code;
+	if (!reader.next(type_code)) {
+		return false;
+	}
+	node.type = CyclesNodeType::Unknown;
+	if (!type_code.empty()) {
+		const NodeTypeInfo* const type_info = find_node_type_info(type_code);
+		if (type_info == nullptr) {
+			return false;
+		}
+		node.type = type_info->type;
+	}
+	return reader.read_string(node.name) && reader.read_float(node.world_x) && reader.read_float(node.world_y) && decode_params(reader, node.params);
+}
+
+static bool decode_connection(PatchReader& reader, CyclesShaderEditor::OutputConnection& connection)
+{
+	return reader.read_string(connection.source_node) && reader.read_string(connection.source_socket) &&
+		reader.read_string(connection.dest_node) && reader.read_string(connection.dest_socket);
+}
+
+template <typename T, typename DecodeFunc>
+static bool decode_section(PatchReader& reader, const char* label, std::vector<T>& items, DecodeFunc decode_func)
+{
+	size_t count = 0;
+	if (!reader.expect(label) || !reader.read_count(count)) {
+		return false;
+	}
+	items.reserve(std::min(count, MAX_RESERVE));
+	for (size_t i = 0; i < count; i++) {
+		items.push_back(T());
+		if (!decode_func(reader, items.back())) {
+			return false;
+		}
+	}
+	return true;
+}
+
+static bool decode_change(PatchReader& reader, CyclesShaderEditor::GraphPatchNodeChange& change)
+{
+	return reader.read_string(change.name) &&
+		reader.read_float(change.old_world_x) && reader.read_float(change.old_world_y) &&
+		reader.read_float(change.new_world_x) && reader.read_float(change.new_world_y) &&
+		decode_params(reader, change.old_params) && decode_params(reader, change.new_params);
+}
+
+bool CyclesShaderEditor::decode_graph_patch(StringSlice encoded_patch, GraphPatch& patch)
+{
+	patch = GraphPatch();
+
+	PatchReader reader(encoded_patch);
+	const bool valid = reader.expect(PATCH_MAGIC_WORD) && reader.expect(PATCH_VERSION) &&
+		decode_section(reader, SECTION_LABEL_REMOVED_NODES, patch.removed_nodes, decode_node) &&
+		decode_section(reader, SECTION_LABEL_ADDED_NODES, patch.added_nodes, decode_node) &&
+		decode_section(reader, SECTION_LABEL_CHANGED_NODES, patch.changed_nodes, decode_change) &&
+		decode_section(reader, SECTION_LABEL_REMOVED_CONNECTIONS, patch.removed_connections, decode_connection) &&
+		decode_section(reader, SECTION_LABEL_ADDED_CONNECTIONS, patch.added_connections, decode_connection) &&
+		reader.at_end();
+	if (!valid) {
+		patch = GraphPatch();
+	}
+	return valid;
+}
@@ -0,0 +1,98 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "graph_decoder.h"
+#include "output.h"
+#include "util_tokenizer.h"
+
+namespace CyclesShaderEditor {
+
+	// Change to one node that is in both graphs
+	struct GraphPatchNodeChange {
+		// Name of the node in the graph the patch applies to
+		std::string name;
+
+		float old_world_x = 0.0f;
+		float old_world_y = 0.0f;
+		float new_world_x = 0.0f;
+		float new_world_y = 0.0f;
+
+		// Only the params whose value changed, a param in old_params that is missing from new_params is removed
+		OutputParams old_params;
+		OutputParams new_params;
+	};
+
+	// Difference between two graphs, made by diff_graphs
+	// Nodes are referred to by their names in the graph the patch applies to, nodes that are in both graphs keep that name
+	// Params of the nodes in a patch are always in the flat form
+	struct GraphPatch {
+		bool empty() const;
+
+		// Approximate number of bytes the patch holds, including its own size
+		size_t get_memory_size() const;
+
+		// Removed nodes are kept whole so the patch can be inverted
+		std::vector<OutputNode> removed_nodes;
+		std::vector<OutputNode> added_nodes;
+		std::vector<GraphPatchNodeChange> changed_nodes;
+		std::vector<OutputConnection> removed_connections;
+		std::vector<OutputConnection> added_connections;
+	};
+
+	// Finds a graph's nodes and connections by name, so applying a patch costs as much as the patch rather than the graph
+	// apply_graph_patch keeps the index up to date, it must be built again if the graph is changed any other way
+	struct GraphPatchIndex {
+		void build(const CyclesNodeGraph& graph);
+		void clear();
+
+		// If two nodes share a name the later one is found, as with connections in a decoded graph
+		std::unordered_map<std::string, size_t> node_indices;
+		// Keyed by all four fields of the connection, see get_connection_key
+		std::unordered_multimap<std::string, size_t> connection_indices;
+	};
+
+	std::string get_connection_key(const OutputConnection& connection);
+
+	// Works out the smallest set of changes that turns from into to
+	// Nodes are matched by content first and by name last, so the names the editor gives nodes from their order can shift
+	// between the two graphs without every node after the shift showing up as changed
+	// Nodes only in to are added under their name in to, with a suffix if a node kept from from already has that name
+	// Params are compared exactly, either param form may be used by either graph
+	GraphPatch diff_graphs(const CyclesNodeGraph& from, const CyclesNodeGraph& to);
+
+	// Change that turns one version of a node into another, change.name is left as it is
+	// Returns false if the two versions are the same
+	bool diff_graph_node(const OutputNode& from, const OutputNode& to, GraphPatchNodeChange& change);
+
+	// Puts a node's params in the flat form patches hold, params the flat form can not hold are dropped
+	void flatten_patch_node(OutputNode& node);
+
+	// Patch that undoes the given one
+	GraphPatch invert_graph_patch(const GraphPatch& patch);
+
+	// Patch with the same effect as applying first and then second
+	// Only patches that change nodes and nothing else can be combined, and a node must have the same name in both
+	// Returns false if the patches can not be combined, result is left untouched in that case
+	bool combine_graph_patches(const GraphPatch& first, const GraphPatch& second, GraphPatch& result);
+
+	// Changes the graph in place, nodes are removed by moving the last node into their place
+	// Added nodes take the param form of the graph's existing nodes
+	// Returns false and leaves the graph untouched if a node or connection the patch refers to is missing, or an added
+	// node's name is already used
+	bool apply_graph_patch(CyclesNodeGraph& graph, const GraphPatch& patch);
+	bool apply_graph_patch(CyclesNodeGraph& graph, const GraphPatch& patch, GraphPatchIndex& index);
+
+	// Pipe-delimited text in the same style as text graphs
+	// Everything in the patch is kept so a decoded patch can still be inverted, curve samples are rebuilt from the curve's
+	// control points unless it has none
+	std::string encode_graph_patch(const GraphPatch& patch);
+	// Appends to out
+	void encode_graph_patch(const GraphPatch& patch, std::string& out);
+	// Returns false if the patch is not valid, patch is left empty in that case
+	bool decode_graph_patch(StringSlice encoded_patch, GraphPatch& patch);
+
+}
@@ -3,6 +3,7 @@
 #include <cassert>
 #include <chrono>
 #include <cmath>
+#include <cstdio>
 #include <vector>
 
 #include <GL/glew.h>
@@ -11,6 +12,7 @@
 #include <nanovg_gl.h>
 
 #include "buttons_nodes.h"
+#include "frame_timing.h"
 #include "glfw_callbacks.h"
 #include "gui_sizes.h"
 #include "graph_decoder.h"
@@ -25,7 +27,13 @@
 #include "util_rectangle.h"
 #include "view.h"
 
-CyclesShaderEditor::EditorMainWindow::EditorMainWindow(GraphEditor* public_window) : public_window(public_window)
+// In OnDemand mode, edits flagged while handling input are only acted on at the start of the next frame, so one more
+// frame is drawn after each change to show them
+static constexpr int ON_DEMAND_FRAME_COUNT = 2;
+// Longest time the window loop waits for input before handing control back to the host
+static constexpr double ON_DEMAND_WAIT_SECONDS = 0.25;
+
+CyclesShaderEditor::EditorMainWindow::EditorMainWindow(GraphEditor* public_window) : public_window(public_window), redraw_requested(true)
 {
 	window_width = UI_WINDOW_WIDTH;
 	window_height = UI_WINDOW_HEIGHT;
@@ -90,6 +98,9 @@ bool CyclesShaderEditor::EditorMainWindow::create_window()
 	glfwSetMouseButtonCallback(window, mouse_button_callback);
 	glfwSetCharCallback(window, character_callback);
 	glfwSetScrollCallback(window, scroll_callback);
+	glfwSetCursorPosCallback(window, cursor_position_callback);
+	glfwSetFramebufferSizeCallback(window, framebuffer_size_callback);
+	glfwSetWindowRefreshCallback(window, window_refresh_callback);
 
 	toolbar = new NodeEditorToolbar(&requests);
 	status_bar = new NodeEditorStatusBar();
@@ -114,28 +125,56 @@ bool CyclesShaderEditor::EditorMainWindow::create_window()
 
 bool CyclesShaderEditor::EditorMainWindow::run_window_loop_iteration()
 {
-	const long long iteration_begin_nano = std::chrono::steady_clock::now().time_since_epoch().count();
-
 	if (glfwWindowShouldClose(window)) {
 		return false;
 	}
 
-	// Pre-draw
-	pre_draw();
+	if (redraw_mode == RedrawMode::OnDemand) {
+		if (redraw_requested.exchange(false)) {
+			frames_to_draw = ON_DEMAND_FRAME_COUNT;
+		}
+		if (frames_to_draw == 0) {
+			// Input arriving while waiting is handled by the callbacks, which ask for a redraw
+			glfwWaitEventsTimeout(ON_DEMAND_WAIT_SECONDS);
+			if (redraw_requested.exchange(false) == false) {
+				return (glfwWindowShouldClose(window) == false);
+			}
+			frames_to_draw = ON_DEMAND_FRAME_COUNT;
+		}
+		frames_to_draw--;
+	}
+
+	const long long iteration_begin_nano = std::chrono::steady_clock::now().time_since_epoch().count();
+
+	{
+		ScopedPhaseTimer frame_phase(frame_timer, FramePhase::Frame);
 
-	// Draw frame
-	int fb_width, fb_height;
-	glfwGetFramebufferSize(window, &fb_width, &fb_height);
-	const float px_ratio = static_cast<float>(fb_width) / window_width;
+		// Pre-draw
+		{
+			ScopedPhaseTimer pre_draw_phase(frame_timer, FramePhase::PreDraw);
+			pre_draw();
+		}
 
-	glViewport(0, 0, fb_width, fb_height);
+		// Draw frame
+		int fb_width, fb_height;
+		glfwGetFramebufferSize(window, &fb_width, &fb_height);
+		const float px_ratio = static_cast<float>(fb_width) / window_width;
 
-	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT | GL_STENCIL_BUFFER_BIT);
+		glViewport(0, 0, fb_width, fb_height);
 
-	nvgBeginFrame(nvg_context, window_width, window_height, px_ratio);
-	draw();
-	nvgEndFrame(nvg_context);
-	glfwSwapBuffers(window);
+		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT | GL_STENCIL_BUFFER_BIT);
+
+		nvgBeginFrame(nvg_context, window_width, window_height, px_ratio);
+		draw();
+		{
+			ScopedPhaseTimer end_frame_phase(frame_timer, FramePhase::EndFrame);
+			nvgEndFrame(nvg_context);
+		}
+		{
+			ScopedPhaseTimer swap_phase(frame_timer, FramePhase::SwapBuffers);
+			glfwSwapBuffers(window);
+		}
+	}
 
 	if (target_frame_rate > 0.0) {
 		const long long iteration_end_nano = std::chrono::steady_clock::now().time_since_epoch().count();
@@ -156,14 +195,55 @@ void CyclesShaderEditor::EditorMainWindow::set_target_frame_rate(double fps)
 	target_frame_rate = fps;
 }
 
+CyclesShaderEditor::FramePhaseStats CyclesShaderEditor::EditorMainWindow::get_frame_phase_stats(FramePhase phase) const
+{
+	return frame_timer.get_stats(phase);
+}
+
+void CyclesShaderEditor::EditorMainWindow::set_frame_timing_overlay(bool enabled)
+{
+	frame_timing_overlay = enabled;
+	if (enabled == false && status_bar != nullptr) {
+		status_bar->set_timing_text(std::string());
+	}
+	redraw_requested = true;
+}
+
+void CyclesShaderEditor::EditorMainWindow::set_redraw_mode(RedrawMode mode)
+{
+	redraw_mode = mode;
+	request_redraw();
+}
+
+void CyclesShaderEditor::EditorMainWindow::request_redraw()
+{
+	redraw_requested = true;
+	if (window != nullptr) {
+		glfwPostEmptyEvent();
+	}
+}
+
+void CyclesShaderEditor::EditorMainWindow::set_output_format(SerializedGraphFormat format)
+{
+	output_format = format;
+}
+
 void CyclesShaderEditor::EditorMainWindow::handle_mouse_button(int button, int action, int mods)
 {
+	redraw_requested = true;
+
 	bool subwindow_has_focus = (get_subwindow_under_mouse() != nullptr);
 	bool toolbar_has_focus = (toolbar != nullptr && toolbar->is_mouse_over());
 	bool node_has_focus = (view->get_node_under_mouse() != nullptr);
 	bool label_has_focus = (view->get_socket_label_under_mouse() != nullptr);
 	bool socket_has_focus = (view->get_socket_under_mouse() != nullptr);
 
+	// Everything a drag changes, from the press to the release, is one undo step
+	if (button == GLFW_MOUSE_BUTTON_LEFT && action == GLFW_PRESS && mouse_transaction_open == false) {
+		begin_undo_transaction();
+		mouse_transaction_open = true;
+	}
+
 	if (subwindow_has_focus) {
 		raise_subwindow(get_subwindow_under_mouse());
 		get_subwindow_under_mouse()->handle_mouse_button(button, action, mods);
@@ -276,11 +356,18 @@ void CyclesShaderEditor::EditorMainWindow::handle_mouse_button(int button, int a
 			box_mode = SelectMode::TOGGLE;
 		}
 		view->box_select_end(box_mode);
+
+		if (mouse_transaction_open) {
+			mouse_transaction_open = false;
+			commit_undo_transaction();
+		}
 	}
 }
 
 void CyclesShaderEditor::EditorMainWindow::handle_key(int key, int scancode, int action, int mods)
 {
+	redraw_requested = true;
+
 	// System inputs that should be handled with greater priority than anything else
 	if (mods == GLFW_MOD_CONTROL && action == GLFW_PRESS) {
 		switch (key) {
@@ -336,6 +423,8 @@ void CyclesShaderEditor::EditorMainWindow::handle_key(int key, int scancode, int
 
 void CyclesShaderEditor::EditorMainWindow::handle_character(unsigned int codepoint)
 {
+	redraw_requested = true;
+
 	if (param_editor_window->should_capture_keys()) {
 		param_editor_window->handle_character(codepoint);
 	}
@@ -343,6 +432,8 @@ void CyclesShaderEditor::EditorMainWindow::handle_character(unsigned int codepoi
 
 void CyclesShaderEditor::EditorMainWindow::handle_scroll(double /*xoffset*/, double yoffset)
 {
+	redraw_requested = true;
+
 	if (yoffset > 0.1) {
 		requests.zoom_in = true;
 	}
@@ -351,29 +442,101 @@ void CyclesShaderEditor::EditorMainWindow::handle_scroll(double /*xoffset*/, dou
 	}
 }
 
+void CyclesShaderEditor::EditorMainWindow::handle_cursor_position(double /*xpos*/, double /*ypos*/)
+{
+	// Hover highlights follow the mouse, the position itself is read at the start of the frame
+	redraw_requested = true;
+}
+
+void CyclesShaderEditor::EditorMainWindow::handle_window_changed()
+{
+	redraw_requested = true;
+}
+
 void CyclesShaderEditor::EditorMainWindow::load_serialized_graph(std::string graph)
 {
+	redraw_requested = true;
 	clear_graph(true);
 	deserialize_graph(graph, nodes, connections);
 	update_serialized_state();
+	// Loading is not a step that can be undone
+	serialized_state_cache.discard_changes();
+
+	// The next output patch is made against the graph as it was loaded
+	saved_graph = CyclesNodeGraph(graph, OutputParamLayout::Flat);
+	saved_graph_index.build(saved_graph);
+	edit_journal.reset(graph);
 }
 
-void CyclesShaderEditor::EditorMainWindow::pre_draw()
+unsigned long long CyclesShaderEditor::EditorMainWindow::get_graph_hash() const
 {
-	// Check nodes to see if we should save current state
-	bool should_push_undo_state = false;
-	for (EditorNode* node : nodes) {
-		if (node->changed) {
-			should_push_undo_state = true;
-			node->changed = false;
-		}
+	return serialized_state_cache.get_last_graph_hash();
+}
+
+void CyclesShaderEditor::EditorMainWindow::set_undo_memory_budget(size_t bytes)
+{
+	undo_stack.set_memory_budget(bytes);
+}
+
+size_t CyclesShaderEditor::EditorMainWindow::get_undo_memory_usage() const
+{
+	return undo_stack.get_stats().step_bytes;
+}
+
+bool CyclesShaderEditor::EditorMainWindow::enable_edit_journal(const PathString& path)
+{
+	std::string saved_state;
+	serialize_graph(saved_graph.nodes, saved_graph.connections, saved_state);
+	if (edit_journal.open(path, saved_state) == false) {
+		return false;
+	}
+	// Edits made since the last save are recorded straight away
+	update_serialized_state();
+	edit_journal.append(serialized_state);
+	return true;
+}
+
+void CyclesShaderEditor::EditorMainWindow::disable_edit_journal()
+{
+	edit_journal.close();
+}
+
+void CyclesShaderEditor::EditorMainWindow::begin_undo_transaction()
+{
+	undo_transaction_depth++;
+}
+
+void CyclesShaderEditor::EditorMainWindow::commit_undo_transaction()
+{
+	if (undo_transaction_depth == 0) {
+		return;
 	}
-	if (param_editor_window->should_push_undo_state()) {
-		should_push_undo_state = true;
+	undo_transaction_depth--;
+	if (undo_transaction_depth == 0) {
+		push_flagged_edits();
 	}
-	if (should_push_undo_state) {
-		push_undo_state();
+}
+
+bool CyclesShaderEditor::EditorMainWindow::apply_graph_patch(const GraphPatch& patch)
+{
+	redraw_requested = true;
+	// Node names in the patch are the ones the graph would be saved with now
+	complete_param_input();
+	update_serialized_state();
+	std::vector<EditorNode*> added_nodes;
+	std::vector<const EditorNode*> removed_nodes;
+	if (CyclesShaderEditor::apply_graph_patch(nodes, connections, serialized_state_cache, patch, added_nodes, removed_nodes) == false) {
+		return false;
 	}
+	forget_removed_nodes(removed_nodes);
+	push_undo_state();
+	return true;
+}
+
+void CyclesShaderEditor::EditorMainWindow::pre_draw()
+{
+	// Check nodes to see if we should save current state
+	push_flagged_edits();
 
 	// Update mouse position
 	double mx, my;
@@ -387,13 +550,19 @@ void CyclesShaderEditor::EditorMainWindow::pre_draw()
 	glfwPollEvents();
 
 	// Handle internal requests
-	service_requests();
+	{
+		ScopedPhaseTimer requests_phase(frame_timer, FramePhase::ServiceRequests);
+		service_requests();
+	}
 
 	// Update any other state we need
 	if (param_editor_window != nullptr) {
 		param_editor_window->set_selected_param(view->get_selected_socket_label());
 	}
-	view->update(mouse_screen_pos, window_width, window_height);
+	{
+		ScopedPhaseTimer view_update_phase(frame_timer, FramePhase::ViewUpdate);
+		view->update(mouse_screen_pos, window_width, window_height);
+	}
 	status_bar->set_zoom_text(view->get_zoom_string());
 
 	// Mark all connected input sockets
@@ -430,37 +599,76 @@ void CyclesShaderEditor::EditorMainWindow::draw()
 	// Draw here
 	//////
 
-	nvgSave(nvg_context);
-	view->draw(nvg_context);
-	nvgRestore(nvg_context);
+	{
+		ScopedPhaseTimer view_draw_phase(frame_timer, FramePhase::ViewDraw);
+		nvgSave(nvg_context);
+		view->draw(nvg_context);
+		nvgRestore(nvg_context);
+	}
+
+	// The toolbar and status bar are drawn on either side of the subwindows, both go into one sample
+	std::chrono::steady_clock::time_point bars_begin = std::chrono::steady_clock::now();
+	double bars_ms = 0.0;
 
 	// Draw toolbar
 	if (toolbar != nullptr) {
 		toolbar->set_mouse_position(mouse_screen_pos);
 		toolbar->draw(nvg_context, static_cast<float>(window_width));
 	}
+	bars_ms += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - bars_begin).count();
 
 	// Draw subwindows
-	const float max_safe_pos_y = window_height - UI_STATUSBAR_HEIGHT;
-	std::list<NodeEditorSubwindow*>::reverse_iterator window_iter;
-	for (window_iter = subwindows.rbegin(); window_iter != subwindows.rend(); ++window_iter) {
-		const CyclesShaderEditor::Point2 subwindow_pos = (*window_iter)->get_screen_pos();
-		const CyclesShaderEditor::Point2 local_mouse_pos = mouse_screen_pos - subwindow_pos;
-		(*window_iter)->set_mouse_position(local_mouse_pos, max_safe_pos_y);
-		nvgSave(nvg_context);
-		nvgTranslate(nvg_context, subwindow_pos.get_pos_x(), subwindow_pos.get_pos_y());
-		(*window_iter)->draw(nvg_context);
-		nvgRestore(nvg_context);
+	{
+		ScopedPhaseTimer subwindows_phase(frame_timer, FramePhase::Subwindows);
+		const float max_safe_pos_y = window_height - UI_STATUSBAR_HEIGHT;
+		std::list<NodeEditorSubwindow*>::reverse_iterator window_iter;
+		for (window_iter = subwindows.rbegin(); window_iter != subwindows.rend(); ++window_iter) {
+			const CyclesShaderEditor::Point2 subwindow_pos = (*window_iter)->get_screen_pos();
+			const CyclesShaderEditor::Point2 local_mouse_pos = mouse_screen_pos - subwindow_pos;
+			(*window_iter)->set_mouse_position(local_mouse_pos, max_safe_pos_y);
+			nvgSave(nvg_context);
+			nvgTranslate(nvg_context, subwindow_pos.get_pos_x(), subwindow_pos.get_pos_y());
+			(*window_iter)->draw(nvg_context);
+			nvgRestore(nvg_context);
+		}
 	}
 
 	// Draw status bar
+	bars_begin = std::chrono::steady_clock::now();
 	if (status_bar != nullptr) {
+		if (frame_timing_overlay) {
+			update_frame_timing_text();
+		}
 		const float status_bar_height = NodeEditorStatusBar::get_status_bar_height();
 		nvgSave(nvg_context);
 		nvgTranslate(nvg_context, 0.0f, static_cast<float>(window_height) - status_bar_height);
 		status_bar->draw(nvg_context, static_cast<float>(window_width));
 		nvgRestore(nvg_context);
 	}
+	bars_ms += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - bars_begin).count();
+	frame_timer.add_sample(FramePhase::Bars, bars_ms);
+}
+
+void CyclesShaderEditor::EditorMainWindow::update_frame_timing_text()
+{
+	// Average and 99th percentile of the phases that grow with the graph
+	static const FramePhase shown_phases[] = {
+		FramePhase::Frame,
+		FramePhase::PreDraw,
+		FramePhase::ViewUpdate,
+		FramePhase::ViewDraw,
+		FramePhase::EndFrame,
+		FramePhase::SwapBuffers,
+	};
+
+	std::string text("avg/p99 ms:");
+	char buffer[64];
+	for (const FramePhase phase : shown_phases) {
+		const FramePhaseStats stats = frame_timer.get_stats(phase);
+		snprintf(buffer, sizeof(buffer), "  %s %.2f/%.2f", get_frame_phase_name(phase), stats.avg_ms, stats.p99_ms);
+		text.append(buffer);
+	}
+	status_bar->set_timing_text(text);
 }
 
 void CyclesShaderEditor::EditorMainWindow::service_requests()
@@ -534,16 +742,51 @@ void CyclesShaderEditor::EditorMainWindow::raise_subwindow(NodeEditorSubwindow*
 
 void CyclesShaderEditor::EditorMainWindow::update_serialized_state()
 {
-	std::vector<OutputNode> out_nodes;
-	std::vector<OutputConnection> out_connections;
-	generate_output_lists(nodes, connections, out_nodes, out_connections);
-	serialized_state = serialize_graph(out_nodes, out_connections);
+	// Written into the same buffer every time so its memory is reused
+	serialized_state_cache.serialize(nodes, connections, serialized_state);
+}
+
+void CyclesShaderEditor::EditorMainWindow::push_flagged_edits()
+{
+	bool nodes_changed = false;
+	for (EditorNode* node : nodes) {
+		if (node->changed) {
+			nodes_changed = true;
+			node->changed = false;
+		}
+	}
+	const bool param_changed = param_editor_window->should_push_undo_state();
+	if (nodes_changed || param_changed || undo_transaction_pending) {
+		// Edits to the same param one after another are merged into one step, a transaction counts if it only edited that param
+		const void* const param_label = view->get_selected_socket_label();
+		const bool param_only = nodes_changed == false && (undo_transaction_pending == false || undo_transaction_merge_key == param_label);
+		push_undo_state(param_only ? param_label : nullptr);
+	}
 }
 
-void CyclesShaderEditor::EditorMainWindow::push_undo_state()
+void CyclesShaderEditor::EditorMainWindow::push_undo_state(const void* merge_key)
 {
-	undo_stack.push_undo_state(serialized_state);
+	// Nothing is serialized until the transaction is committed
+	if (undo_transaction_depth > 0) {
+		// The transaction keeps a key only while every push in it has the same one
+		if (undo_transaction_pending == false) {
+			undo_transaction_merge_key = merge_key;
+		}
+		else if (undo_transaction_merge_key != merge_key) {
+			undo_transaction_merge_key = nullptr;
+		}
+		undo_transaction_pending = true;
+		return;
+	}
+	undo_transaction_pending = false;
+
+	// The two buffers trade places so neither has to grow again
+	previous_serialized_state.swap(serialized_state);
 	update_serialized_state();
+	undo_stack.push_undo_state(serialized_state_cache, merge_key);
+	if (serialized_state != previous_serialized_state) {
+		edit_journal.append(serialized_state);
+	}
 	status_bar->set_status_text("Graph contains unsaved changes");
 }
 
@@ -552,11 +795,12 @@ void CyclesShaderEditor::EditorMainWindow::undo()
 	if (undo_stack.undo_available() == false) {
 		return;
 	}
-	update_serialized_state();
-	std::string new_state = undo_stack.pop_undo_state(serialized_state);
-	clear_graph(false);
-	deserialize_graph(new_state, nodes, connections);
-	update_serialized_state();
+	complete_param_input();
+	std::vector<const EditorNode*> removed_nodes;
+	if (undo_stack.undo(nodes, connections, serialized_state_cache, serialized_state, removed_nodes)) {
+		edit_journal.append(serialized_state);
+	}
+	forget_removed_nodes(removed_nodes);
 	status_bar->set_status_text("Graph contains unsaved changes");
 }
 
@@ -565,23 +809,53 @@ void CyclesShaderEditor::EditorMainWindow::redo()
 	if (undo_stack.redo_available() == false) {
 		return;
 	}
-	update_serialized_state();
-	std::string new_state = undo_stack.pop_redo_state(serialized_state);
-	clear_graph(false);
-	deserialize_graph(new_state, nodes, connections);
-	update_serialized_state();
+	complete_param_input();
+	std::vector<const EditorNode*> removed_nodes;
+	if (undo_stack.redo(nodes, connections, serialized_state_cache, serialized_state, removed_nodes)) {
+		edit_journal.append(serialized_state);
+	}
+	forget_removed_nodes(removed_nodes);
 	status_bar->set_status_text("Graph contains unsaved changes");
 }
 
+void CyclesShaderEditor::EditorMainWindow::complete_param_input()
+{
+	// An edit still being typed is written to its socket while the socket is sure to exist
+	if (param_editor_window != nullptr) {
+		param_editor_window->complete_input();
+	}
+}
+
+void CyclesShaderEditor::EditorMainWindow::forget_removed_nodes(const std::vector<const EditorNode*>& removed_nodes)
+{
+	if (removed_nodes.empty()) {
+		return;
+	}
+	view->forget_nodes(removed_nodes);
+	if (param_editor_window != nullptr) {
+		param_editor_window->set_selected_param(view->get_selected_socket_label());
+	}
+}
+
 void CyclesShaderEditor::EditorMainWindow::clear_graph(bool reset_undo)
 {
 	if (reset_undo) {
 		undo_stack.clear();
 	}
+	complete_param_input();
 	view->deselect_label();
 	view->clear_node_selection();
+	view->cancel_connection();
+	if (param_editor_window != nullptr) {
+		param_editor_window->set_selected_param(nullptr);
+	}
+	view->forget_nodes(std::vector<const EditorNode*>(nodes.begin(), nodes.end()));
+	for (EditorNode* const node : nodes) {
+		delete node;
+	}
 	nodes.clear();
 	connections.clear();
+	serialized_state_cache.clear();
 	update_serialized_state();
 }
 
@@ -594,11 +868,22 @@ void CyclesShaderEditor::EditorMainWindow::do_output()
 
 	clear_graph(false);
 
-	public_window->serialized_output = serialize_graph(out_nodes, out_connections);
+	public_window->serialized_output = serialize_graph(out_nodes, out_connections, output_format);
+
+	// The saved graph is changed by the same patch a renderer applies, so both keep the same node names
+	CyclesNodeGraph output_graph;
+	output_graph.nodes = std::move(out_nodes);
+	output_graph.connections = std::move(out_connections);
+	const GraphPatch output_patch = diff_graphs(saved_graph, output_graph);
+	CyclesShaderEditor::apply_graph_patch(saved_graph, output_patch, saved_graph_index);
+	public_window->serialized_output_patch = encode_graph_patch(output_patch);
+	edit_journal.reset(public_window->serialized_output);
 
 	// Re-create graph from saved state so serialization errors are more apparent
 	deserialize_graph(public_window->serialized_output, nodes, connections);
 	update_serialized_state();
+	// Undo steps refer to nodes by name, so they still fit the graph made again with the same names
+	serialized_state_cache.discard_changes();
 
 	public_window->output_updated = true;
 	status_bar->set_status_text("Saved");
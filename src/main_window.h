@@ -1,12 +1,20 @@
  #pragma once
 
+#include <atomic>
 #include <list>
 #include <set>
 #include <string>
 #include <vector>
 
+#include "edit_journal.h"
+#include "frame_timing.h"
+#include "graph_decoder.h"
+#include "graph_editor.h"
+#include "graph_patch.h"
 #include "node_base.h"
+#include "output.h"
 #include "point2.h"
+#include "serialize.h"
 #include "statusbar.h"
 #include "toolbar.h"
 #include "ui_requests.h"
@@ -36,17 +44,39 @@ namespace CyclesShaderEditor {
 		bool run_window_loop_iteration();
 
 		void set_target_frame_rate(double fps);
+		void set_output_format(SerializedGraphFormat format);
+		void set_redraw_mode(RedrawMode mode);
+		void request_redraw();
+
+		FramePhaseStats get_frame_phase_stats(FramePhase phase) const;
+		void set_frame_timing_overlay(bool enabled);
 
 		void handle_mouse_button(int button, int action, int mods);
 		void handle_key(int key, int scancode, int action, int mods);
 		void handle_character(unsigned int codepoint);
 		void handle_scroll(double xoffset, double yoffset);
+		void handle_cursor_position(double xpos, double ypos);
+		void handle_window_changed();
 
 		void load_serialized_graph(std::string graph);
 
+		unsigned long long get_graph_hash() const;
+
+		bool apply_graph_patch(const GraphPatch& patch);
+
+		void set_undo_memory_budget(size_t bytes);
+		size_t get_undo_memory_usage() const;
+
+		void begin_undo_transaction();
+		void commit_undo_transaction();
+
+		bool enable_edit_journal(const PathString& path);
+		void disable_edit_journal();
+
 	private:
 		void pre_draw();
 		void draw();
+		void update_frame_timing_text();
 
 		void service_requests();
 
@@ -56,10 +86,14 @@ namespace CyclesShaderEditor {
 		void raise_subwindow(NodeEditorSubwindow* subwindow);
 
 		void update_serialized_state();
-		void push_undo_state();
+		// Pushes an undo state if any node or the param editor flagged an edit since the last push
+		void push_flagged_edits();
+		void push_undo_state(const void* merge_key = nullptr);
 
 		void undo();
 		void redo();
+		void complete_param_input();
+		void forget_removed_nodes(const std::vector<const EditorNode*>& removed_nodes);
 
 		void clear_graph(bool reset_undo);
 
@@ -71,7 +105,23 @@ namespace CyclesShaderEditor {
 		int window_width, window_height;
 
 		std::string serialized_state;
+		// State before the last undo step was pushed
+		std::string previous_serialized_state;
+		SerializedGraphCache serialized_state_cache;
 		UndoStack undo_stack;
+		// Pushes while a transaction is open only note that a push is due, it happens once the outermost one is committed
+		int undo_transaction_depth = 0;
+		bool undo_transaction_pending = false;
+		// Merge key shared by every push in the pending transaction, nullptr if they differ
+		const void* undo_transaction_merge_key = nullptr;
+		bool mouse_transaction_open = false;
+
+		// Graph as of the last save or load, with the node names a renderer applying every output patch would have
+		CyclesNodeGraph saved_graph;
+		GraphPatchIndex saved_graph_index;
+
+		// Records edits since the last save or load when enabled
+		EditJournal edit_journal;
 
 		// View state to be moved into view class
 		Point2 view_center;
@@ -98,6 +148,15 @@ namespace CyclesShaderEditor {
 		GraphEditor* public_window = nullptr;
 
 		double target_frame_rate = 60.0;
+		RedrawMode redraw_mode = RedrawMode::Continuous;
+		// Set by input and by changes made through the public window, may be set from other threads
+		std::atomic<bool> redraw_requested;
+		// Frames still to be drawn in OnDemand mode before the loop waits again
+		int frames_to_draw = 0;
+
+		FrameTimer frame_timer;
+		bool frame_timing_overlay = false;
+		SerializedGraphFormat output_format = SerializedGraphFormat::Text;
 
 		PathString font_search_path;
 	};
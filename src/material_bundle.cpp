@@ -0,0 +1,210 @@
+#include "material_bundle.h"
+
+#include <cstdio>
+#include <cstring>
+
+#include "util_bytes.h"
+
+// File layout, all integers are little-endian:
+// header: 8 byte magic, u32 version, u32 material count
+// index: one entry per material sorted by name, five u64 each: name offset, name length, graph offset, graph length, graph hash
+// names and graphs follow the index, offsets are from the start of the file
+static const char BUNDLE_MAGIC[8] = { 'C', 'S', 'E', 'B', 'N', 'D', 'L', 'E' };
+static const unsigned int BUNDLE_VERSION = 1;
+
+static constexpr size_t HEADER_SIZE = 16;
+static constexpr size_t INDEX_ENTRY_SIZE = 40;
+
+void CyclesShaderEditor::MaterialBundleWriter::add_material(const std::string& name, const std::string& serialized_graph)
+{
+	materials[name] = serialized_graph;
+}
+
+bool CyclesShaderEditor::MaterialBundleWriter::write_file(const PathString& path) const
+{
+	// Header, index and names are small enough to build in memory, graphs are written straight from the map
+	std::string head;
+	head.append(BUNDLE_MAGIC, sizeof(BUNDLE_MAGIC));
+	append_u32(head, BUNDLE_VERSION);
+	append_u32(head, static_cast<unsigned int>(materials.size()));
+
+	unsigned long long names_size = 0;
+	for (const std::pair<const std::string, std::string>& this_pair : materials) {
+		names_size += this_pair.first.size();
+	}
+
+	unsigned long long name_offset = HEADER_SIZE + INDEX_ENTRY_SIZE * materials.size();
+	unsigned long long graph_offset = name_offset + names_size;
+	for (const std::pair<const std::string, std::string>& this_pair : materials) {
+		const std::string& graph = this_pair.second;
+		append_u64(head, name_offset);
+		append_u64(head, this_pair.first.size());
+		append_u64(head, graph_offset);
+		append_u64(head, graph.size());
+		append_u64(head, hash_bytes(graph.data(), graph.size()));
+		name_offset += this_pair.first.size();
+		graph_offset += graph.size();
+	}
+
+	for (const std::pair<const std::string, std::string>& this_pair : materials) {
+		head.append(this_pair.first);
+	}
+
+	FILE* const out_file = open_file_for_write(path);
+	if (out_file == nullptr) {
+		return false;
+	}
+
+	bool success = fwrite(head.data(), 1, head.size(), out_file) == head.size();
+	for (const std::pair<const std::string, std::string>& this_pair : materials) {
+		if (success == false) {
+			break;
+		}
+		const std::string& graph = this_pair.second;
+		success = fwrite(graph.data(), 1, graph.size(), out_file) == graph.size();
+	}
+
+	if (fclose(out_file) != 0) {
+		success = false;
+	}
+
+	return success;
+}
+
+bool CyclesShaderEditor::MaterialBundle::open(const PathString& path)
+{
+	close();
+
+	if (file.open(path) == false) {
+		return false;
+	}
+
+	const char* const data = file.data();
+	if (file.size() < HEADER_SIZE || memcmp(data, BUNDLE_MAGIC, sizeof(BUNDLE_MAGIC)) != 0 || read_u32(data + 8) != BUNDLE_VERSION) {
+		file.close();
+		return false;
+	}
+
+	const size_t count = read_u32(data + 12);
+	if (count > (file.size() - HEADER_SIZE) / INDEX_ENTRY_SIZE) {
+		file.close();
+		return false;
+	}
+
+	material_count = count;
+	return true;
+}
+
+void CyclesShaderEditor::MaterialBundle::close()
+{
+	file.close();
+	material_count = 0;
+}
+
+bool CyclesShaderEditor::MaterialBundle::is_open() const
+{
+	return file.is_open();
+}
+
+size_t CyclesShaderEditor::MaterialBundle::get_material_count() const
+{
+	return material_count;
+}
+
+std::string CyclesShaderEditor::MaterialBundle::get_material_name(size_t index) const
+{
+	const char* name = nullptr;
+	size_t name_length = 0;
+	if (read_entry_name(index, name, name_length) == false) {
+		return std::string();
+	}
+	return std::string(name, name_length);
+}
+
+bool CyclesShaderEditor::MaterialBundle::find_material(const std::string& name, SerializedGraphView& view) const
+{
+	size_t index = 0;
+	unsigned long long hash = 0;
+	return find_entry(name, index) && read_entry_graph(index, view, hash);
+}
+
+bool CyclesShaderEditor::MaterialBundle::verify_material(const std::string& name) const
+{
+	size_t index = 0;
+	SerializedGraphView view;
+	unsigned long long hash = 0;
+	if (find_entry(name, index) == false || read_entry_graph(index, view, hash) == false) {
+		return false;
+	}
+	return hash_bytes(view.data, view.length) == hash;
+}
+
+bool CyclesShaderEditor::MaterialBundle::find_entry(const std::string& name, size_t& index) const
+{
+	size_t low = 0;
+	size_t high = material_count;
+	while (low < high) {
+		const size_t mid = low + (high - low) / 2;
+		const char* mid_name = nullptr;
+		size_t mid_name_length = 0;
+		if (read_entry_name(mid, mid_name, mid_name_length) == false) {
+			return false;
+		}
+
+		const size_t common_length = (mid_name_length < name.size()) ? mid_name_length : name.size();
+		int compare = (common_length > 0) ? memcmp(mid_name, name.data(), common_length) : 0;
+		if (compare == 0 && mid_name_length != name.size()) {
+			compare = (mid_name_length < name.size()) ? -1 : 1;
+		}
+
+		if (compare == 0) {
+			index = mid;
+			return true;
+		}
+		else if (compare < 0) {
+			low = mid + 1;
+		}
+		else {
+			high = mid;
+		}
+	}
+
+	return false;
+}
+
+bool CyclesShaderEditor::MaterialBundle::read_entry_name(size_t index, const char*& name, size_t& name_length) const
+{
+	if (index >= material_count) {
+		return false;
+	}
+
+	const char* const entry = file.data() + HEADER_SIZE + INDEX_ENTRY_SIZE * index;
+	const unsigned long long offset = read_u64(entry);
+	const unsigned long long length = read_u64(entry + 8);
+	if (offset > file.size() || length > file.size() - offset) {
+		return false;
+	}
+
+	name = file.data() + offset;
+	name_length = static_cast<size_t>(length);
+	return true;
+}
+
+bool CyclesShaderEditor::MaterialBundle::read_entry_graph(size_t index, SerializedGraphView& view, unsigned long long& hash) const
+{
+	if (index >= material_count) {
+		return false;
+	}
+
+	const char* const entry = file.data() + HEADER_SIZE + INDEX_ENTRY_SIZE * index;
+	const unsigned long long offset = read_u64(entry + 16);
+	const unsigned long long length = read_u64(entry + 24);
+	if (offset > file.size() || length > file.size() - offset) {
+		return false;
+	}
+
+	view.data = file.data() + offset;
+	view.length = static_cast<size_t>(length);
+	hash = read_u64(entry + 32);
+	return true;
+}
\ No newline at end of file
@@ -0,0 +1,52 @@
+#pragma once
+
+#include <cstddef>
+#include <map>
+#include <string>
+
+#include "graph_decoder.h"
+#include "util_platform.h"
+
+namespace CyclesShaderEditor {
+
+	// Builds a bundle file from many serialized graphs
+	// Materials are stored sorted by name, adding a name twice keeps the last graph
+	class MaterialBundleWriter {
+	public:
+		void add_material(const std::string& name, const std::string& serialized_graph);
+
+		bool write_file(const PathString& path) const;
+
+	private:
+		std::map<std::string, std::string> materials;
+	};
+
+	// Read-only view of a bundle file written by MaterialBundleWriter
+	// Opening maps the file and checks its header, nothing else is read until a material is looked up
+	// Lookups are a binary search over the index, only the requested material's graph is touched
+	class MaterialBundle {
+	public:
+		bool open(const PathString& path);
+		void close();
+
+		bool is_open() const;
+
+		size_t get_material_count() const;
+		std::string get_material_name(size_t index) const;
+
+		// The view points into the mapped file and is only valid while the bundle stays open
+		bool find_material(const std::string& name, SerializedGraphView& view) const;
+
+		// Checks the material's graph against the hash stored in the index
+		bool verify_material(const std::string& name) const;
+
+	private:
+		bool find_entry(const std::string& name, size_t& index) const;
+		bool read_entry_name(size_t index, const char*& name, size_t& name_length) const;
+		bool read_entry_graph(size_t index, SerializedGraphView& view, unsigned long long& hash) const;
+
+		MappedFile file;
+		size_t material_count = 0;
+	};
+
+}
\ No newline at end of file
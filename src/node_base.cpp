@@ -10,7 +10,9 @@
 #include "config.h"
 #include "curve.h"
 #include "gui_sizes.h"
+#include "node_schema.h"
 #include "sockets.h"
+#include "util_arena.h"
 
 CyclesShaderEditor::NodeConnection::NodeConnection(NodeSocket* begin_socket, NodeSocket* end_socket)
 {
@@ -35,17 +37,56 @@ CyclesShaderEditor::EditorNode::~EditorNode()
 	}
 }
 
+void* CyclesShaderEditor::EditorNode::operator new(const size_t size)
+{
+	return allocate_node_object(size);
+}
+
+void CyclesShaderEditor::EditorNode::operator delete(void* const ptr)
+{
+	free_node_object(ptr);
+}
+
 std::string CyclesShaderEditor::EditorNode::get_title()
 {
 	return title;
 }
 
-void CyclesShaderEditor::EditorNode::draw_node(NVGcontext* draw_context)
+static NVGcolor get_socket_color(const CyclesShaderEditor::SocketType type)
+{
+	if (type == CyclesShaderEditor::SocketType::Closure) {
+		return nvgRGBA(100, 200, 100, 255);
+	}
+	else if (type == CyclesShaderEditor::SocketType::Color) {
+		return nvgRGBA(200, 200, 42, 255);
+	}
+	else if (type == CyclesShaderEditor::SocketType::Float) {
+		return nvgRGBA(240, 240, 240, 255);
+	}
+	else if (type == CyclesShaderEditor::SocketType::Normal) {
+		return nvgRGBA(100, 100, 200, 255);
+	}
+	else if (type == CyclesShaderEditor::SocketType::Vector) {
+		return nvgRGBA(100, 100, 200, 255);
+	}
+	else {
+		return nvgRGBA(255, 0, 0, 255);
+	}
+}
+
+void CyclesShaderEditor::EditorNode::draw_node(NVGcontext* draw_context, const NodeDrawDetail detail)
 {
 	float draw_pos_x = 0.0f;
 	float draw_pos_y = 0.0f;
 
-	content_height = sockets.size() * UI_NODE_SOCKET_ROW_HEIGHT + UI_NODE_BOTTOM_PADDING;
+	update_layout();
+
+	if (detail == NodeDrawDetail::TitleOnly || detail == NodeDrawDetail::Outline) {
+		draw_node_simplified(draw_context, detail);
+		clear_input_connected_flags();
+		return;
+	}
+	const bool draw_values = (detail == NodeDrawDetail::Full);
 
 	// Draw window
 	nvgBeginPath(draw_context);
@@ -90,13 +131,11 @@ void CyclesShaderEditor::EditorNode::draw_node(NVGcontext* draw_context)
 
 	float next_draw_y = draw_pos_y + UI_NODE_HEADER_HEIGHT + 2.0f;
 	// Sockets
-	label_targets.clear();
-	socket_targets.clear();
 	for (NodeSocket* this_socket: sockets) {
 		// Generate the text that will be used on this socket's label
 		std::string label_text;
 		std::string text_before_crossout; // For measuring text size later
-		if (this_socket->value != nullptr) {
+		if (this_socket->value != nullptr && draw_values) {
 			text_before_crossout = this_socket->display_name + ":";
 			if (this_socket->socket_type == SocketType::Float) {
 				FloatSocketValue* float_val = dynamic_cast<FloatSocketValue*>(this_socket->value);
@@ -162,7 +201,7 @@ void CyclesShaderEditor::EditorNode::draw_node(NVGcontext* draw_context)
 		nvgFillColor(draw_context, nvgRGBA(0, 0, 0, 255));
 		nvgFontFace(draw_context, "sans");
 
-		if (this_socket->value != nullptr && this_socket->socket_type == SocketType::Color) {
+		if (this_socket->value != nullptr && this_socket->socket_type == SocketType::Color && draw_values) {
 			const float SWATCH_HEIGHT = 14.0f;
 			const float SWATCH_WIDTH = 24.0f;
 			const float SWATCH_CORNER_RADIUS = 8.0f;
@@ -204,7 +243,7 @@ void CyclesShaderEditor::EditorNode::draw_node(NVGcontext* draw_context)
 			const float text_pos_x = draw_pos_x + content_width / 2;
 			const float text_pos_y = next_draw_y + UI_NODE_SOCKET_ROW_HEIGHT / 2;
 			nvgText(draw_context, text_pos_x, text_pos_y, label_text.c_str(), nullptr);
-			if (this_socket->input_connected_this_frame && this_socket->value != nullptr) {
+			if (this_socket->input_connected_this_frame && this_socket->value != nullptr && draw_values) {
 				// Output is [xmin, ymin, xmax, ymax]
 				float full_size[4];
 				float short_size[4];
@@ -222,14 +261,6 @@ void CyclesShaderEditor::EditorNode::draw_node(NVGcontext* draw_context)
 			}
 		}
 
-		if (this_socket->selectable) {
-			// Add label click target
-			CyclesShaderEditor::Point2 click_target_begin(0, next_draw_y - draw_pos_y);
-			CyclesShaderEditor::Point2 click_target_end(content_width, next_draw_y - draw_pos_y + UI_NODE_SOCKET_ROW_HEIGHT);
-			SocketClickTarget label_target(click_target_begin, click_target_end, this_socket);
-			label_targets.push_back(label_target);
-		}
-
 		if (this_socket->draw_socket) {
 			CyclesShaderEditor::Point2 socket_position;
 			if (this_socket->socket_in_out == SocketInOut::Input) {
@@ -241,42 +272,133 @@ void CyclesShaderEditor::EditorNode::draw_node(NVGcontext* draw_context)
 			nvgBeginPath(draw_context);
 			nvgCircle(draw_context, socket_position.get_pos_x(), socket_position.get_pos_y(), UI_NODE_SOCKET_RADIUS);
 
-			this_socket->world_draw_position = world_pos + socket_position;
+			nvgFillColor(draw_context, get_socket_color(this_socket->socket_type));
+			nvgFill(draw_context);
 
-			// Add click target for this socket
-			CyclesShaderEditor::Point2 local_socket_position(socket_position.get_pos_x() - draw_pos_x, socket_position.get_pos_y() - draw_pos_y);
-			CyclesShaderEditor::Point2 click_target_begin(local_socket_position.get_pos_x() - 7.0f, local_socket_position.get_pos_y() - 7.0f);
-			CyclesShaderEditor::Point2 click_target_end(local_socket_position.get_pos_x() + 7.0f, local_socket_position.get_pos_y() + 7.0f);
-			SocketClickTarget socket_target(click_target_begin, click_target_end, this_socket);
-			socket_targets.push_back(socket_target);
+			nvgStrokeColor(draw_context, nvgRGBf(0.0f, 0.0f, 0.0f));
+			nvgStrokeWidth(draw_context, 1.0f);
+			nvgStroke(draw_context);
+		}
 
-			if (this_socket->socket_type == SocketType::Closure) {
-				nvgFillColor(draw_context, nvgRGBA(100, 200, 100, 255));
-			}
-			else if (this_socket->socket_type == SocketType::Color) {
-				nvgFillColor(draw_context, nvgRGBA(200, 200, 42, 255));
-			}
-			else if (this_socket->socket_type == SocketType::Float) {
-				nvgFillColor(draw_context, nvgRGBA(240, 240, 240, 255));
-			}
-			else if (this_socket->socket_type == SocketType::Normal) {
-				nvgFillColor(draw_context, nvgRGBA(100, 100, 200, 255));
-			}
-			else if (this_socket->socket_type == SocketType::Vector) {
-				nvgFillColor(draw_context, nvgRGBA(100, 100, 200, 255));
+		next_draw_y += UI_NODE_SOCKET_ROW_HEIGHT;
+	}
+	clear_input_connected_flags();
+}
+
+void CyclesShaderEditor::EditorNode::update_without_drawing()
+{
+	update_layout();
+	clear_input_connected_flags();
+}
+
+void CyclesShaderEditor::EditorNode::draw_node_simplified(NVGcontext* draw_context, const NodeDrawDetail detail)
+{
+	const float node_height = content_height + UI_NODE_HEADER_HEIGHT;
+
+	// Plain rectangles, the rounded corners and borders are too small to see this far out
+	nvgBeginPath(draw_context);
+	nvgRect(draw_context, 0.0f, 0.0f, content_width, node_height);
+	nvgFillColor(draw_context, nvgRGBA(180, 180, 180, 255));
+	nvgFill(draw_context);
+	if (selected) {
+		nvgStrokeColor(draw_context, nvgRGBA(255, 255, 255, 225));
+		nvgStrokeWidth(draw_context, 3.0f);
+		nvgStroke(draw_context);
+	}
+
+	if (detail == NodeDrawDetail::TitleOnly) {
+		nvgBeginPath(draw_context);
+		nvgRect(draw_context, 0.0f, 0.0f, content_width, UI_NODE_HEADER_HEIGHT);
+		if (is_mouse_over_header()) {
+			nvgFillColor(draw_context, nvgRGBA(225, 225, 225, 255));
+		}
+		else {
+			nvgFillColor(draw_context, nvgRGBA(210, 210, 210, 255));
+		}
+		nvgFill(draw_context);
+
+		nvgFontSize(draw_context, UI_FONT_SIZE_NORMAL);
+		nvgFontFace(draw_context, "sans");
+		nvgTextAlign(draw_context, NVG_ALIGN_CENTER | NVG_ALIGN_MIDDLE);
+		nvgFontBlur(draw_context, 0.0f);
+		nvgFillColor(draw_context, nvgRGBA(0, 0, 0, 255));
+		nvgText(draw_context, content_width / 2, UI_NODE_HEADER_HEIGHT / 2, title.c_str(), NULL);
+	}
+
+	// Sockets as squares, neighbouring sockets of the same color share one fill
+	bool path_open = false;
+	NVGcolor path_color = nvgRGBA(0, 0, 0, 0);
+	for (NodeSocket* this_socket : sockets) {
+		if (this_socket->draw_socket == false) {
+			continue;
+		}
+		const NVGcolor this_color = get_socket_color(this_socket->socket_type);
+		const bool same_color = (this_color.r == path_color.r && this_color.g == path_color.g && this_color.b == path_color.b);
+		if (path_open && same_color == false) {
+			nvgFill(draw_context);
+			path_open = false;
+		}
+		if (path_open == false) {
+			nvgBeginPath(draw_context);
+			nvgFillColor(draw_context, this_color);
+			path_open = true;
+			path_color = this_color;
+		}
+		const Point2 socket_position = this_socket->world_draw_position - world_pos;
+		nvgRect(draw_context,
+			socket_position.get_pos_x() - UI_NODE_SOCKET_RADIUS,
+			socket_position.get_pos_y() - UI_NODE_SOCKET_RADIUS,
+			UI_NODE_SOCKET_RADIUS * 2,
+			UI_NODE_SOCKET_RADIUS * 2);
+	}
+	if (path_open) {
+		nvgFill(draw_context);
+	}
+}
+
+void CyclesShaderEditor::EditorNode::clear_input_connected_flags()
+{
+	// Normally cleared as the crossed out value is drawn, the flag is set again each frame the input is still connected
+	for (NodeSocket* this_socket : sockets) {
+		this_socket->input_connected_this_frame = false;
+	}
+}
+
+void CyclesShaderEditor::EditorNode::update_layout()
+{
+	content_height = sockets.size() * UI_NODE_SOCKET_ROW_HEIGHT + UI_NODE_BOTTOM_PADDING;
+
+	float next_row_y = UI_NODE_HEADER_HEIGHT + 2.0f;
+	label_targets.clear();
+	socket_targets.clear();
+	for (NodeSocket* this_socket : sockets) {
+		if (this_socket->selectable) {
+			// Add label click target
+			CyclesShaderEditor::Point2 click_target_begin(0, next_row_y);
+			CyclesShaderEditor::Point2 click_target_end(content_width, next_row_y + UI_NODE_SOCKET_ROW_HEIGHT);
+			SocketClickTarget label_target(click_target_begin, click_target_end, this_socket);
+			label_targets.push_back(label_target);
+		}
+
+		if (this_socket->draw_socket) {
+			CyclesShaderEditor::Point2 socket_position;
+			if (this_socket->socket_in_out == SocketInOut::Input) {
+				socket_position = CyclesShaderEditor::Point2(0.0f, next_row_y + UI_NODE_SOCKET_ROW_HEIGHT / 2);
 			}
 			else {
-				nvgFillColor(draw_context, nvgRGBA(255, 0, 0, 255));
+				socket_position = CyclesShaderEditor::Point2(content_width, next_row_y + UI_NODE_SOCKET_ROW_HEIGHT / 2);
 			}
 
-			nvgFill(draw_context);
+			this_socket->world_draw_position = world_pos + socket_position;
 
-			nvgStrokeColor(draw_context, nvgRGBf(0.0f, 0.0f, 0.0f));
-			nvgStrokeWidth(draw_context, 1.0f);
-			nvgStroke(draw_context);
+			// Add click target for this socket
+			CyclesShaderEditor::Point2 click_target_begin(socket_position.get_pos_x() - 7.0f, socket_position.get_pos_y() - 7.0f);
+			CyclesShaderEditor::Point2 click_target_end(socket_position.get_pos_x() + 7.0f, socket_position.get_pos_y() + 7.0f);
+			SocketClickTarget socket_target(click_target_begin, click_target_end, this_socket);
+			socket_targets.push_back(socket_target);
 		}
 
-		next_draw_y += UI_NODE_SOCKET_ROW_HEIGHT;
+		next_row_y += UI_NODE_SOCKET_ROW_HEIGHT;
 	}
 }
 
@@ -381,9 +503,33 @@ CyclesShaderEditor::NodeSocket* CyclesShaderEditor::EditorNode::get_socket_by_in
 	return nullptr;
 }
 
+CyclesShaderEditor::NodeSocket* CyclesShaderEditor::EditorNode::get_socket_by_display_name(SocketInOut in_out, StringSlice socket_name)
+{
+	for (NodeSocket* socket : sockets) {
+		if (socket_name == socket->display_name && socket->socket_in_out == in_out) {
+			return socket;
+		}
+	}
+
+	return nullptr;
+}
+
+CyclesShaderEditor::NodeSocket* CyclesShaderEditor::EditorNode::get_socket_by_internal_name(SocketInOut in_out, StringSlice socket_name)
+{
+	for (NodeSocket* socket : sockets) {
+		if (socket_name == socket->internal_name && socket->socket_in_out == in_out) {
+			return socket;
+		}
+	}
+
+	return nullptr;
+}
+
 CyclesShaderEditor::Point2 CyclesShaderEditor::EditorNode::get_dimensions()
 {
-	return CyclesShaderEditor::Point2(content_width, content_height + UI_NODE_HEADER_HEIGHT);
+	// Worked out from the sockets rather than content_height so it is right before the node is first laid out
+	const float height = sockets.size() * UI_NODE_SOCKET_ROW_HEIGHT + UI_NODE_BOTTOM_PADDING;
+	return CyclesShaderEditor::Point2(content_width, height + UI_NODE_HEADER_HEIGHT);
 }
 
 bool CyclesShaderEditor::EditorNode::can_be_deleted()
@@ -391,6 +537,16 @@ bool CyclesShaderEditor::EditorNode::can_be_deleted()
 	return true;
 }
 
+bool CyclesShaderEditor::EditorNode::has_socket(const NodeSocket* const socket) const
+{
+	for (const NodeSocket* const this_socket : sockets) {
+		if (this_socket == socket) {
+			return true;
+		}
+	}
+	return false;
+}
+
 void CyclesShaderEditor::EditorNode::update_output_node(OutputNode& output)
 {
 	output.type = type;
@@ -460,3 +616,72 @@ void CyclesShaderEditor::EditorNode::update_output_node(OutputNode& output)
 		}
 	}
 }
+
+void CyclesShaderEditor::EditorNode::update_node_schema(NodeTypeSchema& schema)
+{
+	schema.type = type;
+	schema.inputs.clear();
+	schema.output_names.clear();
+
+	for (NodeSocket* this_socket : sockets) {
+		if (this_socket->socket_in_out == SocketInOut::Output) {
+			schema.output_names.push_back(this_socket->display_name);
+			continue;
+		}
+
+		NodeInputSchema input;
+		input.socket_type = this_socket->socket_type;
+		input.display_name = this_socket->display_name;
+		input.internal_name = this_socket->internal_name;
+		input.has_value = (this_socket->value != nullptr);
+
+		if (this_socket->socket_type == SocketType::Float && input.has_value) {
+			FloatSocketValue* float_val = dynamic_cast<FloatSocketValue*>(this_socket->value);
+			input.float_default[0] = float_val->get_value();
+			input.float_min[0] = float_val->get_min();
+			input.float_max[0] = float_val->get_max();
+		}
+		else if (this_socket->socket_type == SocketType::Color && input.has_value) {
+			ColorSocketValue* color_val = dynamic_cast<ColorSocketValue*>(this_socket->value);
+			FloatSocketValue* const components[3] = { &color_val->red_socket_val, &color_val->green_socket_val, &color_val->blue_socket_val };
+			for (int i = 0; i < 3; i++) {
+				input.float_default[i] = components[i]->get_value();
+				input.float_min[i] = components[i]->get_min();
+				input.float_max[i] = components[i]->get_max();
+			}
+		}
+		else if (this_socket->socket_type == SocketType::Vector && input.has_value) {
+			Float3SocketValue* float3_val = dynamic_cast<Float3SocketValue*>(this_socket->value);
+			FloatSocketValue* const components[3] = { &float3_val->x_socket_val, &float3_val->y_socket_val, &float3_val->z_socket_val };
+			for (int i = 0; i < 3; i++) {
+				input.float_default[i] = components[i]->get_value();
+				input.float_min[i] = components[i]->get_min();
+				input.float_max[i] = components[i]->get_max();
+			}
+		}
+		else if (this_socket->socket_type == SocketType::StringEnum && input.has_value) {
+			StringEnumSocketValue* string_val = dynamic_cast<StringEnumSocketValue*>(this_socket->value);
+			input.string_default = string_val->value.internal_value;
+			for (const StringEnumPair& this_pair : string_val->enum_values) {
+				input.enum_values.push_back(this_pair.internal_value);
+			}
+		}
+		else if (this_socket->socket_type == SocketType::Int && input.has_value) {
+			IntSocketValue* int_val = dynamic_cast<IntSocketValue*>(this_socket->value);
+			input.int_default = int_val->get_value();
+			input.int_min = int_val->get_min();
+			input.int_max = int_val->get_max();
+		}
+		else if (this_socket->socket_type == SocketType::Boolean && input.has_value) {
+			BoolSocketValue* bool_val = dynamic_cast<BoolSocketValue*>(this_socket->value);
+			input.bool_default = bool_val->value;
+		}
+		else if (this_socket->socket_type == SocketType::Curve && input.has_value) {
+			CurveSocketValue* curve_val = dynamic_cast<CurveSocketValue*>(this_socket->value);
+			input.curve_default_points = curve_val->curve_points;
+			input.curve_default_interp = curve_val->curve_interp;
+		}
+
+		schema.inputs.push_back(input);
+	}
+}
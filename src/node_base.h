@@ -6,6 +6,7 @@
 #include "click_target.h"
 #include "output.h"
 #include "point2.h"
+#include "util_tokenizer.h"
 
 struct NVGcontext;
 
@@ -14,6 +15,18 @@ namespace CyclesShaderEditor {
 	struct OutputNode;
 
 	class EditorNode;
+	class NodeTypeSchema;
+
+	// How much of a node to draw, picked from the zoom level since small text and details can not be read anyway
+	enum class NodeDrawDetail {
+		Full,
+		// Socket names without their values
+		NoValues,
+		// Plain rectangle with the title, sockets as squares
+		TitleOnly,
+		// Plain rectangle, sockets as squares
+		Outline,
+	};
 
 	class NodeConnection {
 	public:
@@ -29,9 +42,16 @@ namespace CyclesShaderEditor {
 	public:
 		virtual ~EditorNode();
 
+		// Taken from the active NodeArenaScope if there is one, see util_arena.h
+		static void* operator new(size_t size);
+		static void operator delete(void* ptr);
+
 		virtual std::string get_title();
 
-		virtual void draw_node(NVGcontext* draw_context);
+		virtual void draw_node(NVGcontext* draw_context, NodeDrawDetail detail);
+		// Does everything draw_node does except drawing, for nodes outside the view
+		// Socket positions and click targets stay up to date so connections to the node still draw
+		void update_without_drawing();
 		virtual void set_mouse_position(Point2 node_local_position);
 
 		virtual bool is_mouse_over_node();
@@ -45,21 +65,33 @@ namespace CyclesShaderEditor {
 		virtual NodeSocket* get_socket_label_under_mouse();
 		virtual NodeSocket* get_socket_by_display_name(SocketInOut in_out, std::string socket_name);
 		virtual NodeSocket* get_socket_by_internal_name(SocketInOut in_out, std::string socket_name);
+		virtual NodeSocket* get_socket_by_display_name(SocketInOut in_out, StringSlice socket_name);
+		virtual NodeSocket* get_socket_by_internal_name(SocketInOut in_out, StringSlice socket_name);
 
 		virtual Point2 get_dimensions();
 
 		virtual bool can_be_deleted();
 
+		bool has_socket(const NodeSocket* socket) const;
+
 		virtual void update_output_node(OutputNode& output);
+		virtual void update_node_schema(NodeTypeSchema& schema);
 
 		bool selected = false;
 		bool changed = true;
+		// Set whenever an input value changes, tells SerializedGraphCache to encode the node again
+		bool output_changed = true;
 
 		CyclesNodeType type = CyclesNodeType::Unknown;
 
 		Point2 world_pos;
 
 	protected:
+		// Works out the node's height, socket positions and click targets
+		void update_layout();
+		void draw_node_simplified(NVGcontext* draw_context, NodeDrawDetail detail);
+		void clear_input_connected_flags();
+
 		std::string title;
 
 		Point2 mouse_local_pos;
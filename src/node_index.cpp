@@ -0,0 +1,205 @@
+#include "node_index.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+#include "util_rectangle.h"
+
+// Keeps cell coordinates well inside the range of an int, even for nodes dragged very far away
+static int get_cell_coordinate(const float world_coordinate)
+{
+	const float cell = std::floor(world_coordinate / CyclesShaderEditor::NodeSpatialIndex::CELL_SIZE);
+	const float limit = 1000000.0f;
+	if (cell < -limit || std::isnan(cell)) {
+		return -static_cast<int>(limit);
+	}
+	if (cell > limit) {
+		return static_cast<int>(limit);
+	}
+	return static_cast<int>(cell);
+}
+
+bool CyclesShaderEditor::NodeSpatialIndex::CellRange::operator==(const CellRange& other) const
+{
+	return min_x == other.min_x && min_y == other.min_y && max_x == other.max_x && max_y == other.max_y;
+}
+
+bool CyclesShaderEditor::NodeSpatialIndex::CellRange::operator!=(const CellRange& other) const
+{
+	return (*this == other) == false;
+}
+
+void CyclesShaderEditor::NodeSpatialIndex::begin_sync()
+{
+	sync_count++;
+}
+
+void CyclesShaderEditor::NodeSpatialIndex::place_node(EditorNode* const node, const Point2 low, const Point2 high)
+{
+	IndexedNode& entry = indexed_nodes[node];
+	const CellRange new_cells = get_cell_range(low, high);
+	if (entry.sync_count == 0) {
+		add_to_cells(node, new_cells);
+	}
+	else if (entry.cells != new_cells) {
+		remove_from_cells(node, entry.cells);
+		add_to_cells(node, new_cells);
+	}
+	entry.low = low;
+	entry.high = high;
+	entry.cells = new_cells;
+	entry.z = ++top_z;
+	entry.sync_count = sync_count;
+}
+
+void CyclesShaderEditor::NodeSpatialIndex::end_sync()
+{
+	std::unordered_map<const EditorNode*, IndexedNode>::iterator iter = indexed_nodes.begin();
+	while (iter != indexed_nodes.end()) {
+		if (iter->second.sync_count != sync_count) {
+			remove_from_cells(iter->first, iter->second.cells);
+			iter = indexed_nodes.erase(iter);
+		}
+		else {
+			++iter;
+		}
+	}
+}
+
+void CyclesShaderEditor::NodeSpatialIndex::raise_node(const EditorNode* const node)
+{
+	const std::unordered_map<const EditorNode*, IndexedNode>::iterator iter = indexed_nodes.find(node);
+	if (iter != indexed_nodes.end()) {
+		iter->second.z = ++top_z;
+	}
+}
+
+void CyclesShaderEditor::NodeSpatialIndex::remove_node(const EditorNode* const node)
+{
+	const std::unordered_map<const EditorNode*, IndexedNode>::iterator iter = indexed_nodes.find(node);
+	if (iter != indexed_nodes.end()) {
+		remove_from_cells(node, iter->second.cells);
+		indexed_nodes.erase(iter);
+	}
+}
+
+void CyclesShaderEditor::NodeSpatialIndex::clear()
+{
+	cells.clear();
+	indexed_nodes.clear();
+}
+
+void CyclesShaderEditor::NodeSpatialIndex::find_nodes_at(const Point2 pos, std::vector<EditorNode*>& out) const
+{
+	out.clear();
+	const std::unordered_map<long long, std::vector<EditorNode*>>::const_iterator cell = cells.find(get_cell_key(get_cell_coordinate(pos.get_pos_x()), get_cell_coordinate(pos.get_pos_y())));
+	if (cell == cells.end()) {
+		return;
+	}
+	for (EditorNode* const node : cell->second) {
+		const IndexedNode& entry = indexed_nodes.at(node);
+		if (do_rectangles_overlap(pos, pos, entry.low, entry.high)) {
+			out.push_back(node);
+		}
+	}
+	sort_top_first(out);
+}
+
+void CyclesShaderEditor::NodeSpatialIndex::find_nodes_in(const Point2 low, const Point2 high, std::vector<EditorNode*>& out) const
+{
+	out.clear();
+	const CellRange range = get_cell_range(low, high);
+	const double cell_count = (static_cast<double>(range.max_x) - range.min_x + 1) * (static_cast<double>(range.max_y) - range.min_y + 1);
+
+	// A rectangle covering more cells than there are nodes is quicker to check node by node
+	if (cell_count > static_cast<double>(indexed_nodes.size())) {
+		for (const std::pair<const EditorNode* const, IndexedNode>& this_pair : indexed_nodes) {
+			if (do_rectangles_overlap(low, high, this_pair.second.low, this_pair.second.high)) {
+				out.push_back(const_cast<EditorNode*>(this_pair.first));
+			}
+		}
+		return;
+	}
+
+	for (int y = range.min_y; y <= range.max_y; y++) {
+		for (int x = range.min_x; x <= range.max_x; x++) {
+			const std::unordered_map<long long, std::vector<EditorNode*>>::const_iterator cell = cells.find(get_cell_key(x, y));
+			if (cell == cells.end()) {
+				continue;
+			}
+			for (EditorNode* const node : cell->second) {
+				const IndexedNode& entry = indexed_nodes.at(node);
+				// A node in several cells is only reported from the first of them the rectangle covers
+				const int first_x = std::max(entry.cells.min_x, range.min_x);
+				const int first_y = std::max(entry.cells.min_y, range.min_y);
+				if (x == first_x && y == first_y && do_rectangles_overlap(low, high, entry.low, entry.high)) {
+					out.push_back(node);
+				}
+			}
+		}
+	}
+}
+
+void CyclesShaderEditor::NodeSpatialIndex::sort_top_first(std::vector<EditorNode*>& nodes) const
+{
+	std::sort(nodes.begin(), nodes.end(), [this](const EditorNode* const a, const EditorNode* const b) {
+		const std::unordered_map<const EditorNode*, IndexedNode>::const_iterator entry_a = indexed_nodes.find(a);
+		const std::unordered_map<const EditorNode*, IndexedNode>::const_iterator entry_b = indexed_nodes.find(b);
+		const unsigned long long z_a = (entry_a == indexed_nodes.end()) ? 0 : entry_a->second.z;
+		const unsigned long long z_b = (entry_b == indexed_nodes.end()) ? 0 : entry_b->second.z;
+		if (z_a != z_b) {
+			return z_a > z_b;
+		}
+		// Only nodes missing from the index share a z, ordering them by address puts duplicates next to each other
+		return a < b;
+	});
+	nodes.erase(std::unique(nodes.begin(), nodes.end()), nodes.end());
+}
+
+CyclesShaderEditor::NodeSpatialIndex::CellRange CyclesShaderEditor::NodeSpatialIndex::get_cell_range(const Point2 low, const Point2 high)
+{
+	CellRange result;
+	result.min_x = get_cell_coordinate(low.get_pos_x());
+	result.min_y = get_cell_coordinate(low.get_pos_y());
+	result.max_x = get_cell_coordinate(high.get_pos_x());
+	result.max_y = get_cell_coordinate(high.get_pos_y());
+	return result;
+}
+
+long long CyclesShaderEditor::NodeSpatialIndex::get_cell_key(const int x, const int y)
+{
+	const unsigned long long high_bits = static_cast<unsigned long long>(static_cast<unsigned int>(x)) << 32;
+	return static_cast<long long>(high_bits | static_cast<unsigned int>(y));
+}
+
+void CyclesShaderEditor::NodeSpatialIndex::add_to_cells(EditorNode* const node, const CellRange& range)
+{
+	for (int y = range.min_y; y <= range.max_y; y++) {
+		for (int x = range.min_x; x <= range.max_x; x++) {
+			cells[get_cell_key(x, y)].push_back(node);
+		}
+	}
+}
+
+void CyclesShaderEditor::NodeSpatialIndex::remove_from_cells(const EditorNode* const node, const CellRange& range)
+{
+	for (int y = range.min_y; y <= range.max_y; y++) {
+		for (int x = range.min_x; x <= range.max_x; x++) {
+			const std::unordered_map<long long, std::vector<EditorNode*>>::iterator cell = cells.find(get_cell_key(x, y));
+			if (cell == cells.end()) {
+				continue;
+			}
+			std::vector<EditorNode*>& cell_nodes = cell->second;
+			const std::vector<EditorNode*>::iterator found = std::find(cell_nodes.begin(), cell_nodes.end(), node);
+			if (found != cell_nodes.end()) {
+				// Order within a cell does not matter, so the last node fills the gap
+				*found = cell_nodes.back();
+				cell_nodes.pop_back();
+			}
+			if (cell_nodes.empty()) {
+				cells.erase(cell);
+			}
+		}
+	}
+}
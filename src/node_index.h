@@ -0,0 +1,69 @@
+#pragma once
+
+#include <unordered_map>
+#include <vector>
+
+#include "point2.h"
+
+namespace CyclesShaderEditor {
+
+	class EditorNode;
+
+	// Uniform grid of node bounds in world space, so hit tests only look at nodes near the point
+	// Each node also keeps a z value, a node with a higher z is drawn on top of one with a lower z
+	class NodeSpatialIndex {
+	public:
+		static constexpr float CELL_SIZE = 256.0f;
+
+		// Nodes are placed from the bottom of the z-order to the top, each one goes above everything placed before it
+		// Any node not placed again between begin_sync and end_sync is removed
+		void begin_sync();
+		void place_node(EditorNode* node, Point2 low, Point2 high);
+		void end_sync();
+
+		// Moves a node to the top of the z-order without changing its bounds
+		void raise_node(const EditorNode* node);
+		void remove_node(const EditorNode* node);
+		void clear();
+
+		// Nodes whose bounds contain pos, top of the z-order first
+		void find_nodes_at(Point2 pos, std::vector<EditorNode*>& out) const;
+		// Nodes whose bounds overlap the rectangle, in no particular order
+		void find_nodes_in(Point2 low, Point2 high, std::vector<EditorNode*>& out) const;
+
+		// Orders nodes top of the z-order first, nodes that are not in the index go last
+		void sort_top_first(std::vector<EditorNode*>& nodes) const;
+
+	private:
+		struct CellRange {
+			int min_x = 0;
+			int min_y = 0;
+			int max_x = -1;
+			int max_y = -1;
+
+			bool operator==(const CellRange& other) const;
+			bool operator!=(const CellRange& other) const;
+		};
+
+		struct IndexedNode {
+			Point2 low;
+			Point2 high;
+			CellRange cells;
+			unsigned long long z = 0;
+			unsigned long long sync_count = 0;
+		};
+
+		static CellRange get_cell_range(Point2 low, Point2 high);
+		static long long get_cell_key(int x, int y);
+
+		void add_to_cells(EditorNode* node, const CellRange& range);
+		void remove_from_cells(const EditorNode* node, const CellRange& range);
+
+		std::unordered_map<long long, std::vector<EditorNode*>> cells;
+		std::unordered_map<const EditorNode*, IndexedNode> indexed_nodes;
+
+		unsigned long long top_z = 0;
+		unsigned long long sync_count = 0;
+	};
+
+}
@@ -0,0 +1,215 @@
+#include "node_registry.h"
+
+#include "node_colors.h"
+#include "node_converter.h"
+#include "node_inputs.h"
+#include "node_interop_max.h"
+#include "node_outputs.h"
+#include "node_shaders.h"
+#include "node_textures.h"
+#include "node_vector.h"
+
+template <typename T>
+static CyclesShaderEditor::EditorNode* create_node(CyclesShaderEditor::Point2 position)
+{
+	return new T(position);
+}
+
+// One entry per node type, in the same order as CyclesNodeType so a type can be used as an index
+static constexpr CyclesShaderEditor::NodeTypeInfo NODE_TYPES[] = {
+	// Shader
+	{ CyclesShaderEditor::CyclesNodeType::AmbientOcclusion, "ambient_occlusion", "Ambient Occlusion", CyclesShaderEditor::NodeCategory::Shader, create_node<CyclesShaderEditor::AmbientOcculsionNode> },
+	{ CyclesShaderEditor::CyclesNodeType::PrincipledBSDF, "principled_bsdf", "Principled BSDF", CyclesShaderEditor::NodeCategory::Shader, create_node<CyclesShaderEditor::PrincipledBSDFNode> },
+	{ CyclesShaderEditor::CyclesNodeType::MixShader, "mix_shader", "Mix Shader", CyclesShaderEditor::NodeCategory::Shader, create_node<CyclesShaderEditor::MixShaderNode> },
+	{ CyclesShaderEditor::CyclesNodeType::AddShader, "add_shader", "Add Shader", CyclesShaderEditor::NodeCategory::Shader, create_node<CyclesShaderEditor::AddShaderNode> },
+	{ CyclesShaderEditor::CyclesNodeType::DiffuseBSDF, "diffuse_bsdf", "Diffuse BSDF", CyclesShaderEditor::NodeCategory::Shader, create_node<CyclesShaderEditor::DiffuseBSDFNode> },
+	{ CyclesShaderEditor::CyclesNodeType::GlossyBSDF, "glossy_bsdf", "Glossy BSDF", CyclesShaderEditor::NodeCategory::Shader, create_node<CyclesShaderEditor::GlossyBSDFNode> },
+	{ CyclesShaderEditor::CyclesNodeType::TransparentBSDF, "transparent_bsdf", "Transparent BSDF", CyclesShaderEditor::NodeCategory::Shader, create_node<CyclesShaderEditor::TransparentBSDFNode> },
+	{ CyclesShaderEditor::CyclesNodeType::RefractionBSDF, "refraction_bsdf", "Refraction BSDF", CyclesShaderEditor::NodeCategory::Shader, create_node<CyclesShaderEditor::RefractionBSDFNode> },
+	{ CyclesShaderEditor::CyclesNodeType::GlassBSDF, "glass_bsdf", "Glass BSDF", CyclesShaderEditor::NodeCategory::Shader, create_node<CyclesShaderEditor::GlassBSDFNode> },
+	{ CyclesShaderEditor::CyclesNodeType::TranslucentBSDF, "translucent_bsdf", "Translucent BSDF", CyclesShaderEditor::NodeCategory::Shader, create_node<CyclesShaderEditor::TranslucentBSDFNode> },
+	{ CyclesShaderEditor::CyclesNodeType::AnisotropicBSDF, "anisotropic_bsdf", "Anisotropic BSDF", CyclesShaderEditor::NodeCategory::Shader, create_node<CyclesShaderEditor::AnisotropicBSDFNode> },
+	{ CyclesShaderEditor::CyclesNodeType::VelvetBSDF, "velvet_bsdf", "Velvet BSDF", CyclesShaderEditor::NodeCategory::Shader, create_node<CyclesShaderEditor::VelvetBSDFNode> },
+	{ CyclesShaderEditor::CyclesNodeType::ToonBSDF, "toon_bsdf", "Toon BSDF", CyclesShaderEditor::NodeCategory::Shader, create_node<CyclesShaderEditor::ToonBSDFNode> },
+	{ CyclesShaderEditor::CyclesNodeType::SubsurfaceScattering, "subsurface_scatter", "Subsurface Scattering", CyclesShaderEditor::NodeCategory::Shader, create_node<CyclesShaderEditor::SubsurfaceScatteringNode> },
+	{ CyclesShaderEditor::CyclesNodeType::Emission, "emission", "Emission", CyclesShaderEditor::NodeCategory::Shader, create_node<CyclesShaderEditor::EmissionNode> },
+	{ CyclesShaderEditor::CyclesNodeType::HairBSDF, "hair_bsdf", "Hair BSDF", CyclesShaderEditor::NodeCategory::Shader, create_node<CyclesShaderEditor::HairBSDFNode> },
+	{ CyclesShaderEditor::CyclesNodeType::Holdout, "holdout", "Holdout", CyclesShaderEditor::NodeCategory::Shader, create_node<CyclesShaderEditor::HoldoutNode> },
+	{ CyclesShaderEditor::CyclesNodeType::VolAbsorption, "vol_absorb", "Volume Absorption", CyclesShaderEditor::NodeCategory::Shader, create_node<CyclesShaderEditor::VolumeAbsorptionNode> },
+	{ CyclesShaderEditor::CyclesNodeType::VolScatter, "vol_scatter", "Volume Scatter", CyclesShaderEditor::NodeCategory::Shader, create_node<CyclesShaderEditor::VolumeScatterNode> },
+	// Texture
+	{ CyclesShaderEditor::CyclesNodeType::MaxTex, "max_tex", "3ds Max Texmap", CyclesShaderEditor::NodeCategory::Texture, create_node<CyclesShaderEditor::MaxTexmapShaderNode> },
+	{ CyclesShaderEditor::CyclesNodeType::BrickTex, "brick_tex", "Brick Texture", CyclesShaderEditor::NodeCategory::Texture, create_node<CyclesShaderEditor::BrickTextureNode> },
+	{ CyclesShaderEditor::CyclesNodeType::CheckerTex, "checker_tex", "Checker Texture", CyclesShaderEditor::NodeCategory::Texture, create_node<CyclesShaderEditor::CheckerTextureNode> },
+	{ CyclesShaderEditor::CyclesNodeType::GradientTex, "gradient_tex", "Gradient Texture", CyclesShaderEditor::NodeCategory::Texture, create_node<CyclesShaderEditor::GradientTextureNode> },
+	{ CyclesShaderEditor::CyclesNodeType::MagicTex, "magic_tex", "Magic Texture", CyclesShaderEditor::NodeCategory::Texture, create_node<CyclesShaderEditor::MagicTextureNode> },
+	{ CyclesShaderEditor::CyclesNodeType::MusgraveTex, "musgrave_tex", "Musgrave Texture", CyclesShaderEditor::NodeCategory::Texture, create_node<CyclesShaderEditor::MusgraveTextureNode> },
+	{ CyclesShaderEditor::CyclesNodeType::NoiseTex, "noise_tex", "Noise Texture", CyclesShaderEditor::NodeCategory::Texture, create_node<CyclesShaderEditor::NoiseTextureNode> },
+	{ CyclesShaderEditor::CyclesNodeType::VoronoiTex, "voronoi_tex", "Voronoi Texture", CyclesShaderEditor::NodeCategory::Texture, create_node<CyclesShaderEditor::VoronoiTextureNode> },
+	{ CyclesShaderEditor::CyclesNodeType::WaveTex, "wave_tex", "Wave Texture", CyclesShaderEditor::NodeCategory::Texture, create_node<CyclesShaderEditor::WaveTextureNode> },
+	// Input
+	{ CyclesShaderEditor::CyclesNodeType::LightPath, "light_path", "Light Path", CyclesShaderEditor::NodeCategory::Input, create_node<CyclesShaderEditor::LightPathNode> },
+	{ CyclesShaderEditor::CyclesNodeType::Fresnel, "fresnel", "Fresnel", CyclesShaderEditor::NodeCategory::Input, create_node<CyclesShaderEditor::FresnelNode> },
+	{ CyclesShaderEditor::CyclesNodeType::LayerWeight, "layer_weight", "Layer Weight", CyclesShaderEditor::NodeCategory::Input, create_node<CyclesShaderEditor::LayerWeightNode> },
+	{ CyclesShaderEditor::CyclesNodeType::CameraData, "camera_data", "Camera Data", CyclesShaderEditor::NodeCategory::Input, create_node<CyclesShaderEditor::CameraDataNode> },
+	{ CyclesShaderEditor::CyclesNodeType::Tangent, "tangent", "Tangent", CyclesShaderEditor::NodeCategory::Input, create_node<CyclesShaderEditor::TangentNode> },
+	{ CyclesShaderEditor::CyclesNodeType::TextureCoordinate, "texture_coordinate", "Texture Coordinate", CyclesShaderEditor::NodeCategory::Input, create_node<CyclesShaderEditor::TextureCoordinateNode> },
+	{ CyclesShaderEditor::CyclesNodeType::Geometry, "geometry", "Geometry", CyclesShaderEditor::NodeCategory::Input, create_node<CyclesShaderEditor::GeometryNode> },
+	{ CyclesShaderEditor::CyclesNodeType::ObjectInfo, "object_info", "Object Info", CyclesShaderEditor::NodeCategory::Input, create_node<CyclesShaderEditor::ObjectInfoNode> },
+	{ CyclesShaderEditor::CyclesNodeType::RGB, "rgb", "RGB", CyclesShaderEditor::NodeCategory::Input, create_node<CyclesShaderEditor::RGBNode> },
+	{ CyclesShaderEditor::CyclesNodeType::Wireframe, "wireframe", "Wireframe", CyclesShaderEditor::NodeCategory::Input, create_node<CyclesShaderEditor::WireframeNode> },
+	{ CyclesShaderEditor::CyclesNodeType::Value, "value", "Value", CyclesShaderEditor::NodeCategory::Input, create_node<CyclesShaderEditor::ValueNode> },
+	// Color
+	{ CyclesShaderEditor::CyclesNodeType::MixRGB, "mix_rgb", "Mix RGB", CyclesShaderEditor::NodeCategory::Color, create_node<CyclesShaderEditor::MixRGBNode> },
+	{ CyclesShaderEditor::CyclesNodeType::Invert, "invert", "Invert", CyclesShaderEditor::NodeCategory::Color, create_node<CyclesShaderEditor::InvertNode> },
+	{ CyclesShaderEditor::CyclesNodeType::LightFalloff, "light_falloff", "Light Falloff", CyclesShaderEditor::NodeCategory::Color, create_node<CyclesShaderEditor::LightFalloffNode> },
+	{ CyclesShaderEditor::CyclesNodeType::HSV, "hsv", "HSV", CyclesShaderEditor::NodeCategory::Color, create_node<CyclesShaderEditor::HSVNode> },
+	{ CyclesShaderEditor::CyclesNodeType::Gamma, "gamma", "Gamma", CyclesShaderEditor::NodeCategory::Color, create_node<CyclesShaderEditor::GammaNode> },
+	{ CyclesShaderEditor::CyclesNodeType::BrightnessContrast, "bright_contrast", "Bright/Contrast", CyclesShaderEditor::NodeCategory::Color, create_node<CyclesShaderEditor::BrightnessContrastNode> },
+	{ CyclesShaderEditor::CyclesNodeType::RGBCurves, "rgb_curves", "RGB Curves", CyclesShaderEditor::NodeCategory::Color, create_node<CyclesShaderEditor::RGBCurvesNode> },
+	// Vector
+	{ CyclesShaderEditor::CyclesNodeType::Bump, "bump", "Bump", CyclesShaderEditor::NodeCategory::Vector, create_node<CyclesShaderEditor::BumpNode> },
+	{ CyclesShaderEditor::CyclesNodeType::NormalMap, "normal_map", "Normal Map", CyclesShaderEditor::NodeCategory::Vector, create_node<CyclesShaderEditor::NormalMapNode> },
+	{ CyclesShaderEditor::CyclesNodeType::VectorTransform, "vector_transform", "Vector Transform", CyclesShaderEditor::NodeCategory::Vector, create_node<CyclesShaderEditor::VectorTransformNode> },
+	// Converter
+	{ CyclesShaderEditor::CyclesNodeType::Blackbody, "blackbody", "Blackbody", CyclesShaderEditor::NodeCategory::Converter, create_node<CyclesShaderEditor::BlackbodyNode> },
+	{ CyclesShaderEditor::CyclesNodeType::CombineHSV, "combine_hsv", "Combine HSV", CyclesShaderEditor::NodeCategory::Converter, create_node<CyclesShaderEditor::CombineHSVNode> },
+	{ CyclesShaderEditor::CyclesNodeType::CombineRGB, "combine_rgb", "Combine RGB", CyclesShaderEditor::NodeCategory::Converter, create_node<CyclesShaderEditor::CombineRGBNode> },
+	{ CyclesShaderEditor::CyclesNodeType::CombineXYZ, "combine_xyz", "Combine XYZ", CyclesShaderEditor::NodeCategory::Converter, create_node<CyclesShaderEditor::CombineXYZNode> },
+	{ CyclesShaderEditor::CyclesNodeType::Math, "math", "Math", CyclesShaderEditor::NodeCategory::Converter, create_node<CyclesShaderEditor::MathNode> },
+	{ CyclesShaderEditor::CyclesNodeType::RGBtoBW, "rgb_to_bw", "RGB to BW", CyclesShaderEditor::NodeCategory::Converter, create_node<CyclesShaderEditor::RGBToBWNode> },
+	{ CyclesShaderEditor::CyclesNodeType::SeparateHSV, "separate_hsv", "Separate HSV", CyclesShaderEditor::NodeCategory::Converter, create_node<CyclesShaderEditor::SeparateHSVNode> },
+	{ CyclesShaderEditor::CyclesNodeType::SeparateRGB, "separate_rgb", "Separate RGB", CyclesShaderEditor::NodeCategory::Converter, create_node<CyclesShaderEditor::SeparateRGBNode> },
+	{ CyclesShaderEditor::CyclesNodeType::SeparateXYZ, "separate_xyz", "Separate XYZ", CyclesShaderEditor::NodeCategory::Converter, create_node<CyclesShaderEditor::SeparateXYZNode> },
+	{ CyclesShaderEditor::CyclesNodeType::VectorMath, "vector_math", "Vector Math", CyclesShaderEditor::NodeCategory::Converter, create_node<CyclesShaderEditor::VectorMathNode> },
+	{ CyclesShaderEditor::CyclesNodeType::Wavelength, "wavelength", "Wavelength", CyclesShaderEditor::NodeCategory::Converter, create_node<CyclesShaderEditor::WavelengthNode> },
+	// Output
+	{ CyclesShaderEditor::CyclesNodeType::MaterialOutput, "out_material", "Material Output", CyclesShaderEditor::NodeCategory::Output, create_node<CyclesShaderEditor::MaterialOutputNode> },
+};
+
+static constexpr size_t NODE_TYPE_COUNT = sizeof(NODE_TYPES) / sizeof(NODE_TYPES[0]);
+
+static constexpr unsigned char NO_TYPE = 0xff;
+
+static_assert(NODE_TYPE_COUNT == static_cast<size_t>(CyclesShaderEditor::CyclesNodeType::Unknown), "NODE_TYPES must have one entry per node type");
+static_assert(NODE_TYPE_COUNT < NO_TYPE, "Type indices must fit in the code table");
+
+static constexpr bool types_in_enum_order(size_t i)
+{
+	return i >= NODE_TYPE_COUNT || (NODE_TYPES[i].type == static_cast<CyclesShaderEditor::CyclesNodeType>(i) && types_in_enum_order(i + 1));
+}
+
+static_assert(types_in_enum_order(0), "NODE_TYPES must be in the same order as CyclesNodeType");
+
+// Codes are looked up with a perfect hash of their length, first and last characters and the character a third of the way in
+// The multiplier was picked so that the top byte of every code's hash is different, the static_assert below fails if a new type breaks that
+
+static_assert(sizeof(unsigned int) == 4, "Code hash must be 32 bits");
+
+static constexpr unsigned int CODE_HASH_MULTIPLIER = 0x9eba8775u;
+static constexpr size_t CODE_TABLE_SIZE = 256;
+
+static constexpr unsigned int get_code_key(const char* code, size_t length)
+{
+	return static_cast<unsigned char>(code[0]) |
+		static_cast<unsigned char>(code[length / 3]) << 8 |
+		static_cast<unsigned char>(code[length - 1]) << 16 |
+		static_cast<unsigned int>(length) << 24;
+}
+
+static constexpr size_t get_code_slot(unsigned int key)
+{
+	return (key * CODE_HASH_MULTIPLIER) >> 24;
+}
+
+static constexpr size_t get_code_length(const char* code)
+{
+	return *code == '\0' ? 0 : 1 + get_code_length(code + 1);
+}
+
+static constexpr size_t get_code_slot(const char* code)
+{
+	return get_code_slot(get_code_key(code, get_code_length(code)));
+}
+
+static constexpr unsigned char find_type_in_slot(size_t slot, size_t i)
+{
+	return i >= NODE_TYPE_COUNT ? NO_TYPE : (get_code_slot(NODE_TYPES[i].code) == slot ? static_cast<unsigned char>(i) : find_type_in_slot(slot, i + 1));
+}
+
+// C++11 has no std::index_sequence, this builds the list of slots the table is filled from
+template <size_t... Indices>
+struct IndexList {};
+
+template <size_t N, size_t... Indices>
+struct MakeIndexList : MakeIndexList<N - 1, N - 1, Indices...> {};
+
+template <size_t... Indices>
+struct MakeIndexList<0, Indices...> {
+	typedef IndexList<Indices...> type;
+};
+
+// Index into NODE_TYPES for each slot, or NO_TYPE
+struct CodeTable {
+	unsigned char type_index[CODE_TABLE_SIZE];
+};
+
+template <size_t... Slots>
+static constexpr CodeTable make_code_table(IndexList<Slots...>)
+{
+	return CodeTable{ { find_type_in_slot(Slots, 0)... } };
+}
+
+static constexpr CodeTable CODE_TABLE = make_code_table(MakeIndexList<CODE_TABLE_SIZE>::type());
+
+static constexpr bool codes_have_own_slots(size_t i)
+{
+	return i >= NODE_TYPE_COUNT || (CODE_TABLE.type_index[get_code_slot(NODE_TYPES[i].code)] == i && codes_have_own_slots(i + 1));
+}
+
+static_assert(codes_have_own_slots(0), "Two node type codes share a slot, CODE_HASH_MULTIPLIER needs to be changed");
+
+const CyclesShaderEditor::NodeTypeInfo* CyclesShaderEditor::get_node_type_info(CyclesNodeType type)
+{
+	const size_t index = static_cast<size_t>(type);
+	if (index >= NODE_TYPE_COUNT) {
+		return nullptr;
+	}
+	return &NODE_TYPES[index];
+}
+
+const CyclesShaderEditor::NodeTypeInfo* CyclesShaderEditor::find_node_type_info(StringSlice code)
+{
+	const char* const code_data = code.data();
+	const size_t code_length = code.size();
+	if (code_length == 0) {
+		return nullptr;
+	}
+
+	const unsigned char type_index = CODE_TABLE.type_index[get_code_slot(get_code_key(code_data, code_length))];
+	if (type_index == NO_TYPE) {
+		return nullptr;
+	}
+
+	// Any string can land in a slot, so the code still has to be compared
+	// The type's code is walked alongside the slice so its length never has to be measured
+	const NodeTypeInfo* const info = &NODE_TYPES[type_index];
+	for (size_t i = 0; i < code_length; i++) {
+		if (info->code[i] == '\0' || info->code[i] != code_data[i]) {
+			return nullptr;
+		}
+	}
+	if (info->code[code_length] != '\0') {
+		return nullptr;
+	}
+	return info;
+}
+
+CyclesShaderEditor::EditorNode* CyclesShaderEditor::create_node_from_type(CyclesNodeType type, Point2 position)
+{
+	const NodeTypeInfo* const info = get_node_type_info(type);
+	if (info == nullptr) {
+		return nullptr;
+	}
+	return info->create(position);
+}
\ No newline at end of file
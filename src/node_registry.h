@@ -0,0 +1,46 @@
+#pragma once
+
+#include <cstddef>
+
+#include "output.h"
+#include "point2.h"
+#include "util_tokenizer.h"
+
+namespace CyclesShaderEditor {
+
+	class EditorNode;
+
+	// Groups used by the node list, MaterialOutput is the only Output node and is never listed
+	enum class NodeCategory {
+		Input,
+		Shader,
+		Texture,
+		Color,
+		Vector,
+		Converter,
+		Output,
+	};
+
+	// Static description of one node type
+	struct NodeTypeInfo {
+		CyclesNodeType type;
+		// Code used for this type in serialized graphs
+		const char* code;
+		// Matches the title set by the node's constructor
+		const char* title;
+		NodeCategory category;
+		// Caller is responsible for deleting the returned node
+		EditorNode* (*create)(Point2 position);
+	};
+
+	// The registry is a constant table, none of these do any work at startup and all are safe to call from any thread
+
+	// Returns nullptr for Unknown and Count
+	const NodeTypeInfo* get_node_type_info(CyclesNodeType type);
+	// Returns nullptr when no type uses the code, lookup is a perfect hash into a table built at compile time
+	const NodeTypeInfo* find_node_type_info(StringSlice code);
+
+	// Returns nullptr for types that can not be created
+	EditorNode* create_node_from_type(CyclesNodeType type, Point2 position);
+
+}
\ No newline at end of file
@@ -0,0 +1,154 @@
+#include "node_schema.h"
+
+#include <algorithm>
+#include <cstring>
+
+#include "node_base.h"
+#include "node_registry.h"
+
+struct SchemaTables {
+	std::vector<CyclesShaderEditor::NodeTypeSchema> schemas;
+	std::vector<std::string> param_names;
+	// Open addressing hash table of param ids, indexed by hash_param_name
+	std::vector<CyclesShaderEditor::OutputParamId> param_slots;
+};
+
+static size_t hash_param_name(const char* name, size_t length)
+{
+	size_t hash = 2166136261u;
+	for (size_t i = 0; i < length; i++) {
+		hash ^= static_cast<unsigned char>(name[i]);
+		hash *= 16777619u;
+	}
+	return hash;
+}
+
+static SchemaTables build_schema_tables()
+{
+	using namespace CyclesShaderEditor;
+
+	SchemaTables result;
+	result.schemas.resize(static_cast<size_t>(CyclesNodeType::Count));
+	for (size_t i = 0; i < result.schemas.size(); i++) {
+		EditorNode* const node = create_node_from_type(static_cast<CyclesNodeType>(i), Point2(0.0f, 0.0f));
+		if (node == nullptr) {
+			continue;
+		}
+		node->update_node_schema(result.schemas[i]);
+		delete node;
+	}
+
+	// RGB curves nodes also output their combined curves, see RGBCurvesNode::update_output_node
+	result.param_names.push_back("final_r_curve");
+	result.param_names.push_back("final_g_curve");
+	result.param_names.push_back("final_b_curve");
+	for (const NodeTypeSchema& schema : result.schemas) {
+		for (const NodeInputSchema& input : schema.inputs) {
+			if (input.has_value) {
+				result.param_names.push_back(input.internal_name);
+			}
+		}
+	}
+	std::sort(result.param_names.begin(), result.param_names.end());
+	result.param_names.erase(std::unique(result.param_names.begin(), result.param_names.end()), result.param_names.end());
+
+	// At most a quarter full so lookups rarely probe more than one slot
+	size_t slot_count = 1;
+	while (slot_count < result.param_names.size() * 4) {
+		slot_count *= 2;
+	}
+	result.param_slots.resize(slot_count, INVALID_OUTPUT_PARAM_ID);
+	for (size_t i = 0; i < result.param_names.size(); i++) {
+		size_t slot = hash_param_name(result.param_names[i].data(), result.param_names[i].size()) & (slot_count - 1);
+		while (result.param_slots[slot] != INVALID_OUTPUT_PARAM_ID) {
+			slot = (slot + 1) & (slot_count - 1);
+		}
+		result.param_slots[slot] = static_cast<OutputParamId>(i);
+	}
+
+	for (NodeTypeSchema& schema : result.schemas) {
+		for (NodeInputSchema& input : schema.inputs) {
+			const std::vector<std::string>::const_iterator name_iter = std::lower_bound(result.param_names.cbegin(), result.param_names.cend(), input.internal_name);
+			if (name_iter != result.param_names.cend() && *name_iter == input.internal_name) {
+				input.param_id = static_cast<OutputParamId>(name_iter - result.param_names.cbegin());
+			}
+		}
+	}
+
+	return result;
+}
+
+static const SchemaTables& get_schema_tables()
+{
+	static const SchemaTables tables = build_schema_tables();
+	return tables;
+}
+
+const CyclesShaderEditor::NodeInputSchema* CyclesShaderEditor::NodeTypeSchema::get_input_by_internal_name(StringSlice internal_name) const
+{
+	for (const NodeInputSchema& input : inputs) {
+		if (internal_name == input.internal_name) {
+			return &input;
+		}
+	}
+
+	return nullptr;
+}
+
+bool CyclesShaderEditor::NodeTypeSchema::has_input_display_name(StringSlice display_name) const
+{
+	for (const NodeInputSchema& input : inputs) {
+		if (display_name == input.display_name) {
+			return true;
+		}
+	}
+
+	return false;
+}
+
+bool CyclesShaderEditor::NodeTypeSchema::has_output_display_name(StringSlice display_name) const
+{
+	for (const std::string& output_name : output_names) {
+		if (display_name == output_name) {
+			return true;
+		}
+	}
+
+	return false;
+}
+
+const CyclesShaderEditor::NodeTypeSchema* CyclesShaderEditor::get_node_type_schema(CyclesNodeType type)
+{
+	const std::vector<NodeTypeSchema>& schema_table = get_schema_tables().schemas;
+
+	const size_t index = static_cast<size_t>(type);
+	if (index >= schema_table.size() || schema_table[index].type != type) {
+		return nullptr;
+	}
+
+	return &schema_table[index];
+}
+
+const std::vector<std::string>& CyclesShaderEditor::get_output_param_names()
+{
+	return get_schema_tables().param_names;
+}
+
+CyclesShaderEditor::OutputParamId CyclesShaderEditor::find_output_param_id(StringSlice name)
+{
+	const SchemaTables& tables = get_schema_tables();
+	const char* const name_data = name.data();
+	const size_t name_length = name.size();
+
+	const size_t slot_mask = tables.param_slots.size() - 1;
+	size_t slot = hash_param_name(name_data, name_length) & slot_mask;
+	while (tables.param_slots[slot] != INVALID_OUTPUT_PARAM_ID) {
+		const std::string& this_name = tables.param_names[tables.param_slots[slot]];
+		if (this_name.size() == name_length && memcmp(this_name.data(), name_data, name_length) == 0) {
+			return tables.param_slots[slot];
+		}
+		slot = (slot + 1) & slot_mask;
+	}
+
+	return INVALID_OUTPUT_PARAM_ID;
+}
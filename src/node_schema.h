@@ -0,0 +1,68 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "common_enums.h"
+#include "output.h"
+#include "point2.h"
+#include "sockets.h"
+#include "util_tokenizer.h"
+
+namespace CyclesShaderEditor {
+
+	// Description of one input socket of a node type, including the default and allowed range of its value
+	// This mirrors what the socket's SocketValue would hold on a freshly created EditorNode
+	class NodeInputSchema {
+	public:
+		SocketType socket_type = SocketType::Float;
+		std::string display_name;
+		std::string internal_name;
+		// Id of internal_name, see get_output_param_id
+		OutputParamId param_id = INVALID_OUTPUT_PARAM_ID;
+
+		// False for sockets that only accept connections, such as closures
+		bool has_value = false;
+
+		// Used by Float, Color and Vector sockets, Float sockets only use the first component
+		float float_default[3] = { 0.0f, 0.0f, 0.0f };
+		float float_min[3] = { 0.0f, 0.0f, 0.0f };
+		float float_max[3] = { 0.0f, 0.0f, 0.0f };
+
+		int int_default = 0;
+		int int_min = 0;
+		int int_max = 0;
+
+		bool bool_default = false;
+
+		std::string string_default;
+		std::vector<std::string> enum_values;
+
+		std::vector<Point2> curve_default_points;
+		CurveInterpolation curve_default_interp = CurveInterpolation::CUBIC_HERMITE;
+	};
+
+	// Everything the decoder needs to know about a node type without creating an EditorNode
+	class NodeTypeSchema {
+	public:
+		const NodeInputSchema* get_input_by_internal_name(StringSlice internal_name) const;
+		bool has_input_display_name(StringSlice display_name) const;
+		bool has_output_display_name(StringSlice display_name) const;
+
+		CyclesNodeType type = CyclesNodeType::Unknown;
+
+		// Inputs are kept in the same order as the node's sockets
+		std::vector<NodeInputSchema> inputs;
+		std::vector<std::string> output_names;
+	};
+
+	// Returns nullptr for types that can not be created
+	// The schema table is built once from the node classes on first use
+	const NodeTypeSchema* get_node_type_schema(CyclesNodeType type);
+
+	// Every param name a node can output, sorted, each name's position is its OutputParamId
+	const std::vector<std::string>& get_output_param_names();
+	// Returns INVALID_OUTPUT_PARAM_ID for a name that is not in get_output_param_names
+	OutputParamId find_output_param_id(StringSlice name);
+
+}
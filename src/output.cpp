@@ -1,5 +1,10 @@
 #include "output.h"
 
+#include <algorithm>
+#include <cstring>
+
+#include "node_schema.h"
+
 CyclesShaderEditor::Float2::Float2() :
 	x(0.0f),
 	y(0.0f)
@@ -29,3 +34,299 @@ CyclesShaderEditor::Float3::Float3(float x, float y, float z) :
 {
 
 }
+
+CyclesShaderEditor::OutputParamId CyclesShaderEditor::get_output_param_id(const char* name)
+{
+	return find_output_param_id(StringSlice(name, strlen(name)));
+}
+
+CyclesShaderEditor::OutputParamId CyclesShaderEditor::get_output_param_id(const std::string& name)
+{
+	return find_output_param_id(StringSlice(name));
+}
+
+const std::string& CyclesShaderEditor::get_output_param_name(const OutputParamId id)
+{
+	static const std::string empty_name;
+
+	const std::vector<std::string>& param_names = get_output_param_names();
+	if (id >= param_names.size()) {
+		return empty_name;
+	}
+	return param_names[id];
+}
+
+bool CyclesShaderEditor::OutputParams::empty() const
+{
+	return params.empty();
+}
+
+size_t CyclesShaderEditor::OutputParams::size() const
+{
+	return params.size();
+}
+
+void CyclesShaderEditor::OutputParams::clear()
+{
+	params.clear();
+	string_values.clear();
+	curve_values.clear();
+}
+
+const CyclesShaderEditor::OutputParam* CyclesShaderEditor::OutputParams::find(const OutputParamId id) const
+{
+	const std::vector<OutputParam>::const_iterator param_iter = std::lower_bound(params.cbegin(), params.cend(), id, [](const OutputParam& a, OutputParamId b) {
+		return a.id < b;
+	});
+	if (param_iter == params.cend() || param_iter->id != id) {
+		return nullptr;
+	}
+	return &*param_iter;
+}
+
+const float* CyclesShaderEditor::OutputParams::find_float(const OutputParamId id) const
+{
+	const OutputParam* const param = find(id);
+	if (param == nullptr || param->type != OutputParamType::Float) {
+		return nullptr;
+	}
+	return &param->float3_value.x;
+}
+
+const CyclesShaderEditor::Float3* CyclesShaderEditor::OutputParams::find_float3(const OutputParamId id) const
+{
+	const OutputParam* const param = find(id);
+	if (param == nullptr || param->type != OutputParamType::Float3) {
+		return nullptr;
+	}
+	return &param->float3_value;
+}
+
+const std::string* CyclesShaderEditor::OutputParams::find_string(const OutputParamId id) const
+{
+	const OutputParam* const param = find(id);
+	if (param == nullptr || param->type != OutputParamType::String || param->value_index >= string_values.size()) {
+		return nullptr;
+	}
+	return &string_values[param->value_index];
+}
+
+const int* CyclesShaderEditor::OutputParams::find_int(const OutputParamId id) const
+{
+	const OutputParam* const param = find(id);
+	if (param == nullptr || param->type != OutputParamType::Int) {
+		return nullptr;
+	}
+	return &param->int_value;
+}
+
+const bool* CyclesShaderEditor::OutputParams::find_bool(const OutputParamId id) const
+{
+	const OutputParam* const param = find(id);
+	if (param == nullptr || param->type != OutputParamType::Bool) {
+		return nullptr;
+	}
+	return &param->bool_value;
+}
+
+const CyclesShaderEditor::OutputCurve* CyclesShaderEditor::OutputParams::find_curve(const OutputParamId id) const
+{
+	const OutputParam* const param = find(id);
+	if (param == nullptr || param->type != OutputParamType::Curve || param->value_index >= curve_values.size()) {
+		return nullptr;
+	}
+	return &curve_values[param->value_index];
+}
+
+const float* CyclesShaderEditor::OutputParams::find_float(const char* const name) const
+{
+	return find_float(get_output_param_id(name));
+}
+
+const CyclesShaderEditor::Float3* CyclesShaderEditor::OutputParams::find_float3(const char* const name) const
+{
+	return find_float3(get_output_param_id(name));
+}
+
+const std::string* CyclesShaderEditor::OutputParams::find_string(const char* const name) const
+{
+	return find_string(get_output_param_id(name));
+}
+
+const int* CyclesShaderEditor::OutputParams::find_int(const char* const name) const
+{
+	return find_int(get_output_param_id(name));
+}
+
+const bool* CyclesShaderEditor::OutputParams::find_bool(const char* const name) const
+{
+	return find_bool(get_output_param_id(name));
+}
+
+const CyclesShaderEditor::OutputCurve* CyclesShaderEditor::OutputParams::find_curve(const char* const name) const
+{
+	return find_curve(get_output_param_id(name));
+}
+
+void CyclesShaderEditor::OutputParams::set_float(const OutputParamId id, const float value)
+{
+	OutputParam* const param = insert(id);
+	if (param == nullptr) {
+		return;
+	}
+	param->type = OutputParamType::Float;
+	param->float3_value = Float3(value, 0.0f, 0.0f);
+}
+
+void CyclesShaderEditor::OutputParams::set_float3(const OutputParamId id, const Float3 value)
+{
+	OutputParam* const param = insert(id);
+	if (param == nullptr) {
+		return;
+	}
+	param->type = OutputParamType::Float3;
+	param->float3_value = value;
+}
+
+void CyclesShaderEditor::OutputParams::set_string(const OutputParamId id, std::string value)
+{
+	OutputParam* const param = insert(id);
+	if (param == nullptr) {
+		return;
+	}
+	// A string param that is set again keeps its slot
+	if (param->type == OutputParamType::String && param->value_index < string_values.size()) {
+		string_values[param->value_index] = std::move(value);
+		return;
+	}
+	param->type = OutputParamType::String;
+	param->value_index = static_cast<unsigned int>(string_values.size());
+	string_values.push_back(std::move(value));
+}
+
+void CyclesShaderEditor::OutputParams::set_int(const OutputParamId id, const int value)
+{
+	OutputParam* const param = insert(id);
+	if (param == nullptr) {
+		return;
+	}
+	param->type = OutputParamType::Int;
+	param->int_value = value;
+}
+
+void CyclesShaderEditor::OutputParams::set_bool(const OutputParamId id, const bool value)
+{
+	OutputParam* const param = insert(id);
+	if (param == nullptr) {
+		return;
+	}
+	param->type = OutputParamType::Bool;
+	param->bool_value = value;
+}
+
+void CyclesShaderEditor::OutputParams::set_curve(const OutputParamId id, OutputCurve value)
+{
+	OutputParam* const param = insert(id);
+	if (param == nullptr) {
+		return;
+	}
+	if (param->type == OutputParamType::Curve && param->value_index < curve_values.size()) {
+		curve_values[param->value_index] = std::move(value);
+		return;
+	}
+	param->type = OutputParamType::Curve;
+	param->value_index = static_cast<unsigned int>(curve_values.size());
+	curve_values.push_back(std::move(value));
+}
+
+bool CyclesShaderEditor::OutputParams::erase(const OutputParamId id)
+{
+	const std::vector<OutputParam>::iterator param_iter = std::lower_bound(params.begin(), params.end(), id, [](const OutputParam& a, OutputParamId b) {
+		return a.id < b;
+	});
+	if (param_iter == params.end() || param_iter->id != id) {
+		return false;
+	}
+	params.erase(param_iter);
+	return true;
+}
+
+CyclesShaderEditor::OutputParam* CyclesShaderEditor::OutputParams::insert(const OutputParamId id)
+{
+	if (id == INVALID_OUTPUT_PARAM_ID) {
+		return nullptr;
+	}
+
+	// Nodes are decoded in schema order so most params are added near the end, search from there first
+	if (params.empty() || params.back().id < id) {
+		params.push_back(OutputParam());
+		params.back().id = id;
+		return &params.back();
+	}
+
+	const std::vector<OutputParam>::iterator param_iter = std::lower_bound(params.begin(), params.end(), id, [](const OutputParam& a, OutputParamId b) {
+		return a.id < b;
+	});
+	if (param_iter != params.end() && param_iter->id == id) {
+		return &*param_iter;
+	}
+	OutputParam new_param;
+	new_param.id = id;
+	return &*params.insert(param_iter, new_param);
+}
+
+// Moves the entries of one map into params, entries with unknown names are left in the map
+template <typename T, typename SetFunc>
+static void flatten_param_map(std::map<std::string, T>& values, SetFunc set_func)
+{
+	using namespace CyclesShaderEditor;
+
+	for (typename std::map<std::string, T>::iterator iter = values.begin(); iter != values.end(); ) {
+		const OutputParamId id = get_output_param_id(iter->first);
+		if (id == INVALID_OUTPUT_PARAM_ID) {
+			++iter;
+			continue;
+		}
+		set_func(id, std::move(iter->second));
+		iter = values.erase(iter);
+	}
+}
+
+void CyclesShaderEditor::flatten_output_params(OutputNode& node)
+{
+	OutputParams& params = node.params;
+	flatten_param_map(node.float_values, [&params](OutputParamId id, float value) { params.set_float(id, value); });
+	flatten_param_map(node.float3_values, [&params](OutputParamId id, Float3 value) { params.set_float3(id, value); });
+	flatten_param_map(node.string_values, [&params](OutputParamId id, std::string value) { params.set_string(id, std::move(value)); });
+	flatten_param_map(node.int_values, [&params](OutputParamId id, int value) { params.set_int(id, value); });
+	flatten_param_map(node.bool_values, [&params](OutputParamId id, bool value) { params.set_bool(id, value); });
+	flatten_param_map(node.curve_values, [&params](OutputParamId id, OutputCurve value) { params.set_curve(id, std::move(value)); });
+}
+
+void CyclesShaderEditor::expand_output_params(OutputNode& node)
+{
+	for (OutputParam& param : node.params.params) {
+		const std::string& name = get_output_param_name(param.id);
+		switch (param.type) {
+		case OutputParamType::Float:
+			node.float_values[name] = param.float3_value.x;
+			break;
+		case OutputParamType::Float3:
+			node.float3_values[name] = param.float3_value;
+			break;
+		case OutputParamType::String:
+			node.string_values[name] = std::move(node.params.string_values[param.value_index]);
+			break;
+		case OutputParamType::Int:
+			node.int_values[name] = param.int_value;
+			break;
+		case OutputParamType::Bool:
+			node.bool_values[name] = param.bool_value;
+			break;
+		case OutputParamType::Curve:
+			node.curve_values[name] = std::move(node.params.curve_values[param.value_index]);
+			break;
+		}
+	}
+	node.params.clear();
+}
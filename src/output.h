@@ -80,6 +80,14 @@ namespace CyclesShaderEditor {
 		Count,
 	};
 
+	// Encodings produced by the editor, decoders detect the format from the graph's header
+	enum class SerializedGraphFormat {
+		// Pipe-delimited text, version 1
+		Text,
+		// Interned strings and raw little-endian values, version 2
+		Binary,
+	};
+
 	class Float2 {
 	public:
 		Float2();
@@ -102,6 +110,80 @@ namespace CyclesShaderEditor {
 		std::vector<float> samples;
 	};
 
+	// Interned param name, ids follow the alphabetical order of the names so params sorted by id are also sorted by name
+	typedef unsigned short OutputParamId;
+	constexpr OutputParamId INVALID_OUTPUT_PARAM_ID = 0xffff;
+
+	// Returns INVALID_OUTPUT_PARAM_ID for a name that no node type uses
+	OutputParamId get_output_param_id(const char* name);
+	OutputParamId get_output_param_id(const std::string& name);
+	// Returns an empty string for an invalid id
+	const std::string& get_output_param_name(OutputParamId id);
+
+	enum class OutputParamType : unsigned char {
+		Float,
+		Float3,
+		String,
+		Int,
+		Bool,
+		Curve,
+	};
+
+	struct OutputParam {
+		OutputParamId id = INVALID_OUTPUT_PARAM_ID;
+		OutputParamType type = OutputParamType::Float;
+		bool bool_value = false;
+		int int_value = 0;
+		// Float params only use x
+		Float3 float3_value;
+		// Position of a String or Curve param's value in OutputParams::string_values or OutputParams::curve_values
+		unsigned int value_index = 0;
+	};
+
+	// Flat storage for the params of one node, a single array sorted by id instead of one map per type
+	class OutputParams {
+	public:
+		bool empty() const;
+		size_t size() const;
+		void clear();
+
+		// Lookups return nullptr if there is no param with that name and type
+		const OutputParam* find(OutputParamId id) const;
+		const float* find_float(OutputParamId id) const;
+		const Float3* find_float3(OutputParamId id) const;
+		const std::string* find_string(OutputParamId id) const;
+		const int* find_int(OutputParamId id) const;
+		const bool* find_bool(OutputParamId id) const;
+		const OutputCurve* find_curve(OutputParamId id) const;
+
+		const float* find_float(const char* name) const;
+		const Float3* find_float3(const char* name) const;
+		const std::string* find_string(const char* name) const;
+		const int* find_int(const char* name) const;
+		const bool* find_bool(const char* name) const;
+		const OutputCurve* find_curve(const char* name) const;
+
+		// Adding a param replaces any existing param with the same id, invalid ids are ignored
+		void set_float(OutputParamId id, float value);
+		void set_float3(OutputParamId id, Float3 value);
+		void set_string(OutputParamId id, std::string value);
+		void set_int(OutputParamId id, int value);
+		void set_bool(OutputParamId id, bool value);
+		void set_curve(OutputParamId id, OutputCurve value);
+
+		// Returns false if there is no param with that id
+		// A string or curve value stays in its vector until the params are cleared, as when a param changes type
+		bool erase(OutputParamId id);
+
+		std::vector<OutputParam> params;
+		std::vector<std::string> string_values;
+		std::vector<OutputCurve> curve_values;
+
+	private:
+		// Returns the param with the given id, a new param is added in sorted position if there is none
+		OutputParam* insert(OutputParamId id);
+	};
+
 	struct OutputNode {
 		CyclesNodeType type;
 
@@ -116,8 +198,25 @@ namespace CyclesShaderEditor {
 		std::map<std::string, int> int_values;
 		std::map<std::string, bool> bool_values;
 		std::map<std::string, OutputCurve> curve_values;
+
+		// Flat form of the params above, see OutputParamLayout
+		// A node's params are normally all in one form, the other form is left empty
+		OutputParams params;
 	};
 
+	// Form of the params in decoded OutputNodes
+	enum class OutputParamLayout {
+		// OutputNode::params
+		Flat,
+		// OutputNode's per-type maps
+		Maps,
+	};
+
+	// Move a node's params from one form to the other
+	// Names that get_output_param_id does not know stay in the maps when flattening
+	void flatten_output_params(OutputNode& node);
+	void expand_output_params(OutputNode& node);
+
 	struct OutputConnection {
 		std::string source_node;
 		std::string source_socket;
@@ -0,0 +1,81 @@
+#pragma once
+
+#include <map>
+#include <string>
+
+#include "output.h"
+
+namespace CyclesShaderEditor {
+
+	// Calls the visitor once for each param of a node in the order serialized graphs store them,
+	// floats first then float3s, strings, ints, bools and curves, each sorted by name
+	// Works with either param form, the visitor needs visit_float, visit_float3, visit_string, visit_int, visit_bool and visit_curve
+	// that each take the param's name and value
+	template <typename Visitor>
+	void visit_output_params(const OutputNode& node, Visitor& visitor)
+	{
+		const OutputParams& params = node.params;
+
+		for (const std::pair<const std::string, float>& this_pair : node.float_values) {
+			visitor.visit_float(this_pair.first, this_pair.second);
+		}
+		for (const OutputParam& param : params.params) {
+			if (param.type == OutputParamType::Float) {
+				visitor.visit_float(get_output_param_name(param.id), param.float3_value.x);
+			}
+		}
+
+		for (const std::pair<const std::string, Float3>& this_pair : node.float3_values) {
+			visitor.visit_float3(this_pair.first, this_pair.second);
+		}
+		for (const OutputParam& param : params.params) {
+			if (param.type == OutputParamType::Float3) {
+				visitor.visit_float3(get_output_param_name(param.id), param.float3_value);
+			}
+		}
+
+		for (const std::pair<const std::string, std::string>& this_pair : node.string_values) {
+			visitor.visit_string(this_pair.first, this_pair.second);
+		}
+		for (const OutputParam& param : params.params) {
+			if (param.type == OutputParamType::String) {
+				visitor.visit_string(get_output_param_name(param.id), params.string_values[param.value_index]);
+			}
+		}
+
+		for (const std::pair<const std::string, int>& this_pair : node.int_values) {
+			visitor.visit_int(this_pair.first, this_pair.second);
+		}
+		for (const OutputParam& param : params.params) {
+			if (param.type == OutputParamType::Int) {
+				visitor.visit_int(get_output_param_name(param.id), param.int_value);
+			}
+		}
+
+		for (const std::pair<const std::string, bool>& this_pair : node.bool_values) {
+			visitor.visit_bool(this_pair.first, this_pair.second);
+		}
+		for (const OutputParam& param : params.params) {
+			if (param.type == OutputParamType::Bool) {
+				visitor.visit_bool(get_output_param_name(param.id), param.bool_value);
+			}
+		}
+
+		for (const std::pair<const std::string, OutputCurve>& this_pair : node.curve_values) {
+			visitor.visit_curve(this_pair.first, this_pair.second);
+		}
+		for (const OutputParam& param : params.params) {
+			if (param.type == OutputParamType::Curve) {
+				visitor.visit_curve(get_output_param_name(param.id), params.curve_values[param.value_index]);
+			}
+		}
+	}
+
+	// Number of params visit_output_params would visit
+	inline size_t get_output_param_count(const OutputNode& node)
+	{
+		return node.float_values.size() + node.float3_values.size() + node.string_values.size() +
+			node.int_values.size() + node.bool_values.size() + node.curve_values.size() + node.params.size();
+	}
+
+}
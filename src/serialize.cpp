@@ -1,743 +1,2998 @@
 #include "serialize.h"
 
-#include <cassert>
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <initializer_list>
+#include <iterator>
 #include <map>
 #include <string>
-#include <sstream>
-
-#include "node_colors.h"
-#include "node_converter.h"
-#include "node_inputs.h"
-#include "node_interop_max.h"
-#include "node_outputs.h"
-#include "node_shaders.h"
-#include "node_textures.h"
-#include "node_vector.h"
+#include <unordered_set>
+
+#include "config.h"
+#include "curve.h"
+#include "graph_decoder.h"
+#include "graph_hash.h"
+#include "graph_patch.h"
+#include "node_registry.h"
+#include "node_schema.h"
 #include "output.h"
+#include "output_visit.h"
+#include "util_arena.h"
+#include "util_number.h"
+#include "util_tokenizer.h"
 
 static const char SEPARATOR = '|';
 
 static const char* MAGIC_WORD = "cycles_shader";
 static const char* CURRENT_VERSION = "1";
 
+// Binary graphs start with the same magic word and a different version so they can be told apart from text
+static const char* BINARY_HEADER = "cycles_shader|2|";
+
 static const char* SECTION_LABEL_NODE = "section_nodes";
 static const char* SECTION_LABEL_CONNECTION = "section_connections";
 
 static const char* NODE_END = "node_end";
 
-std::map<CyclesShaderEditor::CyclesNodeType, std::string> type_to_code;
-std::map<std::string, CyclesShaderEditor::CyclesNodeType> code_to_type;
+// Every node other than the material output is named after its place in the canonical order
+static std::string get_node_name(size_t index)
+{
+	return std::string("node") + std::to_string(index);
+}
+
+// Type code first so the order does not depend on how CyclesNodeType is numbered
+static bool canonical_node_less(CyclesShaderEditor::CyclesNodeType a_type, float a_x, float a_y, CyclesShaderEditor::CyclesNodeType b_type, float b_x, float b_y)
+{
+	using namespace CyclesShaderEditor;
+
+	if (a_type != b_type) {
+		const NodeTypeInfo* const a_info = get_node_type_info(a_type);
+		const NodeTypeInfo* const b_info = get_node_type_info(b_type);
+		if (a_info == nullptr || b_info == nullptr) {
+			return a_info == nullptr && b_info != nullptr;
+		}
+		return strcmp(a_info->code, b_info->code) < 0;
+	}
+	if (a_y != b_y) {
+		return a_y < b_y;
+	}
+	return a_x < b_x;
+}
+
+static bool canonical_node_less(const CyclesShaderEditor::OutputNode& a, const CyclesShaderEditor::OutputNode& b)
+{
+	return canonical_node_less(a.type, a.world_x, a.world_y, b.type, b.world_x, b.world_y);
+}
+
+// Defined with the rest of the text writer below
+static void serialize_node_body(const CyclesShaderEditor::OutputNode& node, std::string& out);
+
+// A connection as it is ordered in the output, node indices are positions in the canonical node order
+typedef CyclesShaderEditor::GraphHashEdge ConnectionSortKey;
 
-static std::string create_node_name()
+static bool canonical_connection_less(const ConnectionSortKey& a, const ConnectionSortKey& b)
 {
-	static int number = 0;
-	return std::string("node") + std::to_string(number++);
+	if (a.dest_node != b.dest_node) {
+		return a.dest_node < b.dest_node;
+	}
+	if (*a.dest_socket != *b.dest_socket) {
+		return *a.dest_socket < *b.dest_socket;
+	}
+	if (a.source_node != b.source_node) {
+		return a.source_node < b.source_node;
+	}
+	return *a.source_socket < *b.source_socket;
 }
 
-static void initialize_maps()
+// Both ends of an output connection, as indices into the nodes added to the output list
+struct ConnectionEnds {
+	size_t source_node;
+	size_t dest_node;
+};
+
+// Puts the nodes and connections added after first_node and first_connection in an order that only depends on the graph's content,
+// then names the nodes after their place in that order
+// This way the same graph always produces the same output lists, whatever order the editor happens to keep its nodes in
+// Nodes of the same type at the same position are ordered by their encoded body, only nodes that are the same in every
+// way keep their incoming order as which of them gets which name makes no difference to the nodes section
+// Temporary lists are taken from scratch
+static void canonicalize_output_lists(
+	std::vector<CyclesShaderEditor::OutputNode>& nodes,
+	size_t first_node,
+	std::vector<CyclesShaderEditor::OutputConnection>& connections,
+	size_t first_connection,
+	const CyclesShaderEditor::ArenaVector<ConnectionEnds>& connection_ends,
+	CyclesShaderEditor::MonotonicArena& scratch)
 {
 	using namespace CyclesShaderEditor;
 
-	if (!type_to_code.empty()) {
-		return;
+	const size_t node_count = nodes.size() - first_node;
+	ArenaVector<size_t> node_order(node_count, scratch);
+	for (size_t i = 0; i < node_count; i++) {
+		node_order[i] = i;
+	}
+	std::stable_sort(node_order.begin(), node_order.end(), [&](size_t a, size_t b) {
+		return canonical_node_less(nodes[first_node + a], nodes[first_node + b]);
+	});
+
+	// Bodies are only encoded for runs of nodes that tie, most graphs have none
+	for (size_t run_begin = 0; run_begin < node_count; ) {
+		size_t run_end = run_begin + 1;
+		while (run_end < node_count && !canonical_node_less(nodes[first_node + node_order[run_begin]], nodes[first_node + node_order[run_end]])) {
+			run_end++;
+		}
+		if (run_end - run_begin > 1) {
+			ArenaVector<std::string> tie_bodies(run_end - run_begin, scratch);
+			ArenaVector<size_t> tie_order(run_end - run_begin, scratch);
+			for (size_t i = 0; i < tie_order.size(); i++) {
+				serialize_node_body(nodes[first_node + node_order[run_begin + i]], tie_bodies[i]);
+				tie_order[i] = i;
+			}
+			std::stable_sort(tie_order.begin(), tie_order.end(), [&](size_t a, size_t b) {
+				return tie_bodies[a] < tie_bodies[b];
+			});
+			ArenaVector<size_t> run_order(scratch);
+			run_order.reserve(tie_order.size());
+			for (size_t i : tie_order) {
+				run_order.push_back(node_order[run_begin + i]);
+			}
+			std::copy(run_order.begin(), run_order.end(), node_order.begin() + run_begin);
+		}
+		run_begin = run_end;
 	}
 
-	type_to_code[CyclesNodeType::AmbientOcclusion] = std::string("ambient_occlusion");
-	type_to_code[CyclesNodeType::PrincipledBSDF] = std::string("principled_bsdf");
-	type_to_code[CyclesNodeType::MixShader] = std::string("mix_shader");
-	type_to_code[CyclesNodeType::AddShader] = std::string("add_shader");
-	type_to_code[CyclesNodeType::DiffuseBSDF] = std::string("diffuse_bsdf");
-	type_to_code[CyclesNodeType::GlossyBSDF] = std::string("glossy_bsdf");
-	type_to_code[CyclesNodeType::TransparentBSDF] = std::string("transparent_bsdf");
-	type_to_code[CyclesNodeType::RefractionBSDF] = std::string("refraction_bsdf");
-	type_to_code[CyclesNodeType::GlassBSDF] = std::string("glass_bsdf");
-	type_to_code[CyclesNodeType::TranslucentBSDF] = std::string("translucent_bsdf");
-	type_to_code[CyclesNodeType::AnisotropicBSDF] = std::string("anisotropic_bsdf");
-	type_to_code[CyclesNodeType::VelvetBSDF] = std::string("velvet_bsdf");
-	type_to_code[CyclesNodeType::ToonBSDF] = std::string("toon_bsdf");
-	type_to_code[CyclesNodeType::SubsurfaceScattering] = std::string("subsurface_scatter");
-	type_to_code[CyclesNodeType::Emission] = std::string("emission");
-	type_to_code[CyclesNodeType::HairBSDF] = std::string("hair_bsdf");
-	type_to_code[CyclesNodeType::Holdout] = std::string("holdout");
-	type_to_code[CyclesNodeType::VolAbsorption] = std::string("vol_absorb");
-	type_to_code[CyclesNodeType::VolScatter] = std::string("vol_scatter");
-
-	type_to_code[CyclesNodeType::MaxTex] = std::string("max_tex");
-	type_to_code[CyclesNodeType::BrickTex] = std::string("brick_tex");
-	type_to_code[CyclesNodeType::CheckerTex] = std::string("checker_tex");
-	type_to_code[CyclesNodeType::GradientTex] = std::string("gradient_tex");
-	type_to_code[CyclesNodeType::MagicTex] = std::string("magic_tex");
-	type_to_code[CyclesNodeType::MusgraveTex] = std::string("musgrave_tex");
-	type_to_code[CyclesNodeType::NoiseTex] = std::string("noise_tex");
-	type_to_code[CyclesNodeType::VoronoiTex] = std::string("voronoi_tex");
-	type_to_code[CyclesNodeType::WaveTex] = std::string("wave_tex");
-
-	type_to_code[CyclesNodeType::LightPath] = std::string("light_path");
-	type_to_code[CyclesNodeType::Fresnel] = std::string("fresnel");
-	type_to_code[CyclesNodeType::LayerWeight] = std::string("layer_weight");
-	type_to_code[CyclesNodeType::CameraData] = std::string("camera_data");
-	type_to_code[CyclesNodeType::Tangent] = std::string("tangent");
-	type_to_code[CyclesNodeType::TextureCoordinate] = std::string("texture_coordinate");
-	type_to_code[CyclesNodeType::Geometry] = std::string("geometry");
-	type_to_code[CyclesNodeType::ObjectInfo] = std::string("object_info");
-	type_to_code[CyclesNodeType::RGB] = std::string("rgb");
-	type_to_code[CyclesNodeType::Value] = std::string("value");
-	type_to_code[CyclesNodeType::Wireframe] = std::string("wireframe");
-
-	type_to_code[CyclesNodeType::MixRGB] = std::string("mix_rgb");
-	type_to_code[CyclesNodeType::Invert] = std::string("invert");
-	type_to_code[CyclesNodeType::LightFalloff] = std::string("light_falloff");
-	type_to_code[CyclesNodeType::HSV] = std::string("hsv");
-	type_to_code[CyclesNodeType::Gamma] = std::string("gamma");
-	type_to_code[CyclesNodeType::BrightnessContrast] = std::string("bright_contrast");
-	type_to_code[CyclesNodeType::RGBCurves] = std::string("rgb_curves");
-
-	type_to_code[CyclesNodeType::Bump] = std::string("bump");
-	type_to_code[CyclesNodeType::NormalMap] = std::string("normal_map");
-	type_to_code[CyclesNodeType::VectorTransform] = std::string("vector_transform");
-
-	type_to_code[CyclesNodeType::Blackbody] = std::string("blackbody");
-	type_to_code[CyclesNodeType::CombineHSV] = std::string("combine_hsv");
-	type_to_code[CyclesNodeType::CombineRGB] = std::string("combine_rgb");
-	type_to_code[CyclesNodeType::CombineXYZ] = std::string("combine_xyz");
-	type_to_code[CyclesNodeType::Math] = std::string("math");
-	type_to_code[CyclesNodeType::RGBtoBW] = std::string("rgb_to_bw");
-	type_to_code[CyclesNodeType::SeparateHSV] = std::string("separate_hsv");
-	type_to_code[CyclesNodeType::SeparateRGB] = std::string("separate_rgb");
-	type_to_code[CyclesNodeType::SeparateXYZ] = std::string("separate_xyz");
-	type_to_code[CyclesNodeType::VectorMath] = std::string("vector_math");
-	type_to_code[CyclesNodeType::Wavelength] = std::string("wavelength");
-
-	type_to_code[CyclesNodeType::MaterialOutput] = std::string("out_material");
-
-	for (std::pair<CyclesNodeType, std::string> this_pair : type_to_code) {
-		code_to_type[this_pair.second] = this_pair.first;
-	}
-
-	assert(code_to_type.size() == type_to_code.size());
-}
-
-static std::list<std::string> tokenize_string(std::string input, char delim)
-{
-	std::list<std::string> output;
-
-	std::string::size_type index = 0;
-	std::string::size_type next_delim = input.find(delim);
-	while (next_delim != std::string::npos) {
-		output.push_back(input.substr(index, next_delim - index));
-		index = next_delim + 1;
-		next_delim = input.find(delim, index);
-
-		if (next_delim == std::string::npos) {
-			output.push_back(input.substr(index, input.length()));
+	ArenaVector<OutputNode> sorted_nodes(scratch);
+	sorted_nodes.reserve(node_count);
+	ArenaVector<size_t> new_node_index(node_count, scratch);
+	for (size_t i = 0; i < node_count; i++) {
+		new_node_index[node_order[i]] = i;
+		sorted_nodes.push_back(std::move(nodes[first_node + node_order[i]]));
+		// The material output keeps the name "output"
+		if (sorted_nodes.back().type != CyclesNodeType::MaterialOutput) {
+			sorted_nodes.back().name = get_node_name(i);
 		}
 	}
+	std::move(sorted_nodes.begin(), sorted_nodes.end(), nodes.begin() + first_node);
+
+	const size_t connection_count = connections.size() - first_connection;
+	ArenaVector<ConnectionSortKey> connection_keys(connection_count, scratch);
+	ArenaVector<size_t> connection_order(connection_count, scratch);
+	for (size_t i = 0; i < connection_count; i++) {
+		const OutputConnection& connection = connections[first_connection + i];
+		connection_keys[i].source_node = new_node_index[connection_ends[i].source_node];
+		connection_keys[i].source_socket = &connection.source_socket;
+		connection_keys[i].dest_node = new_node_index[connection_ends[i].dest_node];
+		connection_keys[i].dest_socket = &connection.dest_socket;
+		connection_order[i] = i;
+	}
+	std::sort(connection_order.begin(), connection_order.end(), [&](size_t a, size_t b) {
+		return canonical_connection_less(connection_keys[a], connection_keys[b]);
+	});
+
+	ArenaVector<OutputConnection> sorted_connections(scratch);
+	sorted_connections.reserve(connection_count);
+	for (size_t i = 0; i < connection_count; i++) {
+		const size_t old_index = connection_order[i];
+		sorted_connections.push_back(std::move(connections[first_connection + old_index]));
+		OutputConnection& connection = sorted_connections.back();
+		connection.source_node = nodes[first_node + new_node_index[connection_ends[old_index].source_node]].name;
+		connection.dest_node = nodes[first_node + new_node_index[connection_ends[old_index].dest_node]].name;
+	}
+	std::move(sorted_connections.begin(), sorted_connections.end(), connections.begin() + first_connection);
+}
 
-	return output;
+static bool read_float(CyclesShaderEditor::StringSlice token, float& result)
+{
+	return CyclesShaderEditor::parse_float(token, result) == CyclesShaderEditor::NumberParseResult::Success;
+}
+
+static bool read_int(CyclesShaderEditor::StringSlice token, int& result)
+{
+	return CyclesShaderEditor::parse_int(token, result) == CyclesShaderEditor::NumberParseResult::Success;
 }
 
-static std::string serialize_curve(const CyclesShaderEditor::OutputCurve& curve)
+static void serialize_curve(const CyclesShaderEditor::OutputCurve& curve, std::string& out)
 {
+	using namespace CyclesShaderEditor;
+
 	constexpr char CURVE_SEPARATOR = ',';
-	std::stringstream curve_stream;
-	curve_stream << "curve00" << CURVE_SEPARATOR;
-	if (curve.enum_curve_interp == static_cast<int>(CyclesShaderEditor::CurveInterpolation::CUBIC_HERMITE)) {
-		curve_stream << "cubic_hermite" << CURVE_SEPARATOR;
+	out.append("curve00");
+	out.push_back(CURVE_SEPARATOR);
+	if (curve.enum_curve_interp == static_cast<int>(CurveInterpolation::CUBIC_HERMITE)) {
+		out.append("cubic_hermite");
 	}
 	else {
-		curve_stream << "linear" << CURVE_SEPARATOR;
+		out.append("linear");
 	}
-	curve_stream << curve.control_points.size();
-
-	curve_stream.precision(6);
-	for (const CyclesShaderEditor::Float2& this_point : curve.control_points) {
-		curve_stream << CURVE_SEPARATOR << this_point.x << CURVE_SEPARATOR << this_point.y ;
+	out.push_back(CURVE_SEPARATOR);
+	append_int(out, static_cast<int>(curve.control_points.size()));
+
+	for (const Float2& this_point : curve.control_points) {
+		out.push_back(CURVE_SEPARATOR);
+		append_float(out, this_point.x);
+		out.push_back(CURVE_SEPARATOR);
+		append_float(out, this_point.y);
 	}
-
-	return curve_stream.str();
 }
 
-static void deserialize_curve(std::string serialized_curve, CyclesShaderEditor::CurveSocketValue* curve_value)
+// Parses a serialized curve into its control points and interpolation
+// Returns false if the curve is not valid, the outputs are left untouched in that case
+static bool parse_curve(CyclesShaderEditor::StringSlice serialized_curve, std::vector<CyclesShaderEditor::Point2>& points_out, CyclesShaderEditor::CurveInterpolation& interp_out)
 {
-	curve_value->reset_value();
+	using CyclesShaderEditor::StringSlice;
+
 	constexpr char CURVE_SEPARATOR = ',';
-	std::list<std::string> tokenized_input = tokenize_string(serialized_curve, CURVE_SEPARATOR);
+	CyclesShaderEditor::Tokenizer tokenizer(serialized_curve, CURVE_SEPARATOR);
+
+	StringSlice identifier;
+	StringSlice interpolation_str;
+	StringSlice control_point_count_str;
 
 	// The input must have at least 5 entries to be valid
-	if (tokenized_input.size() < 5) {
-		return;
+	if (!tokenizer.next(identifier) || !tokenizer.next(interpolation_str) || !tokenizer.next(control_point_count_str) || tokenizer.at_end()) {
+		return false;
 	}
 
-	std::list<std::string>::iterator input_iter = tokenized_input.begin();
-	std::string identifier = *(input_iter++);
-	std::string interpolation_str = *(input_iter++);
-	std::string control_point_count_str = *(input_iter++);
-
 	// Make sure we understand this curve format
 	if (identifier != "curve00") {
-		return;
+		return false;
 	}
 
-	// Make sure the number of points and total number of tokens match
-	const int control_point_count = std::stoi(control_point_count_str);
-	if (control_point_count < 1 || tokenized_input.size() != 3 + 2 * control_point_count) {
-		return;
+	int control_point_count = 0;
+	if (!read_int(control_point_count_str, control_point_count) || control_point_count < 1) {
+		return false;
 	}
 
-	curve_value->curve_points.clear();
-	for (int points_copied = 0; points_copied < control_point_count; points_copied++) {
-		const float x = std::stof(*(input_iter++));
-		const float y = std::stof(*(input_iter++));
-		CyclesShaderEditor::Point2 this_point(x, y);
-		curve_value->curve_points.push_back(this_point);
+	// Make sure the number of points and total number of tokens match
+	std::vector<CyclesShaderEditor::Point2> curve_points;
+	curve_points.reserve(control_point_count);
+	for (int points_read = 0; points_read < control_point_count; points_read++) {
+		StringSlice x_str;
+		StringSlice y_str;
+		if (!tokenizer.next(x_str) || !tokenizer.next(y_str)) {
+			return false;
+		}
+		float x = 0.0f;
+		float y = 0.0f;
+		if (!read_float(x_str, x) || !read_float(y_str, y)) {
+			return false;
+		}
+		curve_points.push_back(CyclesShaderEditor::Point2(x, y));
 	}
-	curve_value->sort_curve_points();
+	if (!tokenizer.at_end()) {
+		return false;
+	}
+
+	points_out.swap(curve_points);
 
 	if (interpolation_str == "cubic_hermite") {
-		curve_value->curve_interp = CyclesShaderEditor::CurveInterpolation::CUBIC_HERMITE;
+		interp_out = CyclesShaderEditor::CurveInterpolation::CUBIC_HERMITE;
 	}
 	else {
-		curve_value->curve_interp = CyclesShaderEditor::CurveInterpolation::LINEAR;
+		interp_out = CyclesShaderEditor::CurveInterpolation::LINEAR;
 	}
+
+	return true;
 }
 
-static std::string serialize_node(const CyclesShaderEditor::OutputNode& node)
+// Appends a token followed by the separator
+static void append_token(std::string& out, const std::string& token)
 {
-	using namespace CyclesShaderEditor;
-
-	if (type_to_code.count(node.type) == 0) {
-		return std::string();
-	}
-
-	std::stringstream node_stream;
+	out.append(token);
+	out.push_back(SEPARATOR);
+}
 
-	node_stream << type_to_code[node.type] << SEPARATOR << node.name << SEPARATOR << node.world_x << SEPARATOR << node.world_y << SEPARATOR;
+static void append_token(std::string& out, const char* token)
+{
+	out.append(token);
+	out.push_back(SEPARATOR);
+}
 
-	for (std::pair<std::string, float> this_pair : node.float_values) {
-		node_stream << this_pair.first << SEPARATOR << this_pair.second << SEPARATOR;
+// Everything that follows the node's type and name
+// Appends each param of a node as a name/value token pair, see visit_output_params
+class TextParamWriter {
+public:
+	TextParamWriter(std::string& out) : out(out) {}
+
+	void visit_float(const std::string& name, float value)
+	{
+		append_token(out, name);
+		CyclesShaderEditor::append_float(out, value);
+		out.push_back(SEPARATOR);
 	}
-	for (std::pair<std::string, Float3> this_pair : node.float3_values) {
-		node_stream << this_pair.first << SEPARATOR
-			<< this_pair.second.x << ',' << this_pair.second.y << ',' << this_pair.second.z << SEPARATOR;
+
+	void visit_float3(const std::string& name, const CyclesShaderEditor::Float3& value)
+	{
+		append_token(out, name);
+		CyclesShaderEditor::append_float(out, value.x);
+		out.push_back(',');
+		CyclesShaderEditor::append_float(out, value.y);
+		out.push_back(',');
+		CyclesShaderEditor::append_float(out, value.z);
+		out.push_back(SEPARATOR);
 	}
-	for (std::pair<std::string, std::string> this_pair : node.string_values) {
-		node_stream << this_pair.first << SEPARATOR << this_pair.second << SEPARATOR;
+
+	void visit_string(const std::string& name, const std::string& value)
+	{
+		append_token(out, name);
+		append_token(out, value);
 	}
-	for (std::pair<std::string, int> this_pair : node.int_values) {
-		node_stream << this_pair.first << SEPARATOR << this_pair.second << SEPARATOR;
+
+	void visit_int(const std::string& name, int value)
+	{
+		append_token(out, name);
+		CyclesShaderEditor::append_int(out, value);
+		out.push_back(SEPARATOR);
 	}
-	for (std::pair<std::string, bool> this_pair : node.bool_values) {
-		node_stream << this_pair.first << SEPARATOR << static_cast<int>(this_pair.second) << SEPARATOR;
+
+	void visit_bool(const std::string& name, bool value)
+	{
+		append_token(out, name);
+		CyclesShaderEditor::append_int(out, static_cast<int>(value));
+		out.push_back(SEPARATOR);
 	}
-	for (std::pair<std::string, OutputCurve> this_pair : node.curve_values) {
-		node_stream << this_pair.first << SEPARATOR << serialize_curve(this_pair.second) << SEPARATOR;
+
+	void visit_curve(const std::string& name, const CyclesShaderEditor::OutputCurve& value)
+	{
+		append_token(out, name);
+		serialize_curve(value, out);
+		out.push_back(SEPARATOR);
 	}
 
-	node_stream << NODE_END << SEPARATOR;
+private:
+	std::string& out;
+};
+
+static void serialize_node_body(const CyclesShaderEditor::OutputNode& node, std::string& out)
+{
+	using namespace CyclesShaderEditor;
+
+	append_float(out, node.world_x);
+	out.push_back(SEPARATOR);
+	append_float(out, node.world_y);
+	out.push_back(SEPARATOR);
 
-	return node_stream.str();
+	TextParamWriter param_writer(out);
+	visit_output_params(node, param_writer);
+
+	out.append(NODE_END);
+	out.push_back(SEPARATOR);
+}
+
+static void serialize_node(const CyclesShaderEditor::OutputNode& node, std::string& out)
+{
+	using namespace CyclesShaderEditor;
+
+	const NodeTypeInfo* const type_info = get_node_type_info(node.type);
+	if (type_info == nullptr) {
+		return;
+	}
+
+	append_token(out, type_info->code);
+	append_token(out, node.name);
+	serialize_node_body(node, out);
 }
 
-static std::string serialize_connection(const CyclesShaderEditor::OutputConnection& connection)
+static void serialize_connection(const CyclesShaderEditor::OutputConnection& connection, std::string& out)
 {
-	std::stringstream connection_stream;
-	connection_stream << connection.source_node << SEPARATOR << connection.source_socket << SEPARATOR << connection.dest_node << SEPARATOR << connection.dest_socket << SEPARATOR;
-	return connection_stream.str();
+	append_token(out, connection.source_node);
+	append_token(out, connection.source_socket);
+	append_token(out, connection.dest_node);
+	append_token(out, connection.dest_socket);
 }
 
 void CyclesShaderEditor::generate_output_lists(std::list<EditorNode*>& node_list, std::list<NodeConnection>& connection_list, std::vector<OutputNode>& out_node_list, std::vector<OutputConnection>& out_connection_list)
 {
 	using namespace CyclesShaderEditor;
 
-	std::map<EditorNode*, std::string> node_to_name_map;
+	const size_t first_node = out_node_list.size();
+	const size_t first_connection = out_connection_list.size();
+
+	MonotonicArena scratch;
+	ArenaMap<EditorNode*, size_t> node_indices(scratch);
 
 	for (EditorNode* this_node : node_list) {
 		OutputNode this_out_node;
-		this_out_node.name = create_node_name();
-
 		this_node->update_output_node(this_out_node);
 
-		out_node_list.push_back(this_out_node);
-		node_to_name_map[this_node] = this_out_node.name;
+		node_indices[this_node] = out_node_list.size() - first_node;
+		out_node_list.push_back(std::move(this_out_node));
 	}
 
+	ArenaVector<ConnectionEnds> connection_ends(scratch);
+	connection_ends.reserve(connection_list.size());
 	for (NodeConnection this_connection : connection_list) {
+		ArenaMap<EditorNode*, size_t>::const_iterator source_iter = node_indices.find(this_connection.begin_socket->parent);
+		ArenaMap<EditorNode*, size_t>::const_iterator dest_iter = node_indices.find(this_connection.end_socket->parent);
+		if (source_iter == node_indices.end() || dest_iter == node_indices.end()) {
+			continue;
+		}
+
+		ConnectionEnds ends;
+		ends.source_node = source_iter->second;
+		ends.dest_node = dest_iter->second;
+		connection_ends.push_back(ends);
+
 		OutputConnection this_out_connection;
-		this_out_connection.source_node = node_to_name_map[this_connection.begin_socket->parent];
-		this_out_connection.dest_node = node_to_name_map[this_connection.end_socket->parent];
 		this_out_connection.source_socket = this_connection.begin_socket->display_name;
 		this_out_connection.dest_socket = this_connection.end_socket->display_name;
 		out_connection_list.push_back(this_out_connection);
 	}
+
+	// Names are filled in here
+	canonicalize_output_lists(out_node_list, first_node, out_connection_list, first_connection, connection_ends, scratch);
+}
+
+void CyclesShaderEditor::canonicalize_output_lists(std::vector<OutputNode>& nodes, std::vector<OutputConnection>& connections)
+{
+	MonotonicArena scratch;
+	ArenaMap<StringSlice, size_t> node_indices(scratch);
+	for (size_t i = 0; i < nodes.size(); i++) {
+		node_indices[StringSlice(nodes[i].name)] = i;
+	}
+
+	ArenaVector<ConnectionEnds> connection_ends(scratch);
+	connection_ends.reserve(connections.size());
+	size_t kept_connections = 0;
+	for (size_t i = 0; i < connections.size(); i++) {
+		ArenaMap<StringSlice, size_t>::const_iterator source_iter = node_indices.find(StringSlice(connections[i].source_node));
+		ArenaMap<StringSlice, size_t>::const_iterator dest_iter = node_indices.find(StringSlice(connections[i].dest_node));
+		if (source_iter == node_indices.end() || dest_iter == node_indices.end()) {
+			continue;
+		}
+
+		ConnectionEnds ends;
+		ends.source_node = source_iter->second;
+		ends.dest_node = dest_iter->second;
+		connection_ends.push_back(ends);
+		if (kept_connections != i) {
+			connections[kept_connections] = std::move(connections[i]);
+		}
+		kept_connections++;
+	}
+	connections.resize(kept_connections);
+
+	::canonicalize_output_lists(nodes, 0, connections, 0, connection_ends, scratch);
+}
+
+// Magic word, version and the label of the node section
+static void append_text_header(std::string& out)
+{
+	out.append(MAGIC_WORD);
+	out.push_back(SEPARATOR);
+	out.append(CURRENT_VERSION);
+	out.push_back(SEPARATOR);
+	out.append(SECTION_LABEL_NODE);
+	out.push_back(SEPARATOR);
 }
 
-std::string CyclesShaderEditor::serialize_graph(std::vector<OutputNode> &nodes, std::vector<OutputConnection> &connections)
+std::string CyclesShaderEditor::serialize_graph(std::vector<OutputNode> &nodes, std::vector<OutputConnection> &connections, SerializedGraphFormat format)
 {
-	initialize_maps();
+	std::string output;
+	serialize_graph(nodes, connections, output, format);
+	return output;
+}
 
-	std::stringstream output_stream;
+void CyclesShaderEditor::serialize_graph(const std::vector<OutputNode>& nodes, const std::vector<OutputConnection>& connections, std::string& out, SerializedGraphFormat format)
+{
+	if (format == SerializedGraphFormat::Binary) {
+		serialize_graph_binary(nodes, connections, out);
+		return;
+	}
 
-	// Write first entry
-	output_stream << MAGIC_WORD << SEPARATOR << CURRENT_VERSION << SEPARATOR;
+	append_text_header(out);
 
-	// Fill in node information
-	output_stream << SECTION_LABEL_NODE << SEPARATOR;
-	for (OutputNode node : nodes) {
-		output_stream << serialize_node(node);
+	for (const OutputNode& node : nodes) {
+		serialize_node(node, out);
 	}
 
 	// Fill in connection information
-	output_stream << SECTION_LABEL_CONNECTION << SEPARATOR;
-	for (OutputConnection connection : connections) {
-		output_stream << serialize_connection(connection);
+	out.append(SECTION_LABEL_CONNECTION);
+	out.push_back(SEPARATOR);
+	for (const OutputConnection& connection : connections) {
+		serialize_connection(connection, out);
 	}
+}
 
-	return output_stream.str();
+std::string CyclesShaderEditor::SerializedGraphCache::serialize(const std::list<EditorNode*>& nodes, const std::list<NodeConnection>& connections)
+{
+	std::string output;
+	serialize(nodes, connections, output);
+	return output;
 }
 
-static CyclesShaderEditor::EditorNode* create_node_from_type(CyclesShaderEditor::CyclesNodeType type, CyclesShaderEditor::Point2 pos) {
-	using namespace CyclesShaderEditor;
-	switch (type) {
-		case CyclesNodeType::AmbientOcclusion:
-		{
-			return new AmbientOcculsionNode(pos);
-		}
-		case CyclesNodeType::PrincipledBSDF:
-		{
-			return new PrincipledBSDFNode(pos);
-		}
-		case CyclesNodeType::MixShader:
-		{
-			return new MixShaderNode(pos);
-		}
-		case CyclesNodeType::AddShader:
-		{
-			return new AddShaderNode(pos);
-		}
-		case CyclesNodeType::DiffuseBSDF:
-		{
-			return new DiffuseBSDFNode(pos);
+void CyclesShaderEditor::SerializedGraphCache::serialize(const std::list<EditorNode*>& nodes, const std::list<NodeConnection>& connections, std::string& out)
+{
+	serialize_count++;
+	last_encoded_node_count = 0;
+
+	// Canonical order as generate_output_lists works it out, with list position last so identical nodes keep their list order
+	const auto same_place = [](const CachedNode* a, const CachedNode* b) {
+		return a->type == b->type && a->world_x == b->world_x && a->world_y == b->world_y && a->content_hash == b->content_hash && a->body == b->body;
+	};
+	const auto canonical_less = [](const CachedNode* a, const CachedNode* b) {
+		if (canonical_node_less(a->type, a->world_x, a->world_y, b->type, b->world_x, b->world_y)) {
+			return true;
+		}
+		if (canonical_node_less(b->type, b->world_x, b->world_y, a->type, a->world_x, a->world_y)) {
+			return false;
+		}
+		if (a->body != b->body) {
+			return a->body < b->body;
+		}
+		return a->list_index < b->list_index;
+	};
+
+	// A node that was there when changes were last taken is kept as it was then, one added since is simply dropped
+	const auto record_removed_node = [this](CachedNode& cached) {
+		if (cached.added_since_taken) {
+			cached.added_since_taken = false;
+			return;
 		}
-		case CyclesNodeType::GlossyBSDF:
-		{
-			return new GlossyBSDFNode(pos);
+		RemovedNode removed;
+		removed.id = cached.id;
+		if (cached.changed_since_taken) {
+			const std::unordered_map<unsigned long long, OutputNode>::iterator before_iter = nodes_before.find(cached.id);
+			removed.output = std::move(before_iter->second);
+			nodes_before.erase(before_iter);
+			cached.changed_since_taken = false;
+		}
+		else {
+			removed.output = std::move(cached.output);
+		}
+		removed_nodes.push_back(std::move(removed));
+	};
+
+	// Nodes that are new or whose place in the order may have changed are encoded again and collected in placed_nodes
+	placed_nodes.clear();
+	bool nodes_added = false;
+	bool node_type_changed = false;
+	bool list_reordered = false;
+	size_t list_index = 0;
+	for (std::list<EditorNode*>::const_iterator list_iter = nodes.begin(); list_iter != nodes.end(); ++list_iter) {
+		EditorNode* const node = *list_iter;
+		// Looked up before inserting, emplace would allocate an entry even for a node that is already cached
+		std::unordered_map<const EditorNode*, CachedNode>::iterator cached_iter = cached_nodes.find(node);
+		const bool is_new = cached_iter == cached_nodes.end();
+		if (is_new) {
+			cached_iter = cached_nodes.emplace(node, CachedNode()).first;
+		}
+		CachedNode& cached = cached_iter->second;
+		if (is_new) {
+			cached.node = node;
+			cached.input_text_dirty = true;
+			nodes_added = true;
+		}
+		else if (cached.seen == serialize_count) {
+			// A node that is in the list twice is only written once
+			continue;
 		}
-		case CyclesNodeType::TransparentBSDF:
-		{
-			return new TransparentBSDFNode(pos);
+		if (cached.list_index != list_index) {
+			list_reordered = true;
 		}
-		case CyclesNodeType::RefractionBSDF:
-		{
-			return new RefractionBSDFNode(pos);
+		cached.list_index = list_index++;
+		cached.list_position = list_iter;
+		cached.seen = serialize_count;
+
+		const float world_x = node->world_pos.get_floor_pos_x();
+		const float world_y = node->world_pos.get_floor_pos_y();
+		if (is_new == false && node->output_changed == false && cached.world_x == world_x && cached.world_y == world_y) {
+			continue;
 		}
-		case CyclesNodeType::GlassBSDF:
-		{
-			return new GlassBSDFNode(pos);
+
+		OutputNode output;
+		node->update_output_node(output);
+		encoded_body.clear();
+		serialize_node_body(output, encoded_body);
+		const unsigned long long content_hash = hash_node_content(output);
+		node->output_changed = false;
+		last_encoded_node_count++;
+		if (is_new == false && output.type == cached.type && content_hash == cached.content_hash && encoded_body == cached.body) {
+			continue;
 		}
-		case CyclesNodeType::TranslucentBSDF:
-		{
-			return new TranslucentBSDFNode(pos);
+
+		if (is_new || output.type != cached.type) {
+			if (is_new == false) {
+				node_type_changed = true;
+				record_removed_node(cached);
+			}
+			cached.id = ++next_node_id;
+			cached.added_since_taken = true;
+			changed_nodes.push_back(node);
+		}
+		else if (cached.added_since_taken == false && cached.changed_since_taken == false) {
+			nodes_before[cached.id] = std::move(cached.output);
+			cached.changed_since_taken = true;
+			changed_nodes.push_back(node);
+		}
+		if (is_new || content_hash != cached.content_hash) {
+			cached.structure_hash_dirty = true;
+		}
+		cached.type = output.type;
+		cached.world_x = output.world_x;
+		cached.world_y = output.world_y;
+		cached.body.swap(encoded_body);
+		cached.content_hash = content_hash;
+		cached.output = std::move(output);
+		flatten_patch_node(cached.output);
+		cached.node_text_dirty = true;
+		cached.needs_place = true;
+		placed_nodes.push_back(&cached);
+	}
+	const bool nodes_removed = cached_nodes.size() > list_index;
+
+	// Nodes that left the list or need a new place are taken out of the order, the others keep their places relative to each other
+	bool order_changed = false;
+	if (nodes_removed || placed_nodes.empty() == false) {
+		order_changed = true;
+		size_t kept_nodes = 0;
+		for (CachedNode* const cached : node_order) {
+			if (cached->seen == serialize_count && cached->needs_place == false) {
+				node_order[kept_nodes++] = cached;
+			}
 		}
-		case CyclesNodeType::AnisotropicBSDF:
-		{
-			return new AnisotropicBSDFNode(pos);
+		node_order.resize(kept_nodes);
+	}
+	if (nodes_removed) {
+		for (std::unordered_map<const EditorNode*, CachedNode>::iterator iter = cached_nodes.begin(); iter != cached_nodes.end(); ) {
+			if (iter->second.seen != serialize_count) {
+				record_removed_node(iter->second);
+				iter = cached_nodes.erase(iter);
+			}
+			else {
+				++iter;
+			}
 		}
-		case CyclesNodeType::VelvetBSDF:
-		{
-			return new VelvetBSDFNode(pos);
+	}
+	if (placed_nodes.empty() == false) {
+		std::sort(placed_nodes.begin(), placed_nodes.end(), canonical_less);
+		merged_order.clear();
+		merged_order.reserve(node_order.size() + placed_nodes.size());
+		std::merge(node_order.begin(), node_order.end(), placed_nodes.begin(), placed_nodes.end(), std::back_inserter(merged_order), canonical_less);
+		node_order.swap(merged_order);
+		for (CachedNode* const cached : placed_nodes) {
+			cached->needs_place = false;
 		}
-		case CyclesNodeType::ToonBSDF:
-		{
-			return new ToonBSDFNode(pos);
+	}
+	// Nodes that are the same in every way follow the list, which can be reordered without any node changing
+	if (list_reordered) {
+		for (size_t run_begin = 0; run_begin < node_order.size(); ) {
+			size_t run_end = run_begin + 1;
+			while (run_end < node_order.size() && same_place(node_order[run_begin], node_order[run_end])) {
+				run_end++;
+			}
+			if (run_end - run_begin > 1 && std::is_sorted(node_order.begin() + run_begin, node_order.begin() + run_end, canonical_less) == false) {
+				std::sort(node_order.begin() + run_begin, node_order.begin() + run_end, canonical_less);
+				order_changed = true;
+			}
+			run_begin = run_end;
 		}
-		case CyclesNodeType::SubsurfaceScattering:
-		{
-			return new SubsurfaceScatteringNode(pos);
+	}
+
+	// A node whose place changed has a new name, which is written in its own entry and in the connections of its inputs and outputs
+	renamed_nodes.clear();
+	if (order_changed) {
+		output_node = nullptr;
+		for (size_t i = 0; i < node_order.size(); i++) {
+			CachedNode* const cached = node_order[i];
+			if (cached->rank != i) {
+				if (cached->added_since_taken == false) {
+					names_changed_since_taken = true;
+				}
+				cached->rank = i;
+				cached->node_text_dirty = true;
+				cached->input_text_dirty = true;
+				renamed_nodes.push_back(cached);
+			}
+			if (cached->type == CyclesNodeType::MaterialOutput && output_node == nullptr) {
+				output_node = cached;
+			}
 		}
-		case CyclesNodeType::Emission:
-		{
-			return new EmissionNode(pos);
+	}
+
+	// Connections are only looked at again if the list has changed, or a node they might lead to has come or gone
+	const auto input_less = [](const CachedInput& a, const CachedInput& b) {
+		if (a.dest_socket->display_name != b.dest_socket->display_name) {
+			return a.dest_socket->display_name < b.dest_socket->display_name;
+		}
+		if (a.source->rank != b.source->rank) {
+			return a.source->rank < b.source->rank;
+		}
+		return a.source_socket->display_name < b.source_socket->display_name;
+	};
+	bool connections_changed = nodes_added || nodes_removed || node_type_changed || cached_connections.size() != connections.size();
+	if (connections_changed == false) {
+		// Positions are taken again even if nothing changed, a connection can be replaced by one between the same sockets
+		std::vector<CachedConnection>::iterator cached_iter = cached_connections.begin();
+		for (std::list<NodeConnection>::const_iterator list_iter = connections.begin(); list_iter != connections.end(); ++list_iter) {
+			if (cached_iter->source_socket != list_iter->begin_socket || cached_iter->dest_socket != list_iter->end_socket) {
+				connections_changed = true;
+				break;
+			}
+			cached_iter->position = list_iter;
+			++cached_iter;
 		}
-		case CyclesNodeType::HairBSDF:
-		{
-			return new HairBSDFNode(pos);
+	}
+	if (connections_changed) {
+		if (connections_changed_since_taken == false) {
+			connections_before.swap(cached_connections);
+			connections_changed_since_taken = true;
+		}
+		cached_connections.clear();
+		cached_connections.reserve(connections.size());
+		for (CachedNode* const cached : node_order) {
+			cached->previous_inputs.swap(cached->inputs);
+			cached->inputs.clear();
+			cached->dependents.clear();
+		}
+		for (std::list<NodeConnection>::const_iterator list_iter = connections.begin(); list_iter != connections.end(); ++list_iter) {
+			const std::unordered_map<const EditorNode*, CachedNode>::iterator source_iter = cached_nodes.find(list_iter->begin_socket->parent);
+			const std::unordered_map<const EditorNode*, CachedNode>::iterator dest_iter = cached_nodes.find(list_iter->end_socket->parent);
+			const bool in_graph = source_iter != cached_nodes.end() && dest_iter != cached_nodes.end();
+			CachedConnection cached_connection;
+			cached_connection.source_socket = list_iter->begin_socket;
+			cached_connection.dest_socket = list_iter->end_socket;
+			cached_connection.position = list_iter;
+			cached_connection.source_node = list_iter->begin_socket->parent;
+			cached_connection.dest_node = list_iter->end_socket->parent;
+			cached_connection.source_id = in_graph ? source_iter->second.id : 0;
+			cached_connection.dest_id = in_graph ? dest_iter->second.id : 0;
+			cached_connection.source_socket_name = list_iter->begin_socket->display_name;
+			cached_connection.dest_socket_name = list_iter->end_socket->display_name;
+			cached_connections.push_back(std::move(cached_connection));
+			if (in_graph == false) {
+				continue;
+			}
+
+			CachedInput input;
+			input.source = &source_iter->second;
+			input.source_socket = list_iter->begin_socket;
+			input.dest_socket = list_iter->end_socket;
+			input.connection = cached_connections.size() - 1;
+			dest_iter->second.inputs.push_back(input);
+			source_iter->second.dependents.push_back(&dest_iter->second);
+		}
+		// Only pointers are compared, the sockets of a deleted node can not be read
+		for (CachedNode* const cached : node_order) {
+			std::sort(cached->inputs.begin(), cached->inputs.end(), input_less);
+			const bool same_inputs = cached->inputs.size() == cached->previous_inputs.size() &&
+				std::equal(cached->inputs.begin(), cached->inputs.end(), cached->previous_inputs.begin(), [](const CachedInput& a, const CachedInput& b) {
+					return a.source == b.source && a.source_socket == b.source_socket && a.dest_socket == b.dest_socket;
+				});
+			if (same_inputs == false || node_type_changed) {
+				cached->input_text_dirty = true;
+				cached->structure_hash_dirty = true;
+			}
 		}
-		case CyclesNodeType::Holdout:
-		{
-			return new HoldoutNode(pos);
+	}
+	for (const CachedNode* const cached : renamed_nodes) {
+		for (CachedNode* const dependent : cached->dependents) {
+			dependent->input_text_dirty = true;
 		}
-		case CyclesNodeType::VolAbsorption:
-		{
-			return new VolumeAbsorptionNode(pos);
+	}
+
+	const bool graph_changed = order_changed || connections_changed;
+	if (graph_changed) {
+		update_graph_hash();
+	}
+
+	// The text is put together from the last one, entries that have not changed are copied over a run at a time
+	if (graph_changed || renamed_nodes.empty() == false) {
+		next_text.clear();
+		next_text.reserve(text.size() + placed_nodes.size() * 64);
+		append_text_header(next_text);
+
+		size_t run_begin = 0;
+		size_t run_end = 0;
+		const auto copy_entry = [&](size_t& offset, size_t length) {
+			if (offset != run_end) {
+				next_text.append(text, run_begin, run_end - run_begin);
+				run_begin = offset;
+				run_end = offset;
+			}
+			run_end += length;
+			offset = next_text.size() + (offset - run_begin);
+		};
+		const auto end_run = [&]() {
+			next_text.append(text, run_begin, run_end - run_begin);
+			run_begin = 0;
+			run_end = 0;
+		};
+		const auto append_node_name = [&](const CachedNode* cached) {
+			if (cached->type == CyclesNodeType::MaterialOutput) {
+				append_token(next_text, "output");
+			}
+			else {
+				next_text.append("node");
+				append_int(next_text, static_cast<int>(cached->rank));
+				next_text.push_back(SEPARATOR);
+			}
+		};
+
+		for (CachedNode* const cached : node_order) {
+			if (cached->node_text_dirty == false) {
+				copy_entry(cached->node_text_offset, cached->node_text_length);
+				continue;
+			}
+			end_run();
+			cached->node_text_offset = next_text.size();
+			const NodeTypeInfo* const type_info = get_node_type_info(cached->type);
+			if (type_info != nullptr) {
+				append_token(next_text, type_info->code);
+				append_node_name(cached);
+				next_text.append(cached->body);
+			}
+			cached->node_text_length = next_text.size() - cached->node_text_offset;
+			cached->node_text_dirty = false;
 		}
-		case CyclesNodeType::VolScatter:
-		{
-			return new VolumeScatterNode(pos);
+		end_run();
+
+		next_text.append(SECTION_LABEL_CONNECTION);
+		next_text.push_back(SEPARATOR);
+		for (CachedNode* const cached : node_order) {
+			if (cached->input_text_dirty == false) {
+				copy_entry(cached->input_text_offset, cached->input_text_length);
+				continue;
+			}
+			end_run();
+			// Sources that were renamed can also have moved relative to each other
+			std::sort(cached->inputs.begin(), cached->inputs.end(), input_less);
+			cached->input_text_offset = next_text.size();
+			for (const CachedInput& input : cached->inputs) {
+				append_node_name(input.source);
+				append_token(next_text, input.source_socket->display_name);
+				append_node_name(cached);
+				append_token(next_text, input.dest_socket->display_name);
+			}
+			cached->input_text_length = next_text.size() - cached->input_text_offset;
+			cached->input_text_dirty = false;
 		}
-		case CyclesNodeType::BrickTex:
-		{
-			return new BrickTextureNode(pos);
+		end_run();
+
+		text.swap(next_text);
+	}
+
+	// Recording starts from the first graph
+	if (changes_started == false) {
+		discard_changes();
+		changes_started = true;
+	}
+
+	out.assign(text);
+}
+
+void CyclesShaderEditor::SerializedGraphCache::update_graph_hash()
+{
+	// Changed nodes and everything downstream of them are hashed again, a node only once all of its sources are done
+	// While the graph has a loop every node is hashed, that is also how a loop that has gone away is noticed
+	hashed_nodes.clear();
+	for (CachedNode* const cached : node_order) {
+		if (graph_has_loop) {
+			cached->structure_hash_dirty = true;
 		}
-		case CyclesNodeType::NoiseTex:
-		{
-			return new NoiseTextureNode(pos);
+		if (cached->structure_hash_dirty) {
+			hashed_nodes.push_back(cached);
 		}
-		case CyclesNodeType::WaveTex:
-		{
-			return new WaveTextureNode(pos);
+	}
+	if (graph_has_loop == false) {
+		for (size_t i = 0; i < hashed_nodes.size(); i++) {
+			for (CachedNode* const dependent : hashed_nodes[i]->dependents) {
+				if (dependent->structure_hash_dirty == false) {
+					dependent->structure_hash_dirty = true;
+					hashed_nodes.push_back(dependent);
+				}
+			}
 		}
-		case CyclesNodeType::VoronoiTex:
-		{
-			return new VoronoiTextureNode(pos);
+	}
+
+	ready_nodes.clear();
+	for (CachedNode* const cached : hashed_nodes) {
+		cached->pending_inputs = 0;
+		for (const CachedInput& input : cached->inputs) {
+			if (input.source->structure_hash_dirty) {
+				cached->pending_inputs++;
+			}
 		}
-		case CyclesNodeType::MusgraveTex:
-		{
-			return new MusgraveTextureNode(pos);
+		if (cached->pending_inputs == 0) {
+			ready_nodes.push_back(cached);
 		}
-		case CyclesNodeType::GradientTex:
-		{
-			return new GradientTextureNode(pos);
+	}
+	size_t hashed_count = 0;
+	while (ready_nodes.empty() == false) {
+		CachedNode* const cached = ready_nodes.back();
+		ready_nodes.pop_back();
+
+		hash_scratch.inputs.clear();
+		for (const CachedInput& input : cached->inputs) {
+			GraphHashScratch::Input hash_input;
+			hash_input.dest_socket = &input.dest_socket->display_name;
+			hash_input.source_socket = &input.source_socket->display_name;
+			hash_input.source_hash = input.source->structure_hash;
+			hash_scratch.inputs.push_back(hash_input);
+		}
+		cached->structure_hash = hash_graph_node(cached->content_hash, hash_scratch.inputs);
+		cached->structure_hash_dirty = false;
+		hashed_count++;
+		for (CachedNode* const dependent : cached->dependents) {
+			if (dependent->structure_hash_dirty && --dependent->pending_inputs == 0) {
+				ready_nodes.push_back(dependent);
+			}
 		}
-		case CyclesNodeType::MagicTex:
-		{
-			return new MagicTextureNode(pos);
+	}
+
+	graph_has_loop = hashed_count < hashed_nodes.size();
+	if (graph_has_loop == false) {
+		last_graph_hash = (output_node != nullptr) ? output_node->structure_hash : 0;
+		return;
+	}
+
+	// Nodes on a loop have no hash of their own, hash_graph_structure walks the graph from the output instead
+	for (CachedNode* const cached : hashed_nodes) {
+		cached->structure_hash_dirty = false;
+	}
+	content_hashes.clear();
+	content_hashes.reserve(node_order.size());
+	hash_edges.clear();
+	for (const CachedNode* const cached : node_order) {
+		content_hashes.push_back(cached->content_hash);
+		for (const CachedInput& input : cached->inputs) {
+			GraphHashEdge edge;
+			edge.source_node = input.source->rank;
+			edge.source_socket = &input.source_socket->display_name;
+			edge.dest_node = cached->rank;
+			edge.dest_socket = &input.dest_socket->display_name;
+			hash_edges.push_back(edge);
 		}
-		case CyclesNodeType::CheckerTex:
-		{
-			return new CheckerTextureNode(pos);
+	}
+	last_graph_hash = hash_graph_structure(content_hashes, (output_node != nullptr) ? output_node->rank : node_order.size(), hash_edges, hash_scratch);
+}
+
+void CyclesShaderEditor::SerializedGraphCache::clear()
+{
+	cached_nodes.clear();
+	node_order.clear();
+	output_node = nullptr;
+	cached_connections.clear();
+	text.clear();
+	graph_has_loop = false;
+	last_encoded_node_count = 0;
+	last_graph_hash = 0;
+	discard_changes();
+	changes_started = false;
+}
+
+size_t CyclesShaderEditor::SerializedGraphCache::get_last_encoded_node_count() const
+{
+	return last_encoded_node_count;
+}
+
+unsigned long long CyclesShaderEditor::SerializedGraphCache::get_last_graph_hash() const
+{
+	return last_graph_hash;
+}
+
+CyclesShaderEditor::EditorNode* CyclesShaderEditor::SerializedGraphCache::find_node(const StringSlice name) const
+{
+	if (name == "output") {
+		return (output_node != nullptr) ? output_node->node : nullptr;
+	}
+
+	const size_t prefix_length = strlen("node");
+	if (name.size() <= prefix_length || memcmp(name.data(), "node", prefix_length) != 0) {
+		return nullptr;
+	}
+	int index = 0;
+	if (!read_int(StringSlice(name.data() + prefix_length, name.size() - prefix_length), index) || index < 0 || static_cast<size_t>(index) >= node_order.size()) {
+		return nullptr;
+	}
+	const CachedNode* const cached = node_order[index];
+	if (cached->type == CyclesNodeType::MaterialOutput) {
+		return nullptr;
+	}
+	return cached->node;
+}
+
+std::string CyclesShaderEditor::SerializedGraphCache::get_node_name(const EditorNode* const node) const
+{
+	const std::unordered_map<const EditorNode*, CachedNode>::const_iterator iter = cached_nodes.find(node);
+	if (iter == cached_nodes.end()) {
+		return std::string();
+	}
+	if (iter->second.type == CyclesNodeType::MaterialOutput) {
+		return std::string("output");
+	}
+	return std::string("node") + std::to_string(iter->second.rank);
+}
+
+bool CyclesShaderEditor::SerializedGraphCache::find_list_position(const EditorNode* const node, std::list<EditorNode*>::const_iterator& position) const
+{
+	const std::unordered_map<const EditorNode*, CachedNode>::const_iterator iter = cached_nodes.find(node);
+	if (iter == cached_nodes.end()) {
+		return false;
+	}
+	position = iter->second.list_position;
+	return true;
+}
+
+void CyclesShaderEditor::SerializedGraphCache::find_connections(const NodeSocket* const source, const NodeSocket* const dest, std::vector<std::list<NodeConnection>::const_iterator>& positions) const
+{
+	const std::unordered_map<const EditorNode*, CachedNode>::const_iterator iter = cached_nodes.find(dest->parent);
+	if (iter == cached_nodes.end()) {
+		return;
+	}
+	for (const CachedInput& input : iter->second.inputs) {
+		if (input.source_socket == source && input.dest_socket == dest) {
+			positions.push_back(cached_connections[input.connection].position);
 		}
-		case CyclesNodeType::MaxTex:
-		{
-			return new MaxTexmapShaderNode(pos);
+	}
+}
+
+void CyclesShaderEditor::SerializedGraphCache::find_connections(const EditorNode* const node, std::vector<std::list<NodeConnection>::const_iterator>& positions) const
+{
+	const std::unordered_map<const EditorNode*, CachedNode>::const_iterator iter = cached_nodes.find(node);
+	if (iter == cached_nodes.end()) {
+		return;
+	}
+	const CachedNode& cached = iter->second;
+	for (const CachedInput& input : cached.inputs) {
+		positions.push_back(cached_connections[input.connection].position);
+	}
+	// Connections from the node are found among the inputs of the nodes they lead to
+	for (const CachedNode* const dependent : cached.dependents) {
+		for (const CachedInput& input : dependent->inputs) {
+			if (input.source == &cached) {
+				positions.push_back(cached_connections[input.connection].position);
+			}
 		}
-		case CyclesNodeType::LightPath:
-		{
-			return new LightPathNode(pos);
+	}
+}
+
+void CyclesShaderEditor::SerializedGraphCache::take_changes(GraphPatch& step_back, bool& names_kept)
+{
+	step_back = GraphPatch();
+	names_kept = (names_changed_since_taken == false);
+
+	const auto get_cached_name = [](const CachedNode& cached) {
+		if (cached.type == CyclesNodeType::MaterialOutput) {
+			return std::string("output");
+		}
+		return std::string("node") + std::to_string(cached.rank);
+	};
+
+	// Deleted nodes are brought back under names the editor never gives a node, so they can not be mistaken for one that is still there
+	std::unordered_map<unsigned long long, std::string> restored_names;
+	for (size_t i = 0; i < removed_nodes.size(); i++) {
+		OutputNode& node = removed_nodes[i].output;
+		node.name = std::string("restored") + std::to_string(i);
+		restored_names[removed_nodes[i].id] = node.name;
+		step_back.added_nodes.push_back(std::move(node));
+	}
+
+	for (const EditorNode* const node : changed_nodes) {
+		const std::unordered_map<const EditorNode*, CachedNode>::iterator iter = cached_nodes.find(node);
+		if (iter == cached_nodes.end()) {
+			continue;
 		}
-		case CyclesNodeType::Fresnel:
-		{
-			return new FresnelNode(pos);
+		CachedNode& cached = iter->second;
+		if (cached.added_since_taken) {
+			step_back.removed_nodes.push_back(cached.output);
+			step_back.removed_nodes.back().name = get_cached_name(cached);
 		}
-		case CyclesNodeType::LayerWeight:
-		{
-			return new LayerWeightNode(pos);
+		else if (cached.changed_since_taken) {
+			GraphPatchNodeChange change;
+			if (diff_graph_node(cached.output, nodes_before[cached.id], change)) {
+				change.name = get_cached_name(cached);
+				step_back.changed_nodes.push_back(std::move(change));
+			}
 		}
-		case CyclesNodeType::CameraData:
-		{
-			return new CameraDataNode(pos);
-		}
-		case CyclesNodeType::Tangent:
-		{
-			return new TangentNode(pos);
-		}
-		case CyclesNodeType::TextureCoordinate:
-		{
-			return new TextureCoordinateNode(pos);
-		}
-		case CyclesNodeType::Geometry:
-		{
-			return new GeometryNode(pos);
-		}
-		case CyclesNodeType::ObjectInfo:
-		{
-			return new ObjectInfoNode(pos);
-		}
-		case CyclesNodeType::RGB:
-		{
-			return new RGBNode(pos);
-		}
-		case CyclesNodeType::Wireframe:
-		{
-			return new WireframeNode(pos);
-		}
-		case CyclesNodeType::Value:
-		{
-			return new ValueNode(pos);
-		}
-		case CyclesNodeType::MixRGB:
-		{
-			return new MixRGBNode(pos);
-		}
-		case CyclesNodeType::Invert:
-		{
-			return new InvertNode(pos);
+		// A node can be in the list more than once, it is only looked at the first time
+		cached.added_since_taken = false;
+		cached.changed_since_taken = false;
+	}
+
+	// Connections are matched by the ids of their nodes and the names of their sockets, both lists are sorted so they can
+	// be walked together
+	if (connections_changed_since_taken) {
+		const auto connection_less = [](const CachedConnection* a, const CachedConnection* b) {
+			if (a->source_id != b->source_id) {
+				return a->source_id < b->source_id;
+			}
+			if (a->dest_id != b->dest_id) {
+				return a->dest_id < b->dest_id;
+			}
+			if (a->source_socket_name != b->source_socket_name) {
+				return a->source_socket_name < b->source_socket_name;
+			}
+			return a->dest_socket_name < b->dest_socket_name;
+		};
+		const auto get_sorted = [&](const std::vector<CachedConnection>& source, std::vector<const CachedConnection*>& sorted) {
+			for (const CachedConnection& connection : source) {
+				if (connection.source_id != 0 && connection.dest_id != 0) {
+					sorted.push_back(&connection);
+				}
+			}
+			std::sort(sorted.begin(), sorted.end(), connection_less);
+		};
+		const auto get_output_connection = [&](const CachedConnection& connection) {
+			const auto get_name = [&](const EditorNode* node, unsigned long long id) {
+				const std::unordered_map<unsigned long long, std::string>::const_iterator restored_iter = restored_names.find(id);
+				if (restored_iter != restored_names.end()) {
+					return restored_iter->second;
+				}
+				return get_cached_name(cached_nodes.find(node)->second);
+			};
+			OutputConnection result;
+			result.source_node = get_name(connection.source_node, connection.source_id);
+			result.source_socket = connection.source_socket_name;
+			result.dest_node = get_name(connection.dest_node, connection.dest_id);
+			result.dest_socket = connection.dest_socket_name;
+			return result;
+		};
+
+		std::vector<const CachedConnection*> before;
+		std::vector<const CachedConnection*> after;
+		get_sorted(connections_before, before);
+		get_sorted(cached_connections, after);
+		size_t before_index = 0;
+		size_t after_index = 0;
+		while (before_index < before.size() || after_index < after.size()) {
+			if (after_index == after.size() || (before_index < before.size() && connection_less(before[before_index], after[after_index]))) {
+				step_back.added_connections.push_back(get_output_connection(*before[before_index++]));
+			}
+			else if (before_index == before.size() || connection_less(after[after_index], before[before_index])) {
+				step_back.removed_connections.push_back(get_output_connection(*after[after_index++]));
+			}
+			else {
+				before_index++;
+				after_index++;
+			}
 		}
-		case CyclesNodeType::LightFalloff:
-		{
-			return new LightFalloffNode(pos);
+	}
+
+	discard_changes();
+}
+
+void CyclesShaderEditor::SerializedGraphCache::discard_changes()
+{
+	for (const EditorNode* const node : changed_nodes) {
+		const std::unordered_map<const EditorNode*, CachedNode>::iterator iter = cached_nodes.find(node);
+		if (iter != cached_nodes.end()) {
+			iter->second.added_since_taken = false;
+			iter->second.changed_since_taken = false;
 		}
-		case CyclesNodeType::HSV:
-		{
-			return new HSVNode(pos);
+	}
+	changed_nodes.clear();
+	nodes_before.clear();
+	removed_nodes.clear();
+	names_changed_since_taken = false;
+	connections_changed_since_taken = false;
+	connections_before.clear();
+}
+
+// Type of a param value, also used as the param tag in binary graphs so existing values must not change
+enum class ParamKind : unsigned char {
+	Float = 0,
+	Float3 = 1,
+	String = 2,
+	Int = 3,
+	Bool = 4,
+	Curve = 5,
+};
+
+// Little-endian writer for binary graphs
+// Strings are interned, each distinct string is stored once in a table that precedes the nodes
+class BinaryWriter {
+public:
+	void write_u8(unsigned char value)
+	{
+		body.push_back(static_cast<char>(value));
+	}
+
+	// Unsigned LEB128
+	void write_varint(unsigned int value)
+	{
+		write_varint(body, value);
+	}
+
+	void write_f32(float value)
+	{
+		unsigned int bits = 0;
+		static_assert(sizeof(bits) == sizeof(value), "float must be 32 bits");
+		memcpy(&bits, &value, sizeof(value));
+		for (int i = 0; i < 4; i++) {
+			write_u8(static_cast<unsigned char>(bits >> (8 * i)));
 		}
-		case CyclesNodeType::Gamma:
-		{
-			return new GammaNode(pos);
+	}
+
+	void write_string(const std::string& value)
+	{
+		std::map<std::string, unsigned int>::const_iterator string_iter = string_ids.find(value);
+		if (string_iter != string_ids.end()) {
+			write_varint(string_iter->second);
+			return;
 		}
-		case CyclesNodeType::BrightnessContrast:
-		{
-			return new BrightnessContrastNode(pos);
+		const unsigned int new_id = static_cast<unsigned int>(strings.size());
+		string_ids[value] = new_id;
+		strings.push_back(&string_ids.find(value)->first);
+		write_varint(new_id);
+	}
+
+	// Appends the finished graph to out
+	void finish(std::string& out) const
+	{
+		out.append(BINARY_HEADER);
+		write_varint(out, static_cast<unsigned int>(strings.size()));
+		for (const std::string* this_string : strings) {
+			write_varint(out, static_cast<unsigned int>(this_string->size()));
+			out.append(*this_string);
 		}
-		case CyclesNodeType::RGBCurves:
-		{
-			return new RGBCurvesNode(pos);
+		out.append(body);
+	}
+
+private:
+	static void write_varint(std::string& out, unsigned int value)
+	{
+		while (value >= 0x80) {
+			out.push_back(static_cast<char>((value & 0x7f) | 0x80));
+			value >>= 7;
 		}
-		case CyclesNodeType::Bump:
-		{
-			return new BumpNode(pos);
+		out.push_back(static_cast<char>(value));
+	}
+
+	std::string body;
+	std::map<std::string, unsigned int> string_ids;
+	std::vector<const std::string*> strings;
+};
+
+// Layout, all counts and string ids are varints:
+// header, string count, strings (length, bytes)...,
+// node count, nodes (type, name, x, y, param count, params (name, kind, value)...)...,
+// connection count, connections (source node, source socket, dest node, dest socket)...
+// Writes each param of a node as its name, kind tag and value, see visit_output_params
+class BinaryParamWriter {
+public:
+	BinaryParamWriter(BinaryWriter& writer) : writer(writer) {}
+
+	void visit_float(const std::string& name, float value)
+	{
+		writer.write_string(name);
+		writer.write_u8(static_cast<unsigned char>(ParamKind::Float));
+		writer.write_f32(value);
+	}
+
+	void visit_float3(const std::string& name, const CyclesShaderEditor::Float3& value)
+	{
+		writer.write_string(name);
+		writer.write_u8(static_cast<unsigned char>(ParamKind::Float3));
+		writer.write_f32(value.x);
+		writer.write_f32(value.y);
+		writer.write_f32(value.z);
+	}
+
+	void visit_string(const std::string& name, const std::string& value)
+	{
+		writer.write_string(name);
+		writer.write_u8(static_cast<unsigned char>(ParamKind::String));
+		writer.write_string(value);
+	}
+
+	void visit_int(const std::string& name, int value)
+	{
+		writer.write_string(name);
+		writer.write_u8(static_cast<unsigned char>(ParamKind::Int));
+		// Zigzag encoded so small negative values stay small
+		const unsigned int bits = static_cast<unsigned int>(value);
+		writer.write_varint((bits << 1) ^ (value < 0 ? 0xffffffffu : 0u));
+	}
+
+	void visit_bool(const std::string& name, bool value)
+	{
+		writer.write_string(name);
+		writer.write_u8(static_cast<unsigned char>(ParamKind::Bool));
+		writer.write_u8(value ? 1 : 0);
+	}
+
+	void visit_curve(const std::string& name, const CyclesShaderEditor::OutputCurve& value)
+	{
+		using namespace CyclesShaderEditor;
+
+		writer.write_string(name);
+		writer.write_u8(static_cast<unsigned char>(ParamKind::Curve));
+		const bool cubic = (value.enum_curve_interp == static_cast<int>(CurveInterpolation::CUBIC_HERMITE));
+		writer.write_u8(cubic ? 1 : 0);
+		writer.write_varint(static_cast<unsigned int>(value.control_points.size()));
+		for (const Float2& this_point : value.control_points) {
+			writer.write_f32(this_point.x);
+			writer.write_f32(this_point.y);
 		}
-		case CyclesNodeType::NormalMap:
-		{
-			return new NormalMapNode(pos);
+	}
+
+private:
+	BinaryWriter& writer;
+};
+
+std::string CyclesShaderEditor::serialize_graph_binary(std::vector<OutputNode>& nodes, std::vector<OutputConnection>& connections)
+{
+	std::string output;
+	serialize_graph_binary(nodes, connections, output);
+	return output;
+}
+
+void CyclesShaderEditor::serialize_graph_binary(const std::vector<OutputNode>& nodes, const std::vector<OutputConnection>& connections, std::string& out)
+{
+	BinaryWriter writer;
+
+	unsigned int node_count = 0;
+	for (const OutputNode& node : nodes) {
+		if (get_node_type_info(node.type) != nullptr) {
+			node_count++;
 		}
-		case CyclesNodeType::VectorTransform:
-		{
-			return new VectorTransformNode(pos);
+	}
+
+	writer.write_varint(node_count);
+	for (const OutputNode& node : nodes) {
+		const NodeTypeInfo* const type_info = get_node_type_info(node.type);
+		if (type_info == nullptr) {
+			continue;
 		}
-		case CyclesNodeType::Blackbody:
+
+		writer.write_string(type_info->code);
+		writer.write_string(node.name);
+		writer.write_f32(node.world_x);
+		writer.write_f32(node.world_y);
+
+		writer.write_varint(static_cast<unsigned int>(get_output_param_count(node)));
+		BinaryParamWriter param_writer(writer);
+		visit_output_params(node, param_writer);
+	}
+
+	writer.write_varint(static_cast<unsigned int>(connections.size()));
+	for (const OutputConnection& connection : connections) {
+		writer.write_string(connection.source_node);
+		writer.write_string(connection.source_socket);
+		writer.write_string(connection.dest_node);
+		writer.write_string(connection.dest_socket);
+	}
+
+	writer.finish(out);
+}
+
+// One decoded param value, shared by the text and binary readers
+struct ParamValue {
+	ParamKind kind = ParamKind::Float;
+	float float_values[3] = { 0.0f, 0.0f, 0.0f };
+	int int_value = 0;
+	CyclesShaderEditor::StringSlice string_value;
+	// False when a curve could not be parsed, the socket's curve is reset to its default in that case
+	bool curve_valid = false;
+	std::vector<CyclesShaderEditor::Point2> curve_points;
+	CyclesShaderEditor::CurveInterpolation curve_interp = CyclesShaderEditor::CurveInterpolation::LINEAR;
+};
+
+// Everything that comes before a node's params
+struct NodeHeader {
+	CyclesShaderEditor::StringSlice type_code;
+	CyclesShaderEditor::StringSlice name;
+	float x_position = 0.0f;
+	float y_position = 0.0f;
+};
+
+// Hands out the params of one node
+// Text params are only parsed once the type of the socket they belong to is known
+class ParamReader {
+public:
+	virtual ~ParamReader() {}
+
+	// Moves to the next param, returns false when the node has no params left
+	virtual bool next_param(CyclesShaderEditor::StringSlice& name) = 0;
+	// Returns the current param's value for a socket of the given type, or nullptr if it can not be used for that type
+	virtual const ParamValue* read_value(CyclesShaderEditor::SocketType socket_type) = 0;
+};
+
+class TextParamReader : public ParamReader {
+public:
+	TextParamReader(CyclesShaderEditor::Tokenizer& tokens) : tokens(tokens) {}
+
+	virtual bool next_param(CyclesShaderEditor::StringSlice& name) override
+	{
+		// Params are name/value pairs, a trailing name with no value is ignored
+		return tokens.next(name) && tokens.next(value_str);
+	}
+
+	virtual const ParamValue* read_value(CyclesShaderEditor::SocketType socket_type) override
+	{
+		using namespace CyclesShaderEditor;
+
+		switch (socket_type) {
+		case SocketType::Float:
+			value.kind = ParamKind::Float;
+			return read_float(value_str, value.float_values[0]) ? &value : nullptr;
+		case SocketType::Color:
+		case SocketType::Vector:
 		{
-			return new BlackbodyNode(pos);
+			value.kind = ParamKind::Float3;
+			Tokenizer float_tokenizer(value_str, ',');
+			StringSlice xyz_str[3];
+			if (!float_tokenizer.next(xyz_str[0]) || !float_tokenizer.next(xyz_str[1]) || !float_tokenizer.next(xyz_str[2]) || !float_tokenizer.at_end()) {
+				return nullptr;
+			}
+			for (int i = 0; i < 3; i++) {
+				if (!read_float(xyz_str[i], value.float_values[i])) {
+					return nullptr;
+				}
+			}
+			return &value;
 		}
-		case CyclesNodeType::CombineHSV:
-		{
-			return new CombineHSVNode(pos);
+		case SocketType::StringEnum:
+			value.kind = ParamKind::String;
+			value.string_value = value_str;
+			return &value;
+		case SocketType::Int:
+			value.kind = ParamKind::Int;
+			return read_int(value_str, value.int_value) ? &value : nullptr;
+		case SocketType::Boolean:
+			value.kind = ParamKind::Bool;
+			return read_int(value_str, value.int_value) ? &value : nullptr;
+		case SocketType::Curve:
+			value.kind = ParamKind::Curve;
+			value.curve_valid = parse_curve(value_str, value.curve_points, value.curve_interp);
+			return &value;
+		default:
+			return nullptr;
 		}
-		case CyclesNodeType::CombineRGB:
-		{
-			return new CombineRGBNode(pos);
+	}
+
+private:
+	CyclesShaderEditor::Tokenizer& tokens;
+	CyclesShaderEditor::StringSlice value_str;
+	ParamValue value;
+};
+
+// Little-endian reader for binary graphs, every read fails once the end of the input is reached
+class BinaryReader {
+public:
+	BinaryReader(const char* begin, size_t length) :
+		pos(reinterpret_cast<const unsigned char*>(begin)),
+		end(reinterpret_cast<const unsigned char*>(begin) + length)
+	{
+
+	}
+
+	bool read_u8(unsigned char& result)
+	{
+		if (pos == end) {
+			return false;
 		}
-		case CyclesNodeType::CombineXYZ:
-		{
-			return new CombineXYZNode(pos);
+		result = *(pos++);
+		return true;
+	}
+
+	// Unsigned LEB128, at most 5 bytes for 32 bits
+	bool read_varint(unsigned int& result)
+	{
+		result = 0;
+		for (int shift = 0; shift < 35; shift += 7) {
+			unsigned char byte = 0;
+			if (!read_u8(byte)) {
+				return false;
+			}
+			result |= static_cast<unsigned int>(byte & 0x7f) << shift;
+			if ((byte & 0x80) == 0) {
+				return true;
+			}
 		}
-		case CyclesNodeType::Math:
-		{
-			return new MathNode(pos);
+		return false;
+	}
+
+	bool read_f32(float& result)
+	{
+		if (end - pos < 4) {
+			return false;
+		}
+		const unsigned int bits =
+			static_cast<unsigned int>(pos[0]) |
+			(static_cast<unsigned int>(pos[1]) << 8) |
+			(static_cast<unsigned int>(pos[2]) << 16) |
+			(static_cast<unsigned int>(pos[3]) << 24);
+		static_assert(sizeof(bits) == sizeof(result), "float must be 32 bits");
+		memcpy(&result, &bits, sizeof(result));
+		pos += 4;
+		return true;
+	}
+
+	bool read_bytes(size_t length, CyclesShaderEditor::StringSlice& result)
+	{
+		if (static_cast<size_t>(end - pos) < length) {
+			return false;
 		}
-		case CyclesNodeType::RGBtoBW:
-		{
-			return new RGBToBWNode(pos);
+		result = CyclesShaderEditor::StringSlice(reinterpret_cast<const char*>(pos), length);
+		pos += length;
+		return true;
+	}
+
+	// Used to reject counts that could not possibly fit in the rest of the input before reserving memory for them
+	size_t remaining() const
+	{
+		return end - pos;
+	}
+
+private:
+	const unsigned char* pos;
+	const unsigned char* end;
+};
+
+// Reads an interned string, an index into the graph's string table
+static bool read_string_id(BinaryReader& reader, const std::vector<CyclesShaderEditor::StringSlice>& string_table, CyclesShaderEditor::StringSlice& result)
+{
+	unsigned int id = 0;
+	if (!reader.read_varint(id) || id >= string_table.size()) {
+		return false;
+	}
+	result = string_table[id];
+	return true;
+}
+
+class BinaryParamReader : public ParamReader {
+public:
+	BinaryParamReader(BinaryReader& reader, const std::vector<CyclesShaderEditor::StringSlice>& string_table, unsigned int param_count) :
+		reader(reader),
+		string_table(string_table),
+		params_left(param_count),
+		failed(false)
+	{
+
+	}
+
+	virtual bool next_param(CyclesShaderEditor::StringSlice& name) override
+	{
+		if (params_left == 0 || failed) {
+			return false;
 		}
-		case CyclesNodeType::SeparateHSV:
-		{
-			return new SeparateHSVNode(pos);
+		params_left--;
+
+		unsigned char kind = 0;
+		if (!read_string_id(reader, string_table, name) || !reader.read_u8(kind) || !read_payload(static_cast<ParamKind>(kind))) {
+			failed = true;
+			return false;
 		}
-		case CyclesNodeType::SeparateRGB:
-		{
-			return new SeparateRGBNode(pos);
+		return true;
+	}
+
+	virtual const ParamValue* read_value(CyclesShaderEditor::SocketType socket_type) override
+	{
+		using namespace CyclesShaderEditor;
+
+		switch (socket_type) {
+		case SocketType::Float:
+			return value.kind == ParamKind::Float ? &value : nullptr;
+		case SocketType::Color:
+		case SocketType::Vector:
+			return value.kind == ParamKind::Float3 ? &value : nullptr;
+		case SocketType::StringEnum:
+			return value.kind == ParamKind::String ? &value : nullptr;
+		case SocketType::Int:
+			return value.kind == ParamKind::Int ? &value : nullptr;
+		case SocketType::Boolean:
+			return value.kind == ParamKind::Bool ? &value : nullptr;
+		case SocketType::Curve:
+			return value.kind == ParamKind::Curve ? &value : nullptr;
+		default:
+			return nullptr;
 		}
-		case CyclesNodeType::SeparateXYZ:
+	}
+
+	// True if the input ended in the middle of a param
+	bool has_failed() const
+	{
+		return failed;
+	}
+
+private:
+	bool read_payload(ParamKind kind)
+	{
+		value.kind = kind;
+		switch (kind) {
+		case ParamKind::Float:
+			return reader.read_f32(value.float_values[0]);
+		case ParamKind::Float3:
+			return reader.read_f32(value.float_values[0]) && reader.read_f32(value.float_values[1]) && reader.read_f32(value.float_values[2]);
+		case ParamKind::String:
+			return read_string_id(reader, string_table, value.string_value);
+		case ParamKind::Int:
 		{
-			return new SeparateXYZNode(pos);
+			unsigned int bits = 0;
+			if (!reader.read_varint(bits)) {
+				return false;
+			}
+			// Zigzag encoded so small negative values stay small
+			value.int_value = static_cast<int>((bits >> 1) ^ (~(bits & 1) + 1));
+			return true;
 		}
-		case CyclesNodeType::VectorMath:
+		case ParamKind::Bool:
 		{
-			return new VectorMathNode(pos);
+			unsigned char byte = 0;
+			if (!reader.read_u8(byte)) {
+				return false;
+			}
+			value.int_value = byte;
+			return true;
 		}
-		case CyclesNodeType::Wavelength:
+		case ParamKind::Curve:
 		{
-			return new WavelengthNode(pos);
+			unsigned char interp = 0;
+			unsigned int point_count = 0;
+			if (!reader.read_u8(interp) || !reader.read_varint(point_count) || point_count > reader.remaining() / 8) {
+				return false;
+			}
+			value.curve_points.clear();
+			value.curve_points.reserve(point_count);
+			for (unsigned int i = 0; i < point_count; i++) {
+				float x = 0.0f;
+				float y = 0.0f;
+				if (!reader.read_f32(x) || !reader.read_f32(y)) {
+					return false;
+				}
+				value.curve_points.push_back(CyclesShaderEditor::Point2(x, y));
+			}
+			// Same rule as text curves, a curve needs at least one point
+			value.curve_valid = (point_count > 0);
+			value.curve_interp = (interp == 1) ? CyclesShaderEditor::CurveInterpolation::CUBIC_HERMITE : CyclesShaderEditor::CurveInterpolation::LINEAR;
+			return true;
 		}
-		case CyclesNodeType::MaterialOutput:
-		{
-			return new MaterialOutputNode(pos);
 		}
+
+		// Unknown kind, the size of the value can not be known so nothing after this can be read
+		return false;
 	}
 
-	return nullptr;
+	BinaryReader& reader;
+	const std::vector<CyclesShaderEditor::StringSlice>& string_table;
+	unsigned int params_left;
+	bool failed;
+	ParamValue value;
+};
+
+static bool point2_x_lt(CyclesShaderEditor::Point2 a, CyclesShaderEditor::Point2 b)
+{
+	return a.get_pos_x() < b.get_pos_x();
 }
 
-static CyclesShaderEditor::EditorNode* deserialize_node(std::list<std::string>& tokens, std::map<std::string, CyclesShaderEditor::EditorNode*>& nodes_by_name)
+static void deserialize_param(CyclesShaderEditor::NodeSocket* socket, const ParamValue& value)
 {
 	using namespace CyclesShaderEditor;
 
-	initialize_maps();
-
-	if (tokens.size() < 4) {
-		return nullptr;
+	if (socket->value == nullptr) {
+		return;
 	}
 
-	std::list<std::string>::iterator token_iter = tokens.begin();
+	switch (socket->socket_type) {
 
-	std::string type_code = *(token_iter++);
-	std::string name = *(token_iter++);
-	float x_position = std::stof(*(token_iter++));
-	float y_position = std::stof(*(token_iter++));
+	case SocketType::Float:
+		socket->set_float_val(value.float_values[0]);
+		break;
 
-	std::map<std::string, std::string> params;
-	while (token_iter != tokens.end()) {
-		std::string name = *(token_iter++);
-		if (token_iter == tokens.end()) {
-			break;
+	case SocketType::Color:
+	case SocketType::Vector:
+		socket->set_float3_val(value.float_values[0], value.float_values[1], value.float_values[2]);
+		break;
+
+	case SocketType::StringEnum:
+		dynamic_cast<StringEnumSocketValue*>(socket->value)->set_from_internal_name(value.string_value.to_string());
+		break;
+
+	case SocketType::Int:
+	{
+		IntSocketValue* int_val = dynamic_cast<IntSocketValue*>(socket->value);
+		int_val->set_value(value.int_value);
+		break;
+	}
+
+	case SocketType::Boolean:
+	{
+		BoolSocketValue* bool_val = dynamic_cast<BoolSocketValue*>(socket->value);
+		bool_val->value = value.int_value != 0;
+		break;
+	}
+
+	case SocketType::Curve:
+	{
+		CurveSocketValue* curve_val = dynamic_cast<CurveSocketValue*>(socket->value);
+		if (value.curve_valid) {
+			curve_val->curve_points = value.curve_points;
+			curve_val->curve_interp = value.curve_interp;
+			curve_val->sort_curve_points();
+		}
+		else {
+			curve_val->reset_value();
 		}
-		std::string value = *(token_iter++);
-		params[name] = value;
+		break;
 	}
 
-	if (code_to_type.count(type_code) == 0) {
+	default:
+		break;
+	}
+}
+
+static CyclesShaderEditor::EditorNode* deserialize_node(const NodeHeader& header, ParamReader& params, CyclesShaderEditor::ArenaMap<CyclesShaderEditor::StringSlice, CyclesShaderEditor::EditorNode*>& nodes_by_name)
+{
+	using namespace CyclesShaderEditor;
+
+	const NodeTypeInfo* const type_info = find_node_type_info(header.type_code);
+	if (type_info == nullptr) {
 		// Unknown type
 		return nullptr;
 	}
 
-	CyclesNodeType type = code_to_type[type_code];
+	EditorNode* result = type_info->create(Point2(header.x_position, header.y_position));
 
-	EditorNode* result = create_node_from_type(type, Point2(x_position, y_position));
-	
 	if (result == nullptr) {
 		return nullptr;
 	}
 
-	for (std::pair<std::string, std::string> this_param : params) {
-		NodeSocket* this_socket = result->get_socket_by_internal_name(SocketInOut::Input, this_param.first);
+	StringSlice param_name;
+	while (params.next_param(param_name)) {
+		NodeSocket* this_socket = result->get_socket_by_internal_name(SocketInOut::Input, param_name);
 
 		if (this_socket == nullptr) {
 			continue;
 		}
 
-		switch (this_socket->socket_type) {
-
-		case SocketType::Float:
-			this_socket->set_float_val(std::stof(this_param.second));
-			break;
-
-		case SocketType::Color:
-		case SocketType::Vector:
-		{
-			std::list<std::string> floats = tokenize_string(this_param.second, ',');
-			if (floats.size() != 3) {
-				break;
-			}
-			std::list<std::string>::iterator float_iter = floats.begin();
-			std::string x = *(float_iter++);
-			std::string y = *(float_iter++);
-			std::string z = *(float_iter++);
-			this_socket->set_float3_val(std::stof(x), std::stof(y), std::stof(z));
-			break;
+		const ParamValue* const value = params.read_value(this_socket->socket_type);
+		if (value != nullptr) {
+			deserialize_param(this_socket, *value);
 		}
+	}
 
-		case SocketType::StringEnum:
-			if (this_socket->value != nullptr) {
-				dynamic_cast<StringEnumSocketValue*>(this_socket->value)->set_from_internal_name(this_param.second);
-			}
-			break;
+	nodes_by_name[header.name] = result;
 
-		case SocketType::Int:
-			if (this_socket->value != nullptr) {
-				IntSocketValue* int_val = dynamic_cast<IntSocketValue*>(this_socket->value);
-				int_val->set_value(std::stoi(this_param.second));
-			}
-			break;
+	return result;
+}
 
-		case SocketType::Boolean:
-			if (this_socket->value != nullptr) {
-				BoolSocketValue* bool_val = dynamic_cast<BoolSocketValue*>(this_socket->value);
-				bool_val->value = std::stoi(this_param.second) != 0;
-			}
-			break;
+static bool has_binary_header(CyclesShaderEditor::StringSlice graph)
+{
+	const size_t header_length = strlen(BINARY_HEADER);
+	return graph.size() >= header_length && memcmp(graph.data(), BINARY_HEADER, header_length) == 0;
+}
 
-		case SocketType::Curve:
-			if (this_socket->value != nullptr) {
-				CurveSocketValue* curve_val = dynamic_cast<CurveSocketValue*>(this_socket->value);
-				deserialize_curve(this_param.second, curve_val);
-			}
+// Reads the header and params of one text node, node_text is every token of the node before NODE_END
+template <typename NodeFunc>
+static void walk_text_node(CyclesShaderEditor::StringSlice node_text, NodeFunc& node_func)
+{
+	using namespace CyclesShaderEditor;
 
-		default:
-			break;
-		}
+	Tokenizer node_tokens(node_text, SEPARATOR);
+	NodeHeader header;
+	StringSlice x_position_str;
+	StringSlice y_position_str;
+	if (node_tokens.next(header.type_code) && node_tokens.next(header.name) && node_tokens.next(x_position_str) && node_tokens.next(y_position_str) &&
+		read_float(x_position_str, header.x_position) && read_float(y_position_str, header.y_position))
+	{
+		TextParamReader params(node_tokens);
+		node_func(header, params);
 	}
-
-	nodes_by_name[name] = result;
-
-	return result;
 }
 
-void CyclesShaderEditor::deserialize_graph(std::string graph, std::list<EditorNode*>& nodes, std::list<NodeConnection>& connections)
+// Walks the sections of a text graph
+// node_func receives the header and params of one node, connection_func receives the four tokens of one connection
+// Returns false if the graph is not valid or ends before the connection section
+template <typename NodeFunc, typename ConnectionFunc>
+static bool walk_text_graph(CyclesShaderEditor::StringSlice graph, NodeFunc node_func, ConnectionFunc connection_func)
 {
-	std::map<std::string, EditorNode*> nodes_by_name;
-
-	std::list<std::string> graph_tokens = tokenize_string(graph, SEPARATOR);
+	using namespace CyclesShaderEditor;
 
-	std::list<std::string>::iterator token_iter = graph_tokens.begin();
+	Tokenizer graph_tokens(graph.data(), graph.size(), SEPARATOR);
+	StringSlice token;
 
-	if (token_iter == graph_tokens.end() || (*token_iter) != MAGIC_WORD) {
-		return;
+	if (!graph_tokens.next(token) || token != MAGIC_WORD) {
+		return false;
 	}
-	++token_iter;
 
-	if (token_iter == graph_tokens.end() || (*token_iter) != CURRENT_VERSION) {
-		return;
+	if (!graph_tokens.next(token) || token != CURRENT_VERSION) {
+		return false;
 	}
-	++token_iter;
 
 	// Construct nodes
-	if (token_iter == graph_tokens.end() || (*token_iter) != SECTION_LABEL_NODE) {
-		return;
+	if (!graph_tokens.next(token) || token != SECTION_LABEL_NODE) {
+		return false;
 	}
-	++token_iter;
 
 	// Loop making nodes until we see connection section
+	bool more_tokens = graph_tokens.next(token);
 	while (true) {
-		std::list<std::string> node_tokens;
-		while (token_iter != graph_tokens.end() && (*token_iter) != NODE_END) {
-			node_tokens.push_back(*token_iter);
-			++token_iter;
+		// Find the range of this node's tokens, they end with NODE_END or the end of the graph
+		const char* const node_begin = token.data();
+		const char* node_end = node_begin;
+		bool found_node_end = false;
+		while (more_tokens) {
+			if (token == NODE_END) {
+				found_node_end = true;
+				break;
+			}
+			node_end = token.data() + token.size();
+			more_tokens = graph_tokens.next(token);
 		}
 
-		EditorNode* node = deserialize_node(node_tokens, nodes_by_name);
-		if (node != nullptr) {
-			nodes.push_back(node);
-		}
+		walk_text_node(StringSlice(node_begin, node_end - node_begin), node_func);
 
-		if (token_iter == graph_tokens.end()) {
-			return;
+		if (found_node_end == false) {
+			return false;
 		}
 
-		++token_iter;
-		if (token_iter == graph_tokens.end() || *token_iter == SECTION_LABEL_CONNECTION) {
+		more_tokens = graph_tokens.next(token);
+		if (more_tokens == false || token == SECTION_LABEL_CONNECTION) {
 			break;
 		}
 	}
 
-	// Advance past connection begin token
-	++token_iter;
-
 	// Loop while making connections
-	while (token_iter != graph_tokens.end()) {
+	StringSlice source_node;
+	StringSlice source_socket;
+	StringSlice dest_node;
+	StringSlice dest_socket;
+	while (graph_tokens.next(source_node) && graph_tokens.next(source_socket) && graph_tokens.next(dest_node) && graph_tokens.next(dest_socket)) {
+		connection_func(source_node, source_socket, dest_node, dest_socket);
+	}
 
-		if (token_iter == graph_tokens.end()) {
-			break;
-		}
-		std::string source_node = *(token_iter++);
-		if (token_iter == graph_tokens.end()) {
-			break;
-		}
-		std::string source_socket = *(token_iter++);
-		if (token_iter == graph_tokens.end()) {
-			break;
-		}
-		std::string dest_node = *(token_iter++);
-		if (token_iter == graph_tokens.end()) {
-			break;
-		}
-		std::string dest_socket = *(token_iter++);
+	return true;
+}
 
-		if (nodes_by_name.count(source_node) == 0 || nodes_by_name.count(dest_node) == 0) {
-			continue;
+// Reads the string table at the start of a binary graph, the strings point into the reader's buffer
+static bool read_string_table(BinaryReader& reader, std::vector<CyclesShaderEditor::StringSlice>& string_table)
+{
+	unsigned int string_count = 0;
+	if (!reader.read_varint(string_count) || string_count > reader.remaining()) {
+		return false;
+	}
+	string_table.resize(string_count);
+	for (CyclesShaderEditor::StringSlice& this_string : string_table) {
+		unsigned int length = 0;
+		if (!reader.read_varint(length) || !reader.read_bytes(length, this_string)) {
+			return false;
 		}
+	}
+	return true;
+}
 
-		NodeSocket* source = nodes_by_name[source_node]->get_socket_by_display_name(SocketInOut::Output, source_socket);
-		NodeSocket* dest = nodes_by_name[dest_node]->get_socket_by_display_name(SocketInOut::Input, dest_socket);
+// Reads one binary node, node_func is only called if the node's header could be read
+// Returns false if the node is not valid or the input ends part way through it
+template <typename NodeFunc>
+static bool walk_binary_node(BinaryReader& reader, const std::vector<CyclesShaderEditor::StringSlice>& string_table, NodeFunc& node_func)
+{
+	using namespace CyclesShaderEditor;
 
-		if (source == nullptr || dest == nullptr) {
-			continue;
-		}
+	NodeHeader header;
+	unsigned int param_count = 0;
+	if (!read_string_id(reader, string_table, header.type_code) || !read_string_id(reader, string_table, header.name) ||
+		!reader.read_f32(header.x_position) || !reader.read_f32(header.y_position) || !reader.read_varint(param_count))
+	{
+		return false;
+	}
 
-		NodeConnection connection(source, dest);
-		connections.push_back(connection);
+	BinaryParamReader params(reader, string_table, param_count);
+	node_func(header, params);
+
+	// Skip any params the node did not read so the next node starts in the right place
+	StringSlice unused_name;
+	while (params.next_param(unused_name)) {}
+	return params.has_failed() == false;
+}
+
+static bool read_binary_connection(
+	BinaryReader& reader,
+	const std::vector<CyclesShaderEditor::StringSlice>& string_table,
+	CyclesShaderEditor::StringSlice& source_node,
+	CyclesShaderEditor::StringSlice& source_socket,
+	CyclesShaderEditor::StringSlice& dest_node,
+	CyclesShaderEditor::StringSlice& dest_socket)
+{
+	return read_string_id(reader, string_table, source_node) && read_string_id(reader, string_table, source_socket) &&
+		read_string_id(reader, string_table, dest_node) && read_string_id(reader, string_table, dest_socket);
+}
+
+// Binary equivalent of walk_text_graph
+template <typename NodeFunc, typename ConnectionFunc>
+static bool walk_binary_graph(CyclesShaderEditor::StringSlice graph, NodeFunc node_func, ConnectionFunc connection_func)
+{
+	using namespace CyclesShaderEditor;
+
+	if (!has_binary_header(graph)) {
+		return false;
 	}
 
-	// Mark all nodes as unchanged so an undo push isn't triggered
-	for (EditorNode* node : nodes) {
-		node->changed = false;
+	BinaryReader reader(graph.data() + strlen(BINARY_HEADER), graph.size() - strlen(BINARY_HEADER));
+
+	std::vector<StringSlice> string_table;
+	if (!read_string_table(reader, string_table)) {
+		return false;
 	}
+
+	unsigned int node_count = 0;
+	if (!reader.read_varint(node_count)) {
+		return false;
+	}
+	for (unsigned int i = 0; i < node_count; i++) {
+		if (!walk_binary_node(reader, string_table, node_func)) {
+			return false;
+		}
+	}
+
+	unsigned int connection_count = 0;
+	if (!reader.read_varint(connection_count)) {
+		return false;
+	}
+	for (unsigned int i = 0; i < connection_count; i++) {
+		StringSlice source_node;
+		StringSlice source_socket;
+		StringSlice dest_node;
+		StringSlice dest_socket;
+		if (!read_binary_connection(reader, string_table, source_node, source_socket, dest_node, dest_socket)) {
+			return false;
+		}
+		connection_func(source_node, source_socket, dest_node, dest_socket);
+	}
+
+	return true;
+}
+
+// Picks the reader for the graph's format based on its header
+template <typename NodeFunc, typename ConnectionFunc>
+static bool walk_graph(CyclesShaderEditor::StringSlice graph, NodeFunc node_func, ConnectionFunc connection_func)
+{
+	if (has_binary_header(graph)) {
+		return walk_binary_graph(graph, node_func, connection_func);
+	}
+	return walk_text_graph(graph, node_func, connection_func);
+}
+
+// Size of each read from a GraphInputStream
+static const size_t STREAM_CHUNK_SIZE = 64 * 1024;
+
+// The part of a streamed graph that has been read and is still needed
+// Positions are counted from the start of the stream, so they stay the same when bytes before them are dropped
+// Pointers into the window are only valid until the next call to read_more
+class StreamWindow {
+public:
+	StreamWindow(CyclesShaderEditor::GraphInputStream& input) : input(input) {}
+
+	// Appends at least one more chunk, or as much again as is already held so a large node is not read one chunk at a time
+	// Returns false once the end of the input is reached
+	bool read_more()
+	{
+		if (end_of_input) {
+			return false;
+		}
+
+		// Dropped bytes are only removed here, when the buffer is about to change anyway
+		if (keep_from > base) {
+			buffer.erase(0, keep_from - base);
+			base = keep_from;
+		}
+
+		const size_t old_size = buffer.size();
+		const size_t read_size = std::max(STREAM_CHUNK_SIZE, old_size);
+		buffer.resize(old_size + read_size);
+		const size_t bytes_read = input.read(&buffer[old_size], read_size);
+		buffer.resize(old_size + bytes_read);
+		if (bytes_read == 0) {
+			end_of_input = true;
+			return false;
+		}
+		return true;
+	}
+
+	// Everything before pos is no longer needed
+	void discard_before(size_t pos)
+	{
+		keep_from = pos;
+	}
+
+	const char* at(size_t pos) const
+	{
+		return buffer.data() + (pos - base);
+	}
+
+	CyclesShaderEditor::StringSlice slice(size_t begin, size_t end) const
+	{
+		return CyclesShaderEditor::StringSlice(at(begin), end - begin);
+	}
+
+	size_t end_pos() const
+	{
+		return base + buffer.size();
+	}
+
+private:
+	CyclesShaderEditor::GraphInputStream& input;
+	std::string buffer;
+	// Stream position of buffer[0]
+	size_t base = 0;
+	size_t keep_from = 0;
+	bool end_of_input = false;
+};
+
+// Same tokens as Tokenizer, handed out as stream positions because the window may move while the next token is found
+class StreamTokenizer {
+public:
+	StreamTokenizer(StreamWindow& window) : window(window) {}
+
+	bool next(size_t& token_begin, size_t& token_end)
+	{
+		if (done) {
+			return false;
+		}
+
+		size_t search_from = pos;
+		while (true) {
+			const size_t search_length = window.end_pos() - search_from;
+			const char* const search_begin = window.at(search_from);
+			const char* const found = (search_length == 0) ? nullptr : static_cast<const char*>(memchr(search_begin, SEPARATOR, search_length));
+			if (found != nullptr) {
+				token_begin = pos;
+				token_end = search_from + (found - search_begin);
+				pos = token_end + 1;
+				return true;
+			}
+			search_from = window.end_pos();
+			if (window.read_more() == false) {
+				break;
+			}
+		}
+
+		// Like Tokenizer, empty input has no tokens and otherwise the last token runs to the end of the input
+		done = true;
+		if (window.end_pos() == 0) {
+			return false;
+		}
+		token_begin = pos;
+		token_end = window.end_pos();
+		pos = token_end;
+		return true;
+	}
+
+	// Position just after the last token handed out
+	size_t get_pos() const
+	{
+		return pos;
+	}
+
+private:
+	StreamWindow& window;
+	size_t pos = 0;
+	bool done = false;
+};
+
+// Streamed version of walk_text_graph, the window only ever holds the node or connection being read
+// Node names are copied into name_storage so they stay valid for the connection section
+template <typename NodeFunc, typename ConnectionFunc>
+static bool walk_text_stream(StreamWindow& window, CyclesShaderEditor::MonotonicArena& name_storage, NodeFunc node_func, ConnectionFunc connection_func)
+{
+	using namespace CyclesShaderEditor;
+
+	StreamTokenizer graph_tokens(window);
+	size_t token_begin = 0;
+	size_t token_end = 0;
+
+	if (!graph_tokens.next(token_begin, token_end) || window.slice(token_begin, token_end) != MAGIC_WORD) {
+		return false;
+	}
+
+	if (!graph_tokens.next(token_begin, token_end) || window.slice(token_begin, token_end) != CURRENT_VERSION) {
+		return false;
+	}
+
+	if (!graph_tokens.next(token_begin, token_end) || window.slice(token_begin, token_end) != SECTION_LABEL_NODE) {
+		return false;
+	}
+
+	const auto stable_node_func = [&](const NodeHeader& header, ParamReader& params) {
+		NodeHeader stable_header = header;
+		char* const name = static_cast<char*>(name_storage.allocate(header.name.size() + 1, 1));
+		memcpy(name, header.name.data(), header.name.size());
+		stable_header.name = StringSlice(name, header.name.size());
+		node_func(stable_header, params);
+	};
+
+	bool more_tokens = graph_tokens.next(token_begin, token_end);
+	while (true) {
+		// The whole node is read into the window before any of it is decoded
+		const size_t node_begin = token_begin;
+		size_t node_end = node_begin;
+		bool found_node_end = false;
+		while (more_tokens) {
+			if (window.slice(token_begin, token_end) == NODE_END) {
+				found_node_end = true;
+				break;
+			}
+			node_end = token_end;
+			more_tokens = graph_tokens.next(token_begin, token_end);
+		}
+
+		walk_text_node(window.slice(node_begin, node_end), stable_node_func);
+
+		if (found_node_end == false) {
+			return false;
+		}
+
+		window.discard_before(graph_tokens.get_pos());
+		more_tokens = graph_tokens.next(token_begin, token_end);
+		if (more_tokens == false || window.slice(token_begin, token_end) == SECTION_LABEL_CONNECTION) {
+			break;
+		}
+	}
+
+	size_t token_ranges[8];
+	while (graph_tokens.next(token_ranges[0], token_ranges[1]) && graph_tokens.next(token_ranges[2], token_ranges[3]) &&
+		graph_tokens.next(token_ranges[4], token_ranges[5]) && graph_tokens.next(token_ranges[6], token_ranges[7]))
+	{
+		connection_func(
+			window.slice(token_ranges[0], token_ranges[1]),
+			window.slice(token_ranges[2], token_ranges[3]),
+			window.slice(token_ranges[4], token_ranges[5]),
+			window.slice(token_ranges[6], token_ranges[7]));
+		window.discard_before(graph_tokens.get_pos());
+	}
+
+	return true;
+}
+
+// Makes sure the window holds everything read_func needs starting at pos, read_func must not have side effects
+// Returns false if read_func still fails once the whole stream has been read
+template <typename ReadFunc>
+static bool fill_binary_window(StreamWindow& window, size_t pos, ReadFunc read_func)
+{
+	while (true) {
+		BinaryReader reader(window.at(pos), window.end_pos() - pos);
+		if (read_func(reader)) {
+			return true;
+		}
+		if (window.read_more() == false) {
+			return false;
+		}
+	}
+}
+
+// Streamed version of walk_binary_graph
+// Only the string table is kept for the whole graph, node names are already in it
+template <typename NodeFunc, typename ConnectionFunc>
+static bool walk_binary_stream(StreamWindow& window, NodeFunc node_func, ConnectionFunc connection_func)
+{
+	using namespace CyclesShaderEditor;
+
+	size_t pos = strlen(BINARY_HEADER);
+
+	// The table is copied out of the window so it outlives the chunks it was read from
+	std::vector<StringSlice> string_table;
+	size_t table_end = pos;
+	const bool table_read = fill_binary_window(window, pos, [&](BinaryReader& reader) {
+		if (!read_string_table(reader, string_table)) {
+			return false;
+		}
+		table_end = window.end_pos() - reader.remaining();
+		return true;
+	});
+	if (!table_read) {
+		return false;
+	}
+	const std::string string_data(window.at(pos), table_end - pos);
+	BinaryReader table_reader(string_data.data(), string_data.size());
+	read_string_table(table_reader, string_table);
+	pos = table_end;
+	window.discard_before(pos);
+
+	// Reads a varint count, moving pos past it
+	const auto read_count = [&](unsigned int& count) {
+		if (!fill_binary_window(window, pos, [&](BinaryReader& reader) { return reader.read_varint(count); })) {
+			return false;
+		}
+		BinaryReader reader(window.at(pos), window.end_pos() - pos);
+		reader.read_varint(count);
+		pos = window.end_pos() - reader.remaining();
+		window.discard_before(pos);
+		return true;
+	};
+
+	unsigned int node_count = 0;
+	if (!read_count(node_count)) {
+		return false;
+	}
+	const auto skip_node = [](const NodeHeader&, ParamReader&) {};
+	for (unsigned int i = 0; i < node_count; i++) {
+		// The node is skipped over first to find where it ends, then decoded once it is all in the window
+		// If the stream ends part way through, what there is still goes to node_func the same as walk_binary_graph
+		const bool complete = fill_binary_window(window, pos, [&](BinaryReader& reader) { return walk_binary_node(reader, string_table, skip_node); });
+		BinaryReader reader(window.at(pos), window.end_pos() - pos);
+		if (!walk_binary_node(reader, string_table, node_func) || complete == false) {
+			return false;
+		}
+		pos = window.end_pos() - reader.remaining();
+		window.discard_before(pos);
+	}
+
+	unsigned int connection_count = 0;
+	if (!read_count(connection_count)) {
+		return false;
+	}
+	for (unsigned int i = 0; i < connection_count; i++) {
+		StringSlice source_node;
+		StringSlice source_socket;
+		StringSlice dest_node;
+		StringSlice dest_socket;
+		const bool complete = fill_binary_window(window, pos, [&](BinaryReader& reader) {
+			return read_binary_connection(reader, string_table, source_node, source_socket, dest_node, dest_socket);
+		});
+		if (complete == false) {
+			return false;
+		}
+		BinaryReader reader(window.at(pos), window.end_pos() - pos);
+		read_binary_connection(reader, string_table, source_node, source_socket, dest_node, dest_socket);
+		pos = window.end_pos() - reader.remaining();
+		window.discard_before(pos);
+		connection_func(source_node, source_socket, dest_node, dest_socket);
+	}
+
+	return true;
+}
+
+// Streamed version of walk_graph
+template <typename NodeFunc, typename ConnectionFunc>
+static bool walk_graph(CyclesShaderEditor::GraphInputStream& graph, NodeFunc node_func, ConnectionFunc connection_func)
+{
+	using namespace CyclesShaderEditor;
+
+	StreamWindow window(graph);
+	const size_t header_length = strlen(BINARY_HEADER);
+	while (window.end_pos() < header_length && window.read_more()) {}
+
+	if (has_binary_header(window.slice(0, window.end_pos()))) {
+		return walk_binary_stream(window, node_func, connection_func);
+	}
+	MonotonicArena name_storage;
+	return walk_text_stream(window, name_storage, node_func, connection_func);
+}
+
+void CyclesShaderEditor::deserialize_graph(const std::string& graph, std::list<EditorNode*>& nodes, std::list<NodeConnection>& connections)
+{
+	// Nodes, sockets and values all come from one arena that is freed in one go once the last of them is deleted
+	NodeArenaScope node_arena_scope;
+	MonotonicArena scratch;
+	ArenaMap<StringSlice, EditorNode*> nodes_by_name(scratch);
+
+	const auto node_func = [&](const NodeHeader& header, ParamReader& params) {
+		EditorNode* node = deserialize_node(header, params, nodes_by_name);
+		if (node != nullptr) {
+			nodes.push_back(node);
+		}
+	};
+
+	const auto connection_func = [&](StringSlice source_node, StringSlice source_socket, StringSlice dest_node, StringSlice dest_socket) {
+		ArenaMap<StringSlice, EditorNode*>::iterator source_iter = nodes_by_name.find(source_node);
+		ArenaMap<StringSlice, EditorNode*>::iterator dest_iter = nodes_by_name.find(dest_node);
+		if (source_iter == nodes_by_name.end() || dest_iter == nodes_by_name.end()) {
+			return;
+		}
+
+		NodeSocket* source = source_iter->second->get_socket_by_display_name(SocketInOut::Output, source_socket);
+		NodeSocket* dest = dest_iter->second->get_socket_by_display_name(SocketInOut::Input, dest_socket);
+
+		if (source == nullptr || dest == nullptr) {
+			return;
+		}
+
+		NodeConnection connection(source, dest);
+		connections.push_back(connection);
+	};
+
+	if (walk_graph(StringSlice(graph), node_func, connection_func) == false) {
+		return;
+	}
+
+	// Mark all nodes as unchanged so an undo push isn't triggered
+	for (EditorNode* node : nodes) {
+		node->changed = false;
+	}
+}
+
+// Whether a socket holds the type of value a param has, see EditorNode::update_output_node
+static bool param_fits_socket(const CyclesShaderEditor::OutputParam& param, const CyclesShaderEditor::NodeSocket* socket)
+{
+	using namespace CyclesShaderEditor;
+
+	switch (socket->socket_type) {
+	case SocketType::Float:
+		return param.type == OutputParamType::Float;
+	case SocketType::Color:
+	case SocketType::Vector:
+		return param.type == OutputParamType::Float3;
+	case SocketType::StringEnum:
+		return param.type == OutputParamType::String;
+	case SocketType::Int:
+		return param.type == OutputParamType::Int;
+	case SocketType::Boolean:
+		return param.type == OutputParamType::Bool;
+	case SocketType::Curve:
+		return param.type == OutputParamType::Curve;
+	default:
+		return false;
+	}
+}
+
+// Sets a node's inputs from flat params the same way a decoded graph sets them, params with no matching input are ignored
+static void set_node_inputs(CyclesShaderEditor::EditorNode* node, const CyclesShaderEditor::OutputParams& params)
+{
+	using namespace CyclesShaderEditor;
+
+	ParamValue value;
+	for (const OutputParam& param : params.params) {
+		NodeSocket* const socket = node->get_socket_by_internal_name(SocketInOut::Input, StringSlice(get_output_param_name(param.id)));
+		if (socket == nullptr || !param_fits_socket(param, socket)) {
+			continue;
+		}
+
+		value.float_values[0] = param.float3_value.x;
+		value.float_values[1] = param.float3_value.y;
+		value.float_values[2] = param.float3_value.z;
+		value.int_value = (param.type == OutputParamType::Bool) ? (param.bool_value ? 1 : 0) : param.int_value;
+		value.string_value = StringSlice();
+		value.curve_valid = false;
+		if (param.type == OutputParamType::String) {
+			value.string_value = StringSlice(params.string_values[param.value_index]);
+		}
+		else if (param.type == OutputParamType::Curve) {
+			const OutputCurve& curve = params.curve_values[param.value_index];
+			value.curve_points.clear();
+			for (const Float2& point : curve.control_points) {
+				value.curve_points.push_back(Point2(point.x, point.y));
+			}
+			value.curve_valid = !value.curve_points.empty();
+			value.curve_interp = static_cast<CurveInterpolation>(curve.enum_curve_interp);
+		}
+		deserialize_param(socket, value);
+	}
+	node->output_changed = true;
+}
+
+// Both sockets of a connection, as they are looked up by name from a patch
+typedef std::pair<CyclesShaderEditor::NodeSocket*, CyclesShaderEditor::NodeSocket*> ConnectionSockets;
+
+static bool find_connection_sockets(CyclesShaderEditor::EditorNode* source, const std::string& source_socket, CyclesShaderEditor::EditorNode* dest, const std::string& dest_socket, ConnectionSockets& result)
+{
+	using namespace CyclesShaderEditor;
+
+	if (source == nullptr || dest == nullptr) {
+		return false;
+	}
+	result.first = source->get_socket_by_display_name(SocketInOut::Output, StringSlice(source_socket));
+	result.second = dest->get_socket_by_display_name(SocketInOut::Input, StringSlice(dest_socket));
+	return result.first != nullptr && result.second != nullptr;
+}
+
+bool CyclesShaderEditor::apply_graph_patch(std::list<EditorNode*>& nodes, std::list<NodeConnection>& connections, const SerializedGraphCache& names, const GraphPatch& patch)
+{
+	std::vector<EditorNode*> added_nodes;
+	std::vector<const EditorNode*> removed_nodes;
+	return apply_graph_patch(nodes, connections, names, patch, added_nodes, removed_nodes);
+}
+
+bool CyclesShaderEditor::apply_graph_patch(std::list<EditorNode*>& nodes, std::list<NodeConnection>& connections, const SerializedGraphCache& names, const GraphPatch& patch, std::vector<EditorNode*>& out_added_nodes, std::vector<const EditorNode*>& out_removed_nodes)
+{
+	out_added_nodes.clear();
+	out_removed_nodes.clear();
+
+	// Everything is looked up before anything is changed
+	std::unordered_set<EditorNode*> removed_nodes;
+	for (const OutputNode& node : patch.removed_nodes) {
+		EditorNode* const editor_node = names.find_node(StringSlice(node.name));
+		if (editor_node == nullptr || removed_nodes.insert(editor_node).second == false) {
+			return false;
+		}
+	}
+
+	std::vector<EditorNode*> changed_nodes;
+	changed_nodes.reserve(patch.changed_nodes.size());
+	for (const GraphPatchNodeChange& change : patch.changed_nodes) {
+		EditorNode* const editor_node = names.find_node(StringSlice(change.name));
+		if (editor_node == nullptr || removed_nodes.count(editor_node) != 0) {
+			return false;
+		}
+		changed_nodes.push_back(editor_node);
+	}
+
+	// Connections are found through the cache's index of the list, each one the patch removes must be a different connection
+	typedef std::list<NodeConnection>::const_iterator ConnectionPosition;
+	std::vector<ConnectionPosition> removed_connections;
+	std::unordered_set<const NodeConnection*> removed_connection_set;
+	std::vector<ConnectionPosition> found_connections;
+	for (const OutputConnection& connection : patch.removed_connections) {
+		ConnectionSockets sockets;
+		if (!find_connection_sockets(names.find_node(StringSlice(connection.source_node)), connection.source_socket, names.find_node(StringSlice(connection.dest_node)), connection.dest_socket, sockets)) {
+			return false;
+		}
+		found_connections.clear();
+		names.find_connections(sockets.first, sockets.second, found_connections);
+		bool found = false;
+		for (const ConnectionPosition& position : found_connections) {
+			if (removed_connection_set.insert(&*position).second) {
+				removed_connections.push_back(position);
+				found = true;
+				break;
+			}
+		}
+		if (found == false) {
+			return false;
+		}
+	}
+	std::vector<std::list<EditorNode*>::const_iterator> removed_node_positions;
+	removed_node_positions.reserve(removed_nodes.size());
+	for (EditorNode* const node : removed_nodes) {
+		std::list<EditorNode*>::const_iterator position;
+		if (names.find_list_position(node, position) == false) {
+			return false;
+		}
+		removed_node_positions.push_back(position);
+		// A connection to a removed node can not be left behind even if the patch did not list it
+		found_connections.clear();
+		names.find_connections(node, found_connections);
+		for (const ConnectionPosition& connection_position : found_connections) {
+			if (removed_connection_set.insert(&*connection_position).second) {
+				removed_connections.push_back(connection_position);
+			}
+		}
+	}
+
+	// Added nodes are created up front, they are deleted again if the patch turns out not to fit
+	std::vector<EditorNode*> added_nodes;
+	std::unordered_map<std::string, EditorNode*> added_nodes_by_name;
+	const auto discard_added_nodes = [&]() {
+		for (EditorNode* node : added_nodes) {
+			delete node;
+		}
+	};
+	for (const OutputNode& node : patch.added_nodes) {
+		EditorNode* const editor_node = create_node_from_type(node.type, Point2(node.world_x, node.world_y));
+		if (editor_node == nullptr) {
+			discard_added_nodes();
+			return false;
+		}
+		added_nodes.push_back(editor_node);
+		added_nodes_by_name[node.name] = editor_node;
+		set_node_inputs(editor_node, node.params);
+		editor_node->changed = false;
+	}
+
+	// Added nodes can take the name of a removed node
+	const auto find_node = [&](const std::string& name) -> EditorNode* {
+		const std::unordered_map<std::string, EditorNode*>::const_iterator added_iter = added_nodes_by_name.find(name);
+		if (added_iter != added_nodes_by_name.end()) {
+			return added_iter->second;
+		}
+		EditorNode* const editor_node = names.find_node(StringSlice(name));
+		return (removed_nodes.count(editor_node) == 0) ? editor_node : nullptr;
+	};
+	std::vector<ConnectionSockets> added_connections;
+	added_connections.reserve(patch.added_connections.size());
+	for (const OutputConnection& connection : patch.added_connections) {
+		ConnectionSockets sockets;
+		if (!find_connection_sockets(find_node(connection.source_node), connection.source_socket, find_node(connection.dest_node), connection.dest_socket, sockets)) {
+			discard_added_nodes();
+			return false;
+		}
+		added_connections.push_back(sockets);
+	}
+
+	for (const ConnectionPosition& position : removed_connections) {
+		connections.erase(position);
+	}
+	for (const std::list<EditorNode*>::const_iterator& position : removed_node_positions) {
+		nodes.erase(position);
+	}
+	for (EditorNode* node : removed_nodes) {
+		out_removed_nodes.push_back(node);
+		delete node;
+	}
+
+	for (size_t i = 0; i < patch.changed_nodes.size(); i++) {
+		const GraphPatchNodeChange& change = patch.changed_nodes[i];
+		EditorNode* const editor_node = changed_nodes[i];
+		if (change.new_world_x != change.old_world_x || change.new_world_y != change.old_world_y) {
+			editor_node->world_pos = Point2(change.new_world_x, change.new_world_y);
+		}
+		// Inputs can not be removed from an editor node, params only in old_params are left as they are
+		if (!change.new_params.empty()) {
+			set_node_inputs(editor_node, change.new_params);
+		}
+	}
+
+	nodes.insert(nodes.end(), added_nodes.begin(), added_nodes.end());
+	for (const ConnectionSockets& sockets : added_connections) {
+		connections.push_back(NodeConnection(sockets.first, sockets.second));
+	}
+	out_added_nodes.swap(added_nodes);
+
+	return true;
+}
+
+// Current value of one input while a node is decoded without an EditorNode, starts out as the schema default
+struct DecodedInputValue {
+	float float_values[3];
+	int int_value;
+	bool bool_value;
+	const std::string* string_value;
+	std::vector<CyclesShaderEditor::Point2> curve_points;
+	CyclesShaderEditor::CurveInterpolation curve_interp;
+};
+
+// Same clamping as the socket values' set_value
+template <typename T>
+static T clamp_param_value(T value, T min, T max)
+{
+	if (value < min) {
+		return min;
+	}
+	else if (value > max) {
+		return max;
+	}
+	return value;
+}
+
+// Replaces the contents of out_curve, its vectors keep their capacity so one curve can be filled many times
+static void fill_output_curve(const std::vector<CyclesShaderEditor::Point2>& curve_points, CyclesShaderEditor::CurveInterpolation curve_interp, CyclesShaderEditor::OutputCurve& out_curve)
+{
+	using namespace CyclesShaderEditor;
+
+	out_curve.control_points.clear();
+	out_curve.control_points.reserve(curve_points.size());
+	out_curve.samples.clear();
+	out_curve.samples.reserve(CURVE_TABLE_SIZE);
+	for (const Point2& this_point : curve_points) {
+		out_curve.control_points.push_back(Float2(this_point.get_pos_x(), this_point.get_pos_y()));
+	}
+	out_curve.enum_curve_interp = static_cast<int>(curve_interp);
+	CurveEvaluator curve(curve_points, curve_interp);
+	for (size_t i = 0; i < CURVE_TABLE_SIZE; i++) {
+		const float x = static_cast<float>(i) / (CURVE_TABLE_SIZE - 1.0f);
+		out_curve.samples.push_back(curve.eval(x));
+	}
+}
+
+// Headless version of deserialize_param
+static void deserialize_param_value(const CyclesShaderEditor::NodeInputSchema& input, DecodedInputValue& decoded, const ParamValue& value)
+{
+	using namespace CyclesShaderEditor;
+
+	switch (input.socket_type) {
+
+	case SocketType::Float:
+		decoded.float_values[0] = clamp_param_value(value.float_values[0], input.float_min[0], input.float_max[0]);
+		break;
+
+	case SocketType::Color:
+	case SocketType::Vector:
+		for (int i = 0; i < 3; i++) {
+			decoded.float_values[i] = clamp_param_value(value.float_values[i], input.float_min[i], input.float_max[i]);
+		}
+		break;
+
+	case SocketType::StringEnum:
+		for (const std::string& enum_value : input.enum_values) {
+			if (value.string_value == enum_value) {
+				decoded.string_value = &enum_value;
+				break;
+			}
+		}
+		break;
+
+	case SocketType::Int:
+		decoded.int_value = clamp_param_value(value.int_value, input.int_min, input.int_max);
+		break;
+
+	case SocketType::Boolean:
+		decoded.bool_value = value.int_value != 0;
+		break;
+
+	case SocketType::Curve:
+		if (value.curve_valid) {
+			decoded.curve_points = value.curve_points;
+			decoded.curve_interp = value.curve_interp;
+			std::sort(decoded.curve_points.begin(), decoded.curve_points.end(), point2_x_lt);
+		}
+		else {
+			decoded.curve_points = input.curve_default_points;
+		}
+		break;
+
+	default:
+		break;
+	}
+}
+
+// Builds the final output curves of an RGB curves node, see RGBCurvesNode::update_output_node
+// Returns false if the schema is missing one of the curves
+static bool make_rgb_curves_final_output(const CyclesShaderEditor::NodeTypeSchema& schema, const std::vector<DecodedInputValue>& decoded_values, CyclesShaderEditor::OutputCurve& out_r_curve, CyclesShaderEditor::OutputCurve& out_g_curve, CyclesShaderEditor::OutputCurve& out_b_curve)
+{
+	using namespace CyclesShaderEditor;
+
+	const NodeInputSchema* const rgb_curve_input = schema.get_input_by_internal_name(StringSlice("rgb_curve", 9));
+	const NodeInputSchema* const r_curve_input = schema.get_input_by_internal_name(StringSlice("r_curve", 7));
+	const NodeInputSchema* const g_curve_input = schema.get_input_by_internal_name(StringSlice("g_curve", 7));
+	const NodeInputSchema* const b_curve_input = schema.get_input_by_internal_name(StringSlice("b_curve", 7));
+	if (rgb_curve_input == nullptr || r_curve_input == nullptr || g_curve_input == nullptr || b_curve_input == nullptr) {
+		return false;
+	}
+
+	const DecodedInputValue& rgb_curve_val = decoded_values[rgb_curve_input - schema.inputs.data()];
+	const DecodedInputValue& r_curve_val = decoded_values[r_curve_input - schema.inputs.data()];
+	const DecodedInputValue& g_curve_val = decoded_values[g_curve_input - schema.inputs.data()];
+	const DecodedInputValue& b_curve_val = decoded_values[b_curve_input - schema.inputs.data()];
+
+	CurveEvaluator rgb_curve(rgb_curve_val.curve_points, rgb_curve_val.curve_interp);
+	CurveEvaluator r_curve(r_curve_val.curve_points, r_curve_val.curve_interp);
+	CurveEvaluator g_curve(g_curve_val.curve_points, g_curve_val.curve_interp);
+	CurveEvaluator b_curve(b_curve_val.curve_points, b_curve_val.curve_interp);
+
+	for (OutputCurve* const out_curve : { &out_r_curve, &out_g_curve, &out_b_curve }) {
+		out_curve->control_points.clear();
+		out_curve->enum_curve_interp = 0;
+		out_curve->samples.clear();
+		out_curve->samples.reserve(CURVE_TABLE_SIZE);
+	}
+
+	for (size_t i = 0; i < CURVE_TABLE_SIZE; i++) {
+		const float x = static_cast<float>(i) / (CURVE_TABLE_SIZE - 1.0f);
+		out_r_curve.samples.push_back(rgb_curve.eval(r_curve.eval(x)));
+		out_g_curve.samples.push_back(rgb_curve.eval(g_curve.eval(x)));
+		out_b_curve.samples.push_back(rgb_curve.eval(b_curve.eval(x)));
+	}
+
+	return true;
+}
+
+// Headless version of deserialize_node, decoded_values is filled with the value of each of the schema's inputs
+// Returns nullptr if the node's type is unknown
+static const CyclesShaderEditor::NodeTypeSchema* decode_node_inputs(const NodeHeader& header, ParamReader& params, std::vector<DecodedInputValue>& decoded_values)
+{
+	using namespace CyclesShaderEditor;
+
+	const NodeTypeInfo* const type_info = find_node_type_info(header.type_code);
+	if (type_info == nullptr) {
+		// Unknown type
+		return nullptr;
+	}
+
+	const NodeTypeSchema* const schema = get_node_type_schema(type_info->type);
+	if (schema == nullptr) {
+		return nullptr;
+	}
+
+	// Start every input at its default value
+	decoded_values.resize(schema->inputs.size());
+	for (size_t i = 0; i < schema->inputs.size(); i++) {
+		const NodeInputSchema& input = schema->inputs[i];
+		DecodedInputValue& decoded = decoded_values[i];
+		for (int j = 0; j < 3; j++) {
+			decoded.float_values[j] = input.float_default[j];
+		}
+		decoded.int_value = input.int_default;
+		decoded.bool_value = input.bool_default;
+		decoded.string_value = &input.string_default;
+		decoded.curve_points = input.curve_default_points;
+		decoded.curve_interp = input.curve_default_interp;
+	}
+
+	StringSlice param_name;
+	while (params.next_param(param_name)) {
+		const NodeInputSchema* const input = schema->get_input_by_internal_name(param_name);
+		if (input == nullptr || input->has_value == false) {
+			continue;
+		}
+
+		const ParamValue* const value = params.read_value(input->socket_type);
+		if (value != nullptr) {
+			deserialize_param_value(*input, decoded_values[input - schema->inputs.data()], *value);
+		}
+	}
+
+	return schema;
+}
+
+// Fills in the per-type maps of output from a decoded node
+static void fill_output_param_maps(const CyclesShaderEditor::NodeTypeSchema& schema, const std::vector<DecodedInputValue>& decoded_values, CyclesShaderEditor::OutputNode& output)
+{
+	using namespace CyclesShaderEditor;
+
+	for (size_t i = 0; i < schema.inputs.size(); i++) {
+		const NodeInputSchema& input = schema.inputs[i];
+		const DecodedInputValue& decoded = decoded_values[i];
+		if (input.has_value == false) {
+			continue;
+		}
+
+		switch (input.socket_type) {
+		case SocketType::Float:
+			output.float_values[input.internal_name] = decoded.float_values[0];
+			break;
+		case SocketType::Color:
+		case SocketType::Vector:
+			output.float3_values[input.internal_name] = Float3(decoded.float_values[0], decoded.float_values[1], decoded.float_values[2]);
+			break;
+		case SocketType::StringEnum:
+			output.string_values[input.internal_name] = *decoded.string_value;
+			break;
+		case SocketType::Int:
+			output.int_values[input.internal_name] = decoded.int_value;
+			break;
+		case SocketType::Boolean:
+			output.bool_values[input.internal_name] = decoded.bool_value;
+			break;
+		case SocketType::Curve:
+			fill_output_curve(decoded.curve_points, decoded.curve_interp, output.curve_values[input.internal_name]);
+			break;
+		default:
+			break;
+		}
+	}
+
+	if (schema.type == CyclesNodeType::RGBCurves) {
+		OutputCurve out_r_curve;
+		OutputCurve out_g_curve;
+		OutputCurve out_b_curve;
+		if (make_rgb_curves_final_output(schema, decoded_values, out_r_curve, out_g_curve, out_b_curve)) {
+			output.curve_values["final_r_curve"] = std::move(out_r_curve);
+			output.curve_values["final_g_curve"] = std::move(out_g_curve);
+			output.curve_values["final_b_curve"] = std::move(out_b_curve);
+		}
+	}
+}
+
+// Flat equivalent of fill_output_param_maps
+static void fill_output_params(const CyclesShaderEditor::NodeTypeSchema& schema, const std::vector<DecodedInputValue>& decoded_values, CyclesShaderEditor::OutputParams& output)
+{
+	using namespace CyclesShaderEditor;
+
+	output.params.reserve(schema.inputs.size() + 3);
+	for (size_t i = 0; i < schema.inputs.size(); i++) {
+		const NodeInputSchema& input = schema.inputs[i];
+		const DecodedInputValue& decoded = decoded_values[i];
+		if (input.has_value == false) {
+			continue;
+		}
+
+		switch (input.socket_type) {
+		case SocketType::Float:
+			output.set_float(input.param_id, decoded.float_values[0]);
+			break;
+		case SocketType::Color:
+		case SocketType::Vector:
+			output.set_float3(input.param_id, Float3(decoded.float_values[0], decoded.float_values[1], decoded.float_values[2]));
+			break;
+		case SocketType::StringEnum:
+			output.set_string(input.param_id, *decoded.string_value);
+			break;
+		case SocketType::Int:
+			output.set_int(input.param_id, decoded.int_value);
+			break;
+		case SocketType::Boolean:
+			output.set_bool(input.param_id, decoded.bool_value);
+			break;
+		case SocketType::Curve:
+		{
+			OutputCurve out_curve;
+			fill_output_curve(decoded.curve_points, decoded.curve_interp, out_curve);
+			output.set_curve(input.param_id, std::move(out_curve));
+			break;
+		}
+		default:
+			break;
+		}
+	}
+
+	if (schema.type == CyclesNodeType::RGBCurves) {
+		static const OutputParamId final_r_curve_id = get_output_param_id("final_r_curve");
+		static const OutputParamId final_g_curve_id = get_output_param_id("final_g_curve");
+		static const OutputParamId final_b_curve_id = get_output_param_id("final_b_curve");
+		OutputCurve out_r_curve;
+		OutputCurve out_g_curve;
+		OutputCurve out_b_curve;
+		if (make_rgb_curves_final_output(schema, decoded_values, out_r_curve, out_g_curve, out_b_curve)) {
+			output.set_curve(final_r_curve_id, std::move(out_r_curve));
+			output.set_curve(final_g_curve_id, std::move(out_g_curve));
+			output.set_curve(final_b_curve_id, std::move(out_b_curve));
+		}
+	}
+}
+
+// Headless version of deserialize_node followed by EditorNode::update_output_node
+// Fills in output with the same values an EditorNode would produce, in the given param form
+static const CyclesShaderEditor::NodeTypeSchema* deserialize_output_node(const NodeHeader& header, ParamReader& params, std::vector<DecodedInputValue>& decoded_values, CyclesShaderEditor::OutputParamLayout layout, CyclesShaderEditor::OutputNode& output)
+{
+	using namespace CyclesShaderEditor;
+
+	const NodeTypeSchema* const schema = decode_node_inputs(header, params, decoded_values);
+	if (schema == nullptr) {
+		return nullptr;
+	}
+
+	output.type = schema->type;
+	output.world_x = floor(header.x_position);
+	output.world_y = floor(header.y_position);
+
+	if (schema->type == CyclesNodeType::MaterialOutput) {
+		output.name = std::string("output");
+	}
+
+	if (layout == OutputParamLayout::Flat) {
+		fill_output_params(*schema, decoded_values, output.params);
+	}
+	else {
+		fill_output_param_maps(*schema, decoded_values, output);
+	}
+
+	return schema;
+}
+
+void CyclesShaderEditor::deserialize_output_lists(const std::string& graph, std::vector<OutputNode>& out_node_list, std::vector<OutputConnection>& out_connection_list, OutputParamLayout layout)
+{
+	deserialize_output_lists(StringSlice(graph), out_node_list, out_connection_list, layout);
+}
+
+void CyclesShaderEditor::deserialize_output_lists(StringSlice graph, std::vector<OutputNode>& out_node_list, std::vector<OutputConnection>& out_connection_list, OutputParamLayout layout)
+{
+	MonotonicArena scratch;
+	deserialize_output_lists(graph, out_node_list, out_connection_list, layout, scratch);
+}
+
+// Shared by the in-memory and streamed versions of deserialize_output_lists, Graph is a StringSlice or GraphInputStream
+template <typename Graph>
+static void decode_output_lists(
+	Graph& graph,
+	std::vector<CyclesShaderEditor::OutputNode>& out_node_list,
+	std::vector<CyclesShaderEditor::OutputConnection>& out_connection_list,
+	CyclesShaderEditor::OutputParamLayout layout,
+	CyclesShaderEditor::MonotonicArena& scratch)
+{
+	using namespace CyclesShaderEditor;
+
+	const size_t first_node = out_node_list.size();
+	const size_t first_connection = out_connection_list.size();
+
+	// Index into out_node_list and schema of each node, later nodes replace earlier ones with the same name
+	ArenaMap<StringSlice, std::pair<size_t, const NodeTypeSchema*>> nodes_by_name(scratch);
+	std::vector<DecodedInputValue> decoded_values;
+	ArenaVector<ConnectionEnds> connection_ends(scratch);
+
+	const auto node_func = [&](const NodeHeader& header, ParamReader& params) {
+		OutputNode this_out_node;
+		const NodeTypeSchema* const schema = deserialize_output_node(header, params, decoded_values, layout, this_out_node);
+		if (schema == nullptr) {
+			return;
+		}
+		nodes_by_name[header.name] = std::make_pair(out_node_list.size(), schema);
+		out_node_list.push_back(std::move(this_out_node));
+	};
+
+	const auto connection_func = [&](StringSlice source_node, StringSlice source_socket, StringSlice dest_node, StringSlice dest_socket) {
+		ArenaMap<StringSlice, std::pair<size_t, const NodeTypeSchema*>>::iterator source_iter = nodes_by_name.find(source_node);
+		ArenaMap<StringSlice, std::pair<size_t, const NodeTypeSchema*>>::iterator dest_iter = nodes_by_name.find(dest_node);
+		if (source_iter == nodes_by_name.end() || dest_iter == nodes_by_name.end()) {
+			return;
+		}
+
+		if (!source_iter->second.second->has_output_display_name(source_socket) || !dest_iter->second.second->has_input_display_name(dest_socket)) {
+			return;
+		}
+
+		ConnectionEnds ends;
+		ends.source_node = source_iter->second.first - first_node;
+		ends.dest_node = dest_iter->second.first - first_node;
+		connection_ends.push_back(ends);
+
+		OutputConnection this_out_connection;
+		this_out_connection.source_socket = source_socket.to_string();
+		this_out_connection.dest_socket = dest_socket.to_string();
+		out_connection_list.push_back(this_out_connection);
+	};
+
+	walk_graph(graph, node_func, connection_func);
+
+	// Names are filled in here
+	canonicalize_output_lists(out_node_list, first_node, out_connection_list, first_connection, connection_ends, scratch);
+}
+
+void CyclesShaderEditor::deserialize_output_lists(StringSlice graph, std::vector<OutputNode>& out_node_list, std::vector<OutputConnection>& out_connection_list, OutputParamLayout layout, MonotonicArena& scratch)
+{
+	decode_output_lists(graph, out_node_list, out_connection_list, layout, scratch);
+}
+
+void CyclesShaderEditor::deserialize_output_lists(GraphInputStream& graph, std::vector<OutputNode>& out_node_list, std::vector<OutputConnection>& out_connection_list, OutputParamLayout layout)
+{
+	MonotonicArena scratch;
+	decode_output_lists(graph, out_node_list, out_connection_list, layout, scratch);
+}
+
+// Shared by the in-memory and streamed versions of deserialize_to_visitor
+template <typename Graph>
+static bool decode_to_visitor(Graph& graph, CyclesShaderEditor::GraphVisitor& visitor)
+{
+	using namespace CyclesShaderEditor;
+
+	// Only what is needed to check connections is kept, everything else goes straight to the visitor
+	MonotonicArena scratch;
+	ArenaMap<StringSlice, const NodeTypeSchema*> schemas_by_name(scratch);
+	std::vector<DecodedInputValue> decoded_values;
+	OutputCurve curve;
+	OutputCurve final_g_curve;
+	OutputCurve final_b_curve;
+
+	const auto node_func = [&](const NodeHeader& header, ParamReader& params) {
+		const NodeTypeSchema* const schema = decode_node_inputs(header, params, decoded_values);
+		if (schema == nullptr) {
+			return;
+		}
+		schemas_by_name[header.name] = schema;
+
+		visitor.on_node_begin(schema->type, header.name, floor(header.x_position), floor(header.y_position));
+		for (size_t i = 0; i < schema->inputs.size(); i++) {
+			const NodeInputSchema& input = schema->inputs[i];
+			const DecodedInputValue& decoded = decoded_values[i];
+			if (input.has_value == false) {
+				continue;
+			}
+
+			const StringSlice param_name(input.internal_name);
+			switch (input.socket_type) {
+			case SocketType::Float:
+				visitor.on_float(param_name, decoded.float_values[0]);
+				break;
+			case SocketType::Color:
+			case SocketType::Vector:
+				visitor.on_float3(param_name, Float3(decoded.float_values[0], decoded.float_values[1], decoded.float_values[2]));
+				break;
+			case SocketType::StringEnum:
+				visitor.on_string(param_name, StringSlice(*decoded.string_value));
+				break;
+			case SocketType::Int:
+				visitor.on_int(param_name, decoded.int_value);
+				break;
+			case SocketType::Boolean:
+				visitor.on_bool(param_name, decoded.bool_value);
+				break;
+			case SocketType::Curve:
+				fill_output_curve(decoded.curve_points, decoded.curve_interp, curve);
+				visitor.on_curve(param_name, curve);
+				break;
+			default:
+				break;
+			}
+		}
+		if (schema->type == CyclesNodeType::RGBCurves && make_rgb_curves_final_output(*schema, decoded_values, curve, final_g_curve, final_b_curve)) {
+			visitor.on_curve(StringSlice("final_r_curve", 13), curve);
+			visitor.on_curve(StringSlice("final_g_curve", 13), final_g_curve);
+			visitor.on_curve(StringSlice("final_b_curve", 13), final_b_curve);
+		}
+		visitor.on_node_end();
+	};
+
+	const auto connection_func = [&](StringSlice source_node, StringSlice source_socket, StringSlice dest_node, StringSlice dest_socket) {
+		ArenaMap<StringSlice, const NodeTypeSchema*>::const_iterator source_iter = schemas_by_name.find(source_node);
+		ArenaMap<StringSlice, const NodeTypeSchema*>::const_iterator dest_iter = schemas_by_name.find(dest_node);
+		if (source_iter == schemas_by_name.end() || dest_iter == schemas_by_name.end()) {
+			return;
+		}
+		if (!source_iter->second->has_output_display_name(source_socket) || !dest_iter->second->has_input_display_name(dest_socket)) {
+			return;
+		}
+		visitor.on_connection(source_node, source_socket, dest_node, dest_socket);
+	};
+
+	return walk_graph(graph, node_func, connection_func);
+}
+
+bool CyclesShaderEditor::deserialize_to_visitor(StringSlice graph, GraphVisitor& visitor)
+{
+	return decode_to_visitor(graph, visitor);
+}
+
+bool CyclesShaderEditor::deserialize_to_visitor(GraphInputStream& graph, GraphVisitor& visitor)
+{
+	return decode_to_visitor(graph, visitor);
 }
\ No newline at end of file
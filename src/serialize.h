@@ -2,8 +2,10 @@
 
 #include <list>
 #include <string>
+#include <unordered_map>
 #include <vector>
 
+#include "graph_hash.h"
 #include "node_base.h"
 
 
@@ -13,10 +15,225 @@ namespace CyclesShaderEditor {
 	struct OutputNode;
 
 	class EditorNode;
+	class GraphInputStream;
+	struct GraphPatch;
+	class GraphVisitor;
+	class MonotonicArena;
 
+	// Output is ordered and named from the graph's content alone, the same graph always gives the same lists
 	void generate_output_lists(std::list<EditorNode*>& node_list, std::list<NodeConnection>& connection_list, std::vector<OutputNode>& out_node_list, std::vector<OutputConnection>& out_connection_list);
+	// Puts output lists from anywhere, such as a decoded and patched graph, in the order and naming generate_output_lists
+	// gives the same graph, connections between nodes that are not in the list are dropped
+	// Every node is renamed, the names the lists came with are only used to match connections to their nodes
+	void canonicalize_output_lists(std::vector<OutputNode>& nodes, std::vector<OutputConnection>& connections);
 
-	std::string serialize_graph(std::vector<OutputNode>& nodes, std::vector<OutputConnection>& connections);
-	void deserialize_graph(std::string graph, std::list<EditorNode*>& nodes, std::list<NodeConnection>& connections);
+	// Keeps each node's encoded text between calls so only nodes that changed since the last call are encoded again
+	// A node is encoded again when its output_changed flag is set or it has moved, the flag is cleared here
+	// The canonical order, the names it gives and the encoded graph are kept too, only the nodes that changed are sorted
+	// back into the order and only their entries, and those of nodes whose name changed, are written into the text again
+	class SerializedGraphCache {
+	public:
+		// Same result as generate_output_lists followed by serialize_graph in the text format
+		std::string serialize(const std::list<EditorNode*>& nodes, const std::list<NodeConnection>& connections);
+		// Replaces the contents of out, working lists are kept in the cache
+		// Once out and the cache have grown to fit the graph, serializing a graph whose nodes have not changed allocates nothing
+		void serialize(const std::list<EditorNode*>& nodes, const std::list<NodeConnection>& connections, std::string& out);
+		void clear();
+
+		// Number of nodes the last call to serialize had to encode
+		size_t get_last_encoded_node_count() const;
+
+		// Structural hash of the graph passed to the last call to serialize, see CyclesNodeGraph::get_structural_hash
+		// Each node's content hash is kept with its encoded text, so only changed nodes are hashed again
+		// Each node's hash with everything feeding into it is kept as well, see hash_graph_node, so only nodes whose content
+		// or inputs changed and the nodes downstream of them are worked out again
+		unsigned long long get_last_graph_hash() const;
+
+		// Node given the name by the last call to serialize, nullptr if there is none
+		// Only valid until a node is deleted or the graph is serialized again
+		EditorNode* find_node(StringSlice name) const;
+		// Name the last call to serialize gave the node, empty if the node was not in that graph
+		std::string get_node_name(const EditorNode* node) const;
+
+		// Positions in the lists passed to the last call to serialize, so nodes and connections can be erased without
+		// searching the lists, see apply_graph_patch
+		// Only valid until the lists are changed or serialized again
+		// Returns false if the node was not in the list
+		bool find_list_position(const EditorNode* node, std::list<EditorNode*>::const_iterator& position) const;
+		// Appends every connection from source to dest
+		void find_connections(const NodeSocket* source, const NodeSocket* dest, std::vector<std::list<NodeConnection>::const_iterator>& positions) const;
+		// Appends every connection to or from the node, a connection can be given more than once
+		void find_connections(const EditorNode* node, std::vector<std::list<NodeConnection>::const_iterator>& positions) const;
+
+		// Patch that takes the graph passed to the last call to serialize back to the graph as it was when changes were last
+		// taken, made from the nodes and connections the cache saw change rather than by comparing the two graphs
+		// Changes are recorded from the first call to serialize after the cache is made or cleared
+		// Nodes are named the way the last call named them, deleted nodes come back under names the editor never gives a node
+		// names_kept is set to whether every node in both graphs has the same name in both
+		void take_changes(GraphPatch& step_back, bool& names_kept);
+		// Starts recording again from the graph passed to the last call to serialize
+		void discard_changes();
+
+	private:
+		struct CachedNode;
+
+		// One connection to a node's inputs
+		struct CachedInput {
+			CachedNode* source;
+			const NodeSocket* source_socket;
+			const NodeSocket* dest_socket;
+			// Place of the connection in cached_connections
+			size_t connection;
+		};
+
+		struct CachedConnection {
+			const NodeSocket* source_socket;
+			const NodeSocket* dest_socket;
+			std::list<NodeConnection>::const_iterator position;
+			// Enough to name the connection once its nodes are gone, ids are 0 if either node is not in the graph
+			const EditorNode* source_node;
+			const EditorNode* dest_node;
+			unsigned long long source_id;
+			unsigned long long dest_id;
+			std::string source_socket_name;
+			std::string dest_socket_name;
+		};
+
+		struct CachedNode {
+			EditorNode* node = nullptr;
+			CyclesNodeType type = CyclesNodeType::Unknown;
+			float world_x = 0.0f;
+			float world_y = 0.0f;
+			// Everything after the node's type and name, the name depends on the other nodes so it is added when the graph is put together
+			std::string body;
+			unsigned long long content_hash = 0;
+			// The node as it was last encoded, params in the flat form
+			OutputNode output;
+			// Never given to another node, a node whose type changes is given a new one as it is the same as a new node to a patch
+			unsigned long long id = 0;
+			// See hash_graph_node, only kept up to date while the graph has no loops
+			unsigned long long structure_hash = 0;
+			// Place in the canonical order, which is also the number in the node's name
+			size_t rank = 0;
+			// Place in the list passed to the last call to serialize, orders nodes that are the same in every way
+			size_t list_index = 0;
+			std::list<EditorNode*>::const_iterator list_position;
+			// Number of the last call to serialize that found the node in the list
+			unsigned int seen = 0;
+
+			// In canonical order once the node's connections are written
+			std::vector<CachedInput> inputs;
+			std::vector<CachedInput> previous_inputs;
+			// Node at the other end of each connection from this node's outputs
+			std::vector<CachedNode*> dependents;
+
+			// Where the node's entry and the connections to its inputs are in the cached text
+			size_t node_text_offset = 0;
+			size_t node_text_length = 0;
+			size_t input_text_offset = 0;
+			size_t input_text_length = 0;
+
+			// Work left for the current call to serialize
+			bool needs_place = false;
+			bool node_text_dirty = false;
+			bool input_text_dirty = false;
+			bool structure_hash_dirty = false;
+			// Inputs whose source still has to be hashed
+			size_t pending_inputs = 0;
+
+			// Changes since they were last taken, the output the node had before is kept in nodes_before
+			bool added_since_taken = false;
+			bool changed_since_taken = false;
+		};
+
+		struct RemovedNode {
+			unsigned long long id;
+			OutputNode output;
+		};
+
+		// Works out last_graph_hash once the order and connections are up to date
+		void update_graph_hash();
+
+		// Number of each call to serialize, nodes whose seen is behind it after the list is read have been deleted
+		unsigned int serialize_count = 0;
+		std::unordered_map<const EditorNode*, CachedNode> cached_nodes;
+		// Every node in canonical order
+		std::vector<CachedNode*> node_order;
+		// First node named "output", nullptr if there is none
+		CachedNode* output_node = nullptr;
+		// Each connection in the list passed to the last call, to tell whether the list has changed since
+		std::vector<CachedConnection> cached_connections;
+
+		// The graph as the last call wrote it, entries that have not changed are copied from it into the next one
+		std::string text;
+		std::string next_text;
+
+		// Working lists, kept so their memory is reused
+		std::vector<CachedNode*> placed_nodes;
+		std::vector<CachedNode*> renamed_nodes;
+		std::vector<CachedNode*> merged_order;
+		std::string encoded_body;
+
+		// Nodes whose structure hash has to be worked out again
+		std::vector<CachedNode*> hashed_nodes;
+		std::vector<CachedNode*> ready_nodes;
+		// While the graph has a loop the hash is worked out from the whole graph with these
+		bool graph_has_loop = false;
+		std::vector<unsigned long long> content_hashes;
+		std::vector<GraphHashEdge> hash_edges;
+		GraphHashScratch hash_scratch;
+		size_t last_encoded_node_count = 0;
+		unsigned long long last_graph_hash = 0;
+
+		// Changes since they were last taken, see take_changes
+		bool changes_started = false;
+		unsigned long long next_node_id = 0;
+		// Every node that has been added or changed, a node can be in the list more than once
+		std::vector<const EditorNode*> changed_nodes;
+		// How each changed node looked before, by id
+		std::unordered_map<unsigned long long, OutputNode> nodes_before;
+		// Nodes that have been deleted or changed type
+		std::vector<RemovedNode> removed_nodes;
+		// Set once a node that was there before has been given another name
+		bool names_changed_since_taken = false;
+		// The connections before, only kept once they have changed
+		bool connections_changed_since_taken = false;
+		std::vector<CachedConnection> connections_before;
+	};
+
+	// Applies a patch made against the graph as the cache last serialized it, such as one from diff_graphs
+	// Nodes are looked up with SerializedGraphCache::find_node, so the graph must not have changed since that call
+	// Nodes and connections are found and erased through the cache's positions, so this costs as much as the patch rather than the graph
+	// Added nodes and connections are created the same way deserialize_graph creates them, removed nodes are deleted
+	// Returns false and leaves the graph untouched if something the patch refers to can not be found
+	bool apply_graph_patch(std::list<EditorNode*>& nodes, std::list<NodeConnection>& connections, const SerializedGraphCache& names, const GraphPatch& patch);
+	// Also gives the nodes created for the patch's added_nodes, in the same order, and the nodes that were deleted
+	// Deleted nodes are only given so anything still pointing at them can let go, they must not be used
+	bool apply_graph_patch(std::list<EditorNode*>& nodes, std::list<NodeConnection>& connections, const SerializedGraphCache& names, const GraphPatch& patch, std::vector<EditorNode*>& added_nodes, std::vector<const EditorNode*>& removed_nodes);
+
+	std::string serialize_graph(std::vector<OutputNode>& nodes, std::vector<OutputConnection>& connections, SerializedGraphFormat format = SerializedGraphFormat::Text);
+	std::string serialize_graph_binary(std::vector<OutputNode>& nodes, std::vector<OutputConnection>& connections);
+	// Append the encoded graph to out rather than returning a new string
+	// The text format writes straight into out, so a buffer reused between calls stops allocating once it has grown to fit
+	void serialize_graph(const std::vector<OutputNode>& nodes, const std::vector<OutputConnection>& connections, std::string& out, SerializedGraphFormat format = SerializedGraphFormat::Text);
+	void serialize_graph_binary(const std::vector<OutputNode>& nodes, const std::vector<OutputConnection>& connections, std::string& out);
+	void deserialize_graph(const std::string& graph, std::list<EditorNode*>& nodes, std::list<NodeConnection>& connections);
+
+	// Both decoders accept text and binary graphs, the format is detected from the header
+	// Decodes a graph straight into output lists without creating any EditorNodes
+	// Produces the same result as deserialize_graph followed by generate_output_lists
+	// That includes the naming, nodes are renamed after their place in the canonical order and the names in the encoded
+	// graph are not kept, so a graph that was not written by this editor can come back with different names
+	// Params are put in the maps unless another layout is asked for
+	void deserialize_output_lists(const std::string& graph, std::vector<OutputNode>& out_node_list, std::vector<OutputConnection>& out_connection_list, OutputParamLayout layout = OutputParamLayout::Maps);
+	void deserialize_output_lists(StringSlice graph, std::vector<OutputNode>& out_node_list, std::vector<OutputConnection>& out_connection_list, OutputParamLayout layout = OutputParamLayout::Maps);
+	// Lookup tables and other temporaries are taken from scratch, which can be reset and reused for the next graph
+	void deserialize_output_lists(StringSlice graph, std::vector<OutputNode>& out_node_list, std::vector<OutputConnection>& out_connection_list, OutputParamLayout layout, MonotonicArena& scratch);
+	// Reads the graph a chunk at a time, see GraphInputStream
+	void deserialize_output_lists(GraphInputStream& graph, std::vector<OutputNode>& out_node_list, std::vector<OutputConnection>& out_connection_list, OutputParamLayout layout = OutputParamLayout::Maps);
+
+	// Hands each node, param and connection to the visitor as it is read, see decode_graph
+	bool deserialize_to_visitor(StringSlice graph, GraphVisitor& visitor);
+	bool deserialize_to_visitor(GraphInputStream& graph, GraphVisitor& visitor);
 
 }
\ No newline at end of file
@@ -1,6 +1,7 @@
 #include "sockets.h"
 
 #include "curve.h"
+#include "util_arena.h"
 
 #include <algorithm>
 #include <cassert>
@@ -13,6 +14,16 @@ static bool point2_x_lt(CyclesShaderEditor::Point2 a, CyclesShaderEditor::Point2
 	return a.get_pos_x() < b.get_pos_x();
 }
 
+void* CyclesShaderEditor::SocketValue::operator new(const size_t size)
+{
+	return allocate_node_object(size);
+}
+
+void CyclesShaderEditor::SocketValue::operator delete(void* const ptr)
+{
+	free_node_object(ptr);
+}
+
 CyclesShaderEditor::IntSocketValue::IntSocketValue(int default_val, int min, int max)
 {
 	this->default_val = default_val;
@@ -40,6 +51,16 @@ void CyclesShaderEditor::IntSocketValue::set_value(int value_in)
 	}
 }
 
+int CyclesShaderEditor::IntSocketValue::get_min()
+{
+	return min;
+}
+
+int CyclesShaderEditor::IntSocketValue::get_max()
+{
+	return max;
+}
+
 CyclesShaderEditor::FloatSocketValue::FloatSocketValue(float default_val, float min, float max)
 {
 	this->default_val = default_val;
@@ -67,6 +88,16 @@ void CyclesShaderEditor::FloatSocketValue::set_value(float value_in)
 	}
 }
 
+float CyclesShaderEditor::FloatSocketValue::get_min()
+{
+	return min;
+}
+
+float CyclesShaderEditor::FloatSocketValue::get_max()
+{
+	return max;
+}
+
 CyclesShaderEditor::Float3SocketValue::Float3SocketValue(
 	float default_x, float min_x, float max_x,
 	float default_y, float min_y, float max_y,
@@ -286,6 +317,16 @@ CyclesShaderEditor::NodeSocket::~NodeSocket()
 	}
 }
 
+void* CyclesShaderEditor::NodeSocket::operator new(const size_t size)
+{
+	return allocate_node_object(size);
+}
+
+void CyclesShaderEditor::NodeSocket::operator delete(void* const ptr)
+{
+	free_node_object(ptr);
+}
+
 void CyclesShaderEditor::NodeSocket::set_float_val(float float_in)
 {
 	if (socket_type != SocketType::Float) {
@@ -43,6 +43,10 @@ namespace CyclesShaderEditor {
 	class SocketValue {
 	public:
 		virtual ~SocketValue() {}
+
+		// Taken from the active NodeArenaScope if there is one, see util_arena.h
+		static void* operator new(size_t size);
+		static void operator delete(void* ptr);
 	};
 
 	class IntSocketValue : public SocketValue {
@@ -52,6 +56,9 @@ namespace CyclesShaderEditor {
 		int get_value();
 		void set_value(int value_in);
 
+		int get_min();
+		int get_max();
+
 	private:
 		int value;
 
@@ -67,6 +74,9 @@ namespace CyclesShaderEditor {
 		float get_value();
 		void set_value(float value_in);
 
+		float get_min();
+		float get_max();
+
 	private:
 		float value;
 
@@ -151,6 +161,10 @@ namespace CyclesShaderEditor {
 		NodeSocket(EditorNode* parent, SocketInOut socket_in_out, SocketType socket_type, std::string display_name, std::string internal_name);
 		~NodeSocket();
 
+		// Taken from the active NodeArenaScope if there is one, see util_arena.h
+		static void* operator new(size_t size);
+		static void operator delete(void* ptr);
+
 		void set_float_val(float float_in);
 		void set_float3_val(float x_in, float y_in, float z_in);
 		void set_string_val(StringEnumPair string_in);
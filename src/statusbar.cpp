@@ -31,6 +31,13 @@ void CyclesShaderEditor::NodeEditorStatusBar::draw(NVGcontext* draw_context, flo
 	nvgFontBlur(draw_context, 0.0f);
 	nvgFillColor(draw_context, nvgRGBA(0, 0, 0, 255));
 	nvgText(draw_context, width - 4.0f, get_status_bar_height() / 2.0f, zoom_text.c_str(), NULL);
+
+	// Timing text
+	if (timing_text.empty() == false) {
+		nvgTextAlign(draw_context, NVG_ALIGN_CENTER | NVG_ALIGN_MIDDLE);
+		nvgFillColor(draw_context, nvgRGBA(40, 40, 120, 255));
+		nvgText(draw_context, width / 2.0f, get_status_bar_height() / 2.0f, timing_text.c_str(), NULL);
+	}
 }
 
 void CyclesShaderEditor::NodeEditorStatusBar::set_status_text(std::string text)
@@ -41,4 +48,9 @@ void CyclesShaderEditor::NodeEditorStatusBar::set_status_text(std::string text)
 void CyclesShaderEditor::NodeEditorStatusBar::set_zoom_text(std::string text)
 {
 	zoom_text = text;
+}
+
+void CyclesShaderEditor::NodeEditorStatusBar::set_timing_text(std::string text)
+{
+	timing_text = text;
 }
\ No newline at end of file
@@ -17,10 +17,13 @@ namespace CyclesShaderEditor {
 
 		void set_status_text(std::string text);
 		void set_zoom_text(std::string text);
+		// Frame timing overlay, drawn in the middle of the bar when not empty
+		void set_timing_text(std::string text);
 
 	private:
 		std::string status_text;
 		std::string zoom_text;
+		std::string timing_text;
 	};
 
 }
\ No newline at end of file
@@ -125,6 +125,7 @@ void CyclesShaderEditor::ParamEditorSubwindow::handle_key(int key, int /*scancod
 	else if (key == GLFW_KEY_ENTER && action == GLFW_PRESS) {
 		if (selected_input != nullptr) {
 			selected_input->complete_edit();
+			mark_param_changed();
 			request_undo_stack_push = true;
 		}
 	}
@@ -184,9 +185,11 @@ bool CyclesShaderEditor::ParamEditorSubwindow::should_push_undo_state() {
 		result = true;
 	}
 	if (panel_color.should_push_undo_state()) {
+		mark_param_changed();
 		result = true;
 	}
 	if (panel_curve.should_push_undo_state()) {
+		mark_param_changed();
 		result = true;
 	}
 	return result;
@@ -512,6 +515,7 @@ void CyclesShaderEditor::ParamEditorSubwindow::select_input(BaseInputBox* input)
 {
 	if (selected_input != nullptr) {
 		selected_input->complete_edit();
+		mark_param_changed();
 	}
 
 	selected_input = input;
@@ -548,6 +552,8 @@ void CyclesShaderEditor::ParamEditorSubwindow::click_bool_target_under_mouse()
 	for (BoolValueClickTarget& this_target : bool_targets) {
 		if (this_target.is_mouse_over_target(mouse_panel_pos)) {
 			this_target.click();
+			mark_param_changed();
+			request_undo_stack_push = true;
 			return;
 		}
 	}
@@ -558,7 +564,16 @@ void CyclesShaderEditor::ParamEditorSubwindow::click_enum_target_under_mouse()
 	for (StringEnumClickTarget& this_target : enum_targets) {
 		if (this_target.is_mouse_over_target(mouse_panel_pos)) {
 			this_target.click();
+			mark_param_changed();
+			request_undo_stack_push = true;
 			return;
 		}
 	}
 }
+
+void CyclesShaderEditor::ParamEditorSubwindow::mark_param_changed()
+{
+	if (selected_param != nullptr) {
+		selected_param->parent->output_changed = true;
+	}
+}
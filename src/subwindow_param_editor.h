@@ -39,6 +39,8 @@ namespace CyclesShaderEditor {
 		virtual void draw_content(NVGcontext* draw_context) override;
 
 		void select_input(BaseInputBox* input);
+		// Values are written straight into the socket, this has the node's output encoded again
+		void mark_param_changed();
 
 		bool is_bool_target_under_mouse();
 		bool is_enum_target_under_mouse();
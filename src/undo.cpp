@@ -1,50 +1,150 @@
 #include "undo.h"
 
-static const int UNDO_LIMIT = 50;
+#include <utility>
 
-void CyclesShaderEditor::UndoStack::push_undo_state(std::string state)
+#include "serialize.h"
+
+CyclesShaderEditor::UndoStack::UndoStack(const size_t memory_budget) :
+	memory_budget(memory_budget)
 {
-	redo_state.clear();
-	undo_state.push_front(state);
-	while (undo_state.size() > UNDO_LIMIT) {
-		undo_state.pop_back();
-	}
+
 }
 
-std::string CyclesShaderEditor::UndoStack::pop_undo_state(std::string current_state)
+void CyclesShaderEditor::UndoStack::push_undo_state(SerializedGraphCache& cache, const void* const new_merge_key)
 {
-	if (undo_state.size() == 0) {
-		return current_state;
+	GraphPatch patch;
+	bool names_kept = false;
+	cache.take_changes(patch, names_kept);
+	if (patch.empty()) {
+		return;
 	}
-	redo_state.push_front(current_state);
-	std::string result_state = undo_state.front();
-	undo_state.pop_front();
-	return result_state;
+
+	const std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+	const bool merge = new_merge_key != nullptr && new_merge_key == merge_key && names_kept && !undo_steps.empty() &&
+		now - merge_time < std::chrono::milliseconds(MERGE_INTERVAL_MS);
+
+	GraphPatch merged_patch;
+	if (merge && combine_graph_patches(patch, undo_steps.front().patch, merged_patch)) {
+		// The newest step is replaced by one that goes back past both changes
+		step_bytes -= undo_steps.front().memory_size;
+		undo_steps.pop_front();
+		if (merged_patch.empty()) {
+			// The changes cancelled out, there is no step left to merge into
+			end_merge();
+		}
+		else {
+			push_step(undo_steps, std::move(merged_patch));
+		}
+	}
+	else {
+		for (const UndoStep& step : redo_steps) {
+			step_bytes -= step.memory_size;
+		}
+		redo_steps.clear();
+		push_step(undo_steps, std::move(patch));
+		merge_key = new_merge_key;
+	}
+	merge_time = now;
+	enforce_memory_budget();
 }
 
-std::string CyclesShaderEditor::UndoStack::pop_redo_state(std::string current_state)
+bool CyclesShaderEditor::UndoStack::undo(std::list<EditorNode*>& nodes, std::list<NodeConnection>& connections, SerializedGraphCache& cache, std::string& state, std::vector<const EditorNode*>& removed_nodes)
 {
-	if (redo_state.size() == 0) {
-		return current_state;
-	}
-	undo_state.push_front(current_state);
-	std::string result_state = redo_state.front();
-	redo_state.pop_front();
-	return result_state;
+	return apply_step(nodes, connections, cache, state, removed_nodes, undo_steps, redo_steps);
+}
+
+bool CyclesShaderEditor::UndoStack::redo(std::list<EditorNode*>& nodes, std::list<NodeConnection>& connections, SerializedGraphCache& cache, std::string& state, std::vector<const EditorNode*>& removed_nodes)
+{
+	return apply_step(nodes, connections, cache, state, removed_nodes, redo_steps, undo_steps);
 }
 
 bool CyclesShaderEditor::UndoStack::undo_available()
 {
-	return (undo_state.size() > 0);
+	return (undo_steps.size() > 0);
 }
 
 bool CyclesShaderEditor::UndoStack::redo_available()
 {
-	return (redo_state.size() > 0);
+	return (redo_steps.size() > 0);
 }
 
 void CyclesShaderEditor::UndoStack::clear()
 {
-	undo_state.clear();
-	redo_state.clear();
+	undo_steps.clear();
+	redo_steps.clear();
+	step_bytes = 0;
+	end_merge();
+}
+
+void CyclesShaderEditor::UndoStack::set_memory_budget(const size_t bytes)
+{
+	memory_budget = bytes;
+	enforce_memory_budget();
+}
+
+CyclesShaderEditor::UndoStackStats CyclesShaderEditor::UndoStack::get_stats() const
+{
+	UndoStackStats stats;
+	stats.undo_steps = undo_steps.size();
+	stats.redo_steps = redo_steps.size();
+	stats.step_bytes = step_bytes;
+	stats.memory_budget = memory_budget;
+	return stats;
+}
+
+bool CyclesShaderEditor::UndoStack::apply_step(std::list<EditorNode*>& nodes, std::list<NodeConnection>& connections, SerializedGraphCache& cache, std::string& state, std::vector<const EditorNode*>& removed_nodes, std::list<UndoStep>& from_steps, std::list<UndoStep>& to_steps)
+{
+	removed_nodes.clear();
+	cache.serialize(nodes, connections, state);
+
+	// Changes the stack has not seen yet are recorded first, this clears the redo steps
+	push_undo_state(cache);
+	if (from_steps.empty()) {
+		return false;
+	}
+	end_merge();
+
+	const GraphPatch patch = std::move(from_steps.front().patch);
+	step_bytes -= from_steps.front().memory_size;
+	from_steps.pop_front();
+
+	std::vector<EditorNode*> added_nodes;
+	if (apply_graph_patch(nodes, connections, cache, patch, added_nodes, removed_nodes) == false) {
+		// The history does not match the graph, none of it can be used
+		clear();
+		return false;
+	}
+
+	// The step back is what the cache saw change, with every node named the way the editor names it now
+	cache.serialize(nodes, connections, state);
+	GraphPatch step_back;
+	bool names_kept = false;
+	cache.take_changes(step_back, names_kept);
+	push_step(to_steps, std::move(step_back));
+	enforce_memory_budget();
+	return true;
+}
+
+void CyclesShaderEditor::UndoStack::push_step(std::list<UndoStep>& steps, GraphPatch patch)
+{
+	UndoStep step;
+	step.patch = std::move(patch);
+	step.memory_size = step.patch.get_memory_size();
+	step_bytes += step.memory_size;
+	steps.push_front(std::move(step));
+}
+
+void CyclesShaderEditor::UndoStack::enforce_memory_budget()
+{
+	// Steps furthest from the current state go first, oldest undo steps before the last redo steps
+	while (step_bytes > memory_budget && undo_steps.size() + redo_steps.size() > 1) {
+		std::list<UndoStep>& steps = undo_steps.empty() ? redo_steps : undo_steps;
+		step_bytes -= steps.back().memory_size;
+		steps.pop_back();
+	}
+}
+
+void CyclesShaderEditor::UndoStack::end_merge()
+{
+	merge_key = nullptr;
 }
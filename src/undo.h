@@ -1,25 +1,84 @@
 #pragma once
 
+#include <chrono>
+#include <cstddef>
 #include <list>
 #include <string>
+#include <vector>
+
+#include "graph_patch.h"
+#include "node_base.h"
+#include "serialize.h"
 
 namespace CyclesShaderEditor {
 
+	// Memory held by an UndoStack
+	struct UndoStackStats {
+		size_t undo_steps = 0;
+		size_t redo_steps = 0;
+		// Bytes held by the stored steps, this is what the budget limits
+		size_t step_bytes = 0;
+		size_t memory_budget = 0;
+	};
+
+	// Each step is stored as a patch from the state after it back to the state before it, rather than a whole serialized graph
+	// The oldest steps are dropped once the steps together need more memory than the budget allows, the newest step
+	// is always kept
+	// Steps are the changes a SerializedGraphCache saw between pushes, so no copy of the graph is kept
 	class UndoStack {
 	public:
-		void push_undo_state(std::string state);
+		static const size_t DEFAULT_MEMORY_BUDGET = 4 * 1024 * 1024;
+
+		UndoStack(size_t memory_budget = DEFAULT_MEMORY_BUDGET);
+
+		// Pushes with the same merge_key less than MERGE_INTERVAL_MS apart are kept as one step, so a run of changes to one
+		// thing, such as a param edited several times in a row, is undone at once
+		static const int MERGE_INTERVAL_MS = 1000;
+
+		// Records the changes cache has seen since the last push as one step, see SerializedGraphCache::take_changes
+		// The graph must have been serialized with cache since it was last changed
+		// Only steps that change nodes and nothing else are merged
+		// merge_key is anything identifying what was changed, nullptr never merges
+		void push_undo_state(SerializedGraphCache& cache, const void* merge_key = nullptr);
 
-		std::string pop_undo_state(std::string current_state);
-		std::string pop_redo_state(std::string current_state);
+		// Both change the graph in place, only the nodes and connections the step touches are changed so every other
+		// EditorNode stays as it is, along with anything pointing at it
+		// cache must be the one the graph's states are serialized with, state is set to the graph after the step
+		// removed_nodes gets the nodes the step deleted, they must not be used
+		// If the graph is not the state the stack is at, the change to it is first recorded as a step of its own
+		// Return false if there was nothing to undo or redo, or the step no longer fits the graph and the history was cleared
+		bool undo(std::list<EditorNode*>& nodes, std::list<NodeConnection>& connections, SerializedGraphCache& cache, std::string& state, std::vector<const EditorNode*>& removed_nodes);
+		bool redo(std::list<EditorNode*>& nodes, std::list<NodeConnection>& connections, SerializedGraphCache& cache, std::string& state, std::vector<const EditorNode*>& removed_nodes);
 
 		bool undo_available();
 		bool redo_available();
 
 		void clear();
 
+		void set_memory_budget(size_t bytes);
+		UndoStackStats get_stats() const;
+
 	private:
-		std::list<std::string> undo_state;
-		std::list<std::string> redo_state;
+		struct UndoStep {
+			GraphPatch patch;
+			size_t memory_size = 0;
+		};
+
+		// Applies the front step of from_steps to the graph and records the step back on to_steps
+		bool apply_step(std::list<EditorNode*>& nodes, std::list<NodeConnection>& connections, SerializedGraphCache& cache, std::string& state, std::vector<const EditorNode*>& removed_nodes, std::list<UndoStep>& from_steps, std::list<UndoStep>& to_steps);
+
+		void push_step(std::list<UndoStep>& steps, GraphPatch patch);
+		void end_merge();
+		void enforce_memory_budget();
+
+		std::list<UndoStep> undo_steps;
+		std::list<UndoStep> redo_steps;
+		size_t step_bytes = 0;
+		size_t memory_budget;
+
+		// Key of the newest undo step while another push can still be merged into it
+		const void* merge_key = nullptr;
+		std::chrono::steady_clock::time_point merge_time;
 	};
 
 }
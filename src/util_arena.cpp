@@ -0,0 +1,216 @@
+#include "util_arena.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <new>
+
+// Each new block is twice the size of the one before it, up to this many times the first block's size
+static const size_t MAX_BLOCK_GROWTH = 64;
+
+// Node objects carry a header in front of them that points back to the block they came from, nullptr for the heap
+// The header is a full max_align_t so the object after it keeps the alignment operator new guarantees
+static const size_t NODE_OBJECT_HEADER_SIZE = alignof(std::max_align_t);
+
+// Objects are small, blocks start small enough that loading a tiny graph does not waste much
+static const size_t NODE_ARENA_FIRST_BLOCK_SIZE = 32 * 1024;
+// Blocks stop growing here, a few nodes left over from a large graph can only keep this much each alive
+static const size_t NODE_ARENA_MAX_BLOCK_SIZE = 256 * 1024;
+
+CyclesShaderEditor::MonotonicArena::MonotonicArena(const size_t first_block_size) :
+	first_block_size(std::max(first_block_size, static_cast<size_t>(256)))
+{
+
+}
+
+CyclesShaderEditor::MonotonicArena::~MonotonicArena()
+{
+	release();
+}
+
+void* CyclesShaderEditor::MonotonicArena::allocate(const size_t size, const size_t alignment)
+{
+	std::uintptr_t address = reinterpret_cast<std::uintptr_t>(current);
+	std::uintptr_t aligned = (address + alignment - 1) & ~static_cast<std::uintptr_t>(alignment - 1);
+	if (current == nullptr || size > static_cast<size_t>(end - current) || aligned - address > static_cast<size_t>(end - current) - size) {
+		next_block(size + alignment);
+		address = reinterpret_cast<std::uintptr_t>(current);
+		aligned = (address + alignment - 1) & ~static_cast<std::uintptr_t>(alignment - 1);
+	}
+
+	char* const result = current + (aligned - address);
+	current = result + size;
+	return result;
+}
+
+void CyclesShaderEditor::MonotonicArena::reset()
+{
+	current_block = 0;
+	if (blocks.empty()) {
+		current = nullptr;
+		end = nullptr;
+	}
+	else {
+		current = blocks[0].data;
+		end = blocks[0].data + blocks[0].size;
+	}
+}
+
+void CyclesShaderEditor::MonotonicArena::release()
+{
+	for (const Block& block : blocks) {
+		::operator delete(block.data);
+	}
+	blocks.clear();
+	reset();
+}
+
+size_t CyclesShaderEditor::MonotonicArena::get_block_count() const
+{
+	return blocks.size();
+}
+
+size_t CyclesShaderEditor::MonotonicArena::get_capacity() const
+{
+	size_t capacity = 0;
+	for (const Block& block : blocks) {
+		capacity += block.size;
+	}
+	return capacity;
+}
+
+void CyclesShaderEditor::MonotonicArena::next_block(const size_t min_size)
+{
+	// Blocks kept from before a reset are used in order, one that is too small for this allocation is skipped
+	const size_t first_candidate = (current == nullptr) ? 0 : current_block + 1;
+	for (size_t i = first_candidate; i < blocks.size(); i++) {
+		if (blocks[i].size >= min_size) {
+			current_block = i;
+			current = blocks[i].data;
+			end = blocks[i].data + blocks[i].size;
+			return;
+		}
+	}
+
+	const size_t growth = static_cast<size_t>(1) << std::min(blocks.size(), static_cast<size_t>(6));
+	const size_t block_size = std::max(first_block_size * std::min(growth, MAX_BLOCK_GROWTH), min_size);
+
+	Block block;
+	block.data = static_cast<char*>(::operator new(block_size));
+	block.size = block_size;
+	current_block = blocks.size();
+	blocks.push_back(block);
+	current = block.data;
+	end = block.data + block.size;
+}
+
+namespace CyclesShaderEditor {
+
+	// Start of each node arena block, counts the objects taken from the block plus one while the arena is still using it
+	struct NodeArenaBlock {
+		std::atomic<size_t> references;
+	};
+
+	// Hands out node objects from the current block, moving on to a new block when it is full
+	class NodeArena {
+	public:
+		~NodeArena();
+
+		// Returns the object's header, which is already pointing at its block
+		char* allocate(size_t size);
+
+	private:
+		NodeArenaBlock* block = nullptr;
+		char* current = nullptr;
+		char* end = nullptr;
+		size_t next_block_size = NODE_ARENA_FIRST_BLOCK_SIZE;
+	};
+
+}
+
+// The block header takes a full object header's worth of space so objects after it stay aligned
+static const size_t NODE_ARENA_BLOCK_HEADER_SIZE = (sizeof(CyclesShaderEditor::NodeArenaBlock) + NODE_OBJECT_HEADER_SIZE - 1) / NODE_OBJECT_HEADER_SIZE * NODE_OBJECT_HEADER_SIZE;
+
+static void release_node_arena_block(CyclesShaderEditor::NodeArenaBlock* const block)
+{
+	if (block->references.fetch_sub(1) == 1) {
+		block->~NodeArenaBlock();
+		::operator delete(block);
+	}
+}
+
+CyclesShaderEditor::NodeArena::~NodeArena()
+{
+	if (block != nullptr) {
+		release_node_arena_block(block);
+	}
+}
+
+char* CyclesShaderEditor::NodeArena::allocate(const size_t size)
+{
+	const size_t padded_size = (size + NODE_OBJECT_HEADER_SIZE - 1) / NODE_OBJECT_HEADER_SIZE * NODE_OBJECT_HEADER_SIZE + NODE_OBJECT_HEADER_SIZE;
+	if (block == nullptr || padded_size > static_cast<size_t>(end - current)) {
+		if (block != nullptr) {
+			release_node_arena_block(block);
+		}
+		const size_t block_size = std::max(next_block_size, NODE_ARENA_BLOCK_HEADER_SIZE + padded_size);
+		next_block_size = std::min(next_block_size * 2, NODE_ARENA_MAX_BLOCK_SIZE);
+
+		char* const data = static_cast<char*>(::operator new(block_size));
+		block = new (data) NodeArenaBlock();
+		block->references.store(1);
+		current = data + NODE_ARENA_BLOCK_HEADER_SIZE;
+		end = data + block_size;
+	}
+
+	char* const header = current;
+	current += padded_size;
+	block->references.fetch_add(1);
+	*reinterpret_cast<NodeArenaBlock**>(header) = block;
+	return header;
+}
+
+static thread_local CyclesShaderEditor::NodeArena* active_node_arena = nullptr;
+
+CyclesShaderEditor::NodeArenaScope::NodeArenaScope() :
+	arena(new NodeArena()),
+	previous_arena(active_node_arena)
+{
+	active_node_arena = arena;
+}
+
+CyclesShaderEditor::NodeArenaScope::~NodeArenaScope()
+{
+	active_node_arena = previous_arena;
+	delete arena;
+}
+
+void* CyclesShaderEditor::allocate_node_object(const size_t size)
+{
+	NodeArena* const arena = active_node_arena;
+	char* header = nullptr;
+	if (arena == nullptr) {
+		header = static_cast<char*>(::operator new(size + NODE_OBJECT_HEADER_SIZE));
+		*reinterpret_cast<NodeArenaBlock**>(header) = nullptr;
+	}
+	else {
+		header = arena->allocate(size);
+	}
+	return header + NODE_OBJECT_HEADER_SIZE;
+}
+
+void CyclesShaderEditor::free_node_object(void* const ptr)
+{
+	if (ptr == nullptr) {
+		return;
+	}
+
+	char* const header = static_cast<char*>(ptr) - NODE_OBJECT_HEADER_SIZE;
+	NodeArenaBlock* const block = *reinterpret_cast<NodeArenaBlock**>(header);
+	if (block == nullptr) {
+		::operator delete(header);
+	}
+	else {
+		release_node_arena_block(block);
+	}
+}
@@ -0,0 +1,128 @@
+#pragma once
+
+#include <cstddef>
+#include <functional>
+#include <map>
+#include <utility>
+#include <vector>
+
+namespace CyclesShaderEditor {
+
+	// Hands out memory by bumping a pointer through large blocks, nothing is given back until the whole arena is reset
+	// Meant for data where thousands of small allocations all end at the same time, such as a decoder's lookup tables
+	// Not thread safe, each thread should use its own arena
+	class MonotonicArena {
+	public:
+		static const size_t DEFAULT_BLOCK_SIZE = 64 * 1024;
+
+		explicit MonotonicArena(size_t first_block_size = DEFAULT_BLOCK_SIZE);
+		~MonotonicArena();
+
+		MonotonicArena(const MonotonicArena&) = delete;
+		MonotonicArena& operator=(const MonotonicArena&) = delete;
+
+		// alignment must be a power of two
+		void* allocate(size_t size, size_t alignment);
+
+		// Everything allocated so far becomes invalid, the blocks are kept so an arena used for one job after another
+		// stops allocating once it has grown to fit the largest job
+		void reset();
+		// Same as reset but the blocks are freed
+		void release();
+
+		size_t get_block_count() const;
+		// Total size of all blocks
+		size_t get_capacity() const;
+
+	private:
+		struct Block {
+			char* data;
+			size_t size;
+		};
+
+		// Moves on to the next kept block that fits, or adds a new block after the current one
+		void next_block(size_t min_size);
+
+		const size_t first_block_size;
+		std::vector<Block> blocks;
+		size_t current_block = 0;
+		char* current = nullptr;
+		char* end = nullptr;
+	};
+
+	// Standard allocator that takes its memory from a MonotonicArena, deallocate does nothing
+	template <typename T>
+	class ArenaAllocator {
+	public:
+		typedef T value_type;
+
+		template <typename U>
+		struct rebind {
+			typedef ArenaAllocator<U> other;
+		};
+
+		ArenaAllocator(MonotonicArena& arena) : arena(&arena) {}
+
+		template <typename U>
+		ArenaAllocator(const ArenaAllocator<U>& other) : arena(other.get_arena()) {}
+
+		T* allocate(size_t count)
+		{
+			return static_cast<T*>(arena->allocate(count * sizeof(T), alignof(T)));
+		}
+
+		void deallocate(T*, size_t) {}
+
+		MonotonicArena* get_arena() const
+		{
+			return arena;
+		}
+
+	private:
+		MonotonicArena* arena;
+	};
+
+	template <typename T, typename U>
+	bool operator==(const ArenaAllocator<T>& a, const ArenaAllocator<U>& b)
+	{
+		return a.get_arena() == b.get_arena();
+	}
+
+	template <typename T, typename U>
+	bool operator!=(const ArenaAllocator<T>& a, const ArenaAllocator<U>& b)
+	{
+		return a.get_arena() != b.get_arena();
+	}
+
+	template <typename T>
+	using ArenaVector = std::vector<T, ArenaAllocator<T>>;
+
+	template <typename K, typename V>
+	using ArenaMap = std::map<K, V, std::less<K>, ArenaAllocator<std::pair<const K, V>>>;
+
+	class NodeArena;
+
+	// EditorNodes, NodeSockets and SocketValues created on this thread while a scope is alive come from one arena
+	// Each of the arena's blocks is freed once the scope has moved past it and the last object taken from it has been
+	// deleted, so deleting most of a loaded graph gives back most of its memory even while a few of its nodes live on
+	// Objects created outside a scope, such as nodes added to the graph after it was loaded, come from the heap
+	// Objects may be deleted from any thread
+	class NodeArenaScope {
+	public:
+		NodeArenaScope();
+		~NodeArenaScope();
+
+		NodeArenaScope(const NodeArenaScope&) = delete;
+		NodeArenaScope& operator=(const NodeArenaScope&) = delete;
+
+	private:
+		NodeArena* arena;
+		NodeArena* previous_arena;
+	};
+
+	// Used by the operator new and delete of the editor's node classes
+	// Memory comes from the thread's active NodeArenaScope, or the heap if there is none
+	void* allocate_node_object(size_t size);
+	void free_node_object(void* ptr);
+
+}
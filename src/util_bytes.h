@@ -0,0 +1,54 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+
+namespace CyclesShaderEditor {
+
+	// Helpers for the editor's binary files, such as material bundles and edit journals
+	// Integers are always stored little-endian so files can be moved between machines
+
+	// 64-bit FNV-1a
+	inline unsigned long long hash_bytes(const char* data, size_t length)
+	{
+		unsigned long long hash = 14695981039346656037ull;
+		for (size_t i = 0; i < length; i++) {
+			hash ^= static_cast<unsigned char>(data[i]);
+			hash *= 1099511628211ull;
+		}
+		return hash;
+	}
+
+	inline void append_u32(std::string& out, unsigned int value)
+	{
+		for (int i = 0; i < 4; i++) {
+			out.push_back(static_cast<char>(value >> (8 * i)));
+		}
+	}
+
+	inline void append_u64(std::string& out, unsigned long long value)
+	{
+		for (int i = 0; i < 8; i++) {
+			out.push_back(static_cast<char>(value >> (8 * i)));
+		}
+	}
+
+	inline unsigned int read_u32(const char* data)
+	{
+		unsigned int result = 0;
+		for (int i = 0; i < 4; i++) {
+			result |= static_cast<unsigned int>(static_cast<unsigned char>(data[i])) << (8 * i);
+		}
+		return result;
+	}
+
+	inline unsigned long long read_u64(const char* data)
+	{
+		unsigned long long result = 0;
+		for (int i = 0; i < 8; i++) {
+			result |= static_cast<unsigned long long>(static_cast<unsigned char>(data[i])) << (8 * i);
+		}
+		return result;
+	}
+
+}
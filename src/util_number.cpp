@@ -0,0 +1,434 @@
+#include "util_number.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <locale>
+#include <sstream>
+
+// Every power of ten up to 1e22 is exactly representable as a double
+static const double POWERS_OF_TEN[] = {
+	1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+	1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22,
+};
+static constexpr int MAX_EXACT_POWER_OF_TEN = 22;
+
+// Integers up to 2^53 are exactly representable as a double
+static constexpr std::uint64_t MAX_EXACT_MANTISSA = 1ull << 53;
+
+// Enough to hold any mantissa that fits in 64 bits
+static constexpr int MAX_MANTISSA_DIGITS = 19;
+
+// A float needs at most 9 significant digits to round trip
+static constexpr int MAX_FLOAT_DIGITS = 9;
+
+static bool is_digit(char c)
+{
+	return c >= '0' && c <= '9';
+}
+
+static bool equals_ignore_case(const char* begin, const char* end, const char* word)
+{
+	const size_t length = end - begin;
+	if (length != strlen(word)) {
+		return false;
+	}
+	for (size_t i = 0; i < length; i++) {
+		char c = begin[i];
+		if (c >= 'A' && c <= 'Z') {
+			c = c - 'A' + 'a';
+		}
+		if (c != word[i]) {
+			return false;
+		}
+	}
+	return true;
+}
+
+// Used for the rare numbers the fast path can not convert with a single rounding
+// The stream is given the classic locale so the global locale never affects the result
+static CyclesShaderEditor::NumberParseResult parse_float_slow(const char* begin, const char* end, float& result)
+{
+	std::istringstream stream(std::string(begin, end));
+	stream.imbue(std::locale::classic());
+
+	float value = 0.0f;
+	stream >> value;
+	if (stream.fail()) {
+		// Out of range values are set to the largest float along with the fail bit
+		if (value == std::numeric_limits<float>::max() || value == -std::numeric_limits<float>::max()) {
+			result = (value > 0.0f) ? std::numeric_limits<float>::infinity() : -std::numeric_limits<float>::infinity();
+			return CyclesShaderEditor::NumberParseResult::OutOfRange;
+		}
+		return CyclesShaderEditor::NumberParseResult::Invalid;
+	}
+
+	result = value;
+	return CyclesShaderEditor::NumberParseResult::Success;
+}
+
+CyclesShaderEditor::NumberParseResult CyclesShaderEditor::parse_float(StringSlice text, float& result)
+{
+	if (text.empty()) {
+		return NumberParseResult::Empty;
+	}
+
+	const char* const begin = text.data();
+	const char* const end = begin + text.size();
+	const char* pos = begin;
+
+	bool negative = false;
+	if (*pos == '-' || *pos == '+') {
+		negative = (*pos == '-');
+		pos++;
+	}
+
+	if (pos != end && is_digit(*pos) == false && *pos != '.') {
+		if (equals_ignore_case(pos, end, "inf") || equals_ignore_case(pos, end, "infinity")) {
+			result = negative ? -std::numeric_limits<float>::infinity() : std::numeric_limits<float>::infinity();
+			return NumberParseResult::Success;
+		}
+		if (equals_ignore_case(pos, end, "nan")) {
+			result = std::numeric_limits<float>::quiet_NaN();
+			return NumberParseResult::Success;
+		}
+		return NumberParseResult::Invalid;
+	}
+
+	// Collect up to MAX_MANTISSA_DIGITS significant digits, the value is mantissa * 10^exponent
+	std::uint64_t mantissa = 0;
+	int mantissa_digits = 0;
+	int exponent = 0;
+	bool any_digits = false;
+	bool truncated = false;
+
+	for (; pos != end && is_digit(*pos); pos++) {
+		any_digits = true;
+		const int digit = *pos - '0';
+		if (mantissa == 0 && digit == 0) {
+			continue;
+		}
+		if (mantissa_digits < MAX_MANTISSA_DIGITS) {
+			mantissa = mantissa * 10 + digit;
+			mantissa_digits++;
+		}
+		else {
+			exponent++;
+			truncated = truncated || (digit != 0);
+		}
+	}
+
+	if (pos != end && *pos == '.') {
+		pos++;
+		for (; pos != end && is_digit(*pos); pos++) {
+			any_digits = true;
+			const int digit = *pos - '0';
+			if (mantissa == 0 && digit == 0) {
+				exponent--;
+				continue;
+			}
+			if (mantissa_digits < MAX_MANTISSA_DIGITS) {
+				mantissa = mantissa * 10 + digit;
+				mantissa_digits++;
+				exponent--;
+			}
+			else {
+				truncated = truncated || (digit != 0);
+			}
+		}
+	}
+
+	if (any_digits == false) {
+		return NumberParseResult::Invalid;
+	}
+
+	if (pos != end && (*pos == 'e' || *pos == 'E')) {
+		pos++;
+		bool negative_exponent = false;
+		if (pos != end && (*pos == '-' || *pos == '+')) {
+			negative_exponent = (*pos == '-');
+			pos++;
+		}
+		if (pos == end || is_digit(*pos) == false) {
+			return NumberParseResult::Invalid;
+		}
+		int written_exponent = 0;
+		for (; pos != end && is_digit(*pos); pos++) {
+			// Anything this large is out of range anyway, stop before the int can overflow
+			if (written_exponent < 100000) {
+				written_exponent = written_exponent * 10 + (*pos - '0');
+			}
+		}
+		exponent += negative_exponent ? -written_exponent : written_exponent;
+	}
+
+	if (pos != end) {
+		return NumberParseResult::Invalid;
+	}
+
+	if (mantissa == 0) {
+		result = negative ? -0.0f : 0.0f;
+		return NumberParseResult::Success;
+	}
+
+	if (truncated || mantissa > MAX_EXACT_MANTISSA || exponent > MAX_EXACT_POWER_OF_TEN || exponent < -MAX_EXACT_POWER_OF_TEN) {
+		return parse_float_slow(begin, end, result);
+	}
+
+	// Both operands are exact so this is a single correctly rounded operation
+	const double exact_double = static_cast<double>(mantissa);
+	const double value = (exponent >= 0) ? exact_double * POWERS_OF_TEN[exponent] : exact_double / POWERS_OF_TEN[-exponent];
+
+	// Rounding the double to a float gives the correctly rounded float unless the double landed exactly halfway between two floats
+	const float rounded = static_cast<float>(value);
+	if (std::isinf(rounded)) {
+		result = negative ? -rounded : rounded;
+		return NumberParseResult::OutOfRange;
+	}
+	if (static_cast<double>(rounded) != value) {
+		const float neighbor = std::nextafter(rounded, (value > rounded) ? std::numeric_limits<float>::infinity() : 0.0f);
+		const double midpoint = (static_cast<double>(rounded) + static_cast<double>(neighbor)) / 2.0;
+		if (value == midpoint) {
+			return parse_float_slow(begin, end, result);
+		}
+	}
+
+	result = negative ? -rounded : rounded;
+	return NumberParseResult::Success;
+}
+
+CyclesShaderEditor::NumberParseResult CyclesShaderEditor::parse_int(StringSlice text, int& result)
+{
+	if (text.empty()) {
+		return NumberParseResult::Empty;
+	}
+
+	const char* pos = text.data();
+	const char* const end = pos + text.size();
+
+	bool negative = false;
+	if (*pos == '-' || *pos == '+') {
+		negative = (*pos == '-');
+		pos++;
+	}
+
+	if (pos == end) {
+		return NumberParseResult::Invalid;
+	}
+
+	// One past the largest magnitude an int can hold
+	const long long limit = static_cast<long long>(std::numeric_limits<int>::max()) + 1;
+	long long magnitude = 0;
+	for (; pos != end; pos++) {
+		if (is_digit(*pos) == false) {
+			return NumberParseResult::Invalid;
+		}
+		if (magnitude <= limit) {
+			magnitude = magnitude * 10 + (*pos - '0');
+		}
+	}
+
+	if (negative) {
+		if (magnitude > limit) {
+			result = std::numeric_limits<int>::min();
+			return NumberParseResult::OutOfRange;
+		}
+		result = static_cast<int>(-magnitude);
+	}
+	else {
+		if (magnitude >= limit) {
+			result = std::numeric_limits<int>::max();
+			return NumberParseResult::OutOfRange;
+		}
+		result = static_cast<int>(magnitude);
+	}
+
+	return NumberParseResult::Success;
+}
+
+static size_t write_unsigned(std::uint64_t value, char* buffer)
+{
+	char digits[20];
+	size_t count = 0;
+	do {
+		digits[count++] = static_cast<char>('0' + value % 10);
+		value /= 10;
+	} while (value != 0);
+
+	for (size_t i = 0; i < count; i++) {
+		buffer[i] = digits[count - 1 - i];
+	}
+	return count;
+}
+
+// Writes digits * 10^(exponent - digit_count + 1) in plain or scientific notation, digits has no trailing zeros
+static size_t write_decimal(std::uint64_t digits, int exponent, char* buffer)
+{
+	char digit_chars[MAX_FLOAT_DIGITS + 1];
+	const int digit_count = static_cast<int>(write_unsigned(digits, digit_chars));
+
+	char* out = buffer;
+	if (exponent >= -5 && exponent < MAX_FLOAT_DIGITS) {
+		if (exponent < 0) {
+			*(out++) = '0';
+			*(out++) = '.';
+			for (int i = -1; i > exponent; i--) {
+				*(out++) = '0';
+			}
+			memcpy(out, digit_chars, digit_count);
+			out += digit_count;
+		}
+		else if (digit_count <= exponent + 1) {
+			memcpy(out, digit_chars, digit_count);
+			out += digit_count;
+			for (int i = digit_count; i <= exponent; i++) {
+				*(out++) = '0';
+			}
+		}
+		else {
+			memcpy(out, digit_chars, exponent + 1);
+			out += exponent + 1;
+			*(out++) = '.';
+			memcpy(out, digit_chars + exponent + 1, digit_count - exponent - 1);
+			out += digit_count - exponent - 1;
+		}
+	}
+	else {
+		*(out++) = digit_chars[0];
+		if (digit_count > 1) {
+			*(out++) = '.';
+			memcpy(out, digit_chars + 1, digit_count - 1);
+			out += digit_count - 1;
+		}
+		*(out++) = 'e';
+		if (exponent < 0) {
+			*(out++) = '-';
+		}
+		out += write_unsigned(exponent < 0 ? -exponent : exponent, out);
+	}
+
+	return out - buffer;
+}
+
+size_t CyclesShaderEditor::format_float(float value, char* buffer)
+{
+	if (std::isnan(value)) {
+		memcpy(buffer, "nan", 3);
+		return 3;
+	}
+
+	char* out = buffer;
+	if (std::signbit(value)) {
+		*(out++) = '-';
+		value = -value;
+	}
+
+	if (std::isinf(value)) {
+		memcpy(out, "inf", 3);
+		return (out - buffer) + 3;
+	}
+
+	if (value == 0.0f) {
+		*(out++) = '0';
+		return out - buffer;
+	}
+
+	int exponent = static_cast<int>(std::floor(std::log10(static_cast<double>(value))));
+	if (exponent <= MAX_EXACT_POWER_OF_TEN && exponent >= -MAX_EXACT_POWER_OF_TEN) {
+		// log10 can be off by one next to a power of ten
+		const double leading = (exponent >= 0) ? value / POWERS_OF_TEN[exponent] : value * POWERS_OF_TEN[-exponent];
+		if (leading < 1.0) {
+			exponent--;
+		}
+		else if (leading >= 10.0) {
+			exponent++;
+		}
+	}
+
+	// Any decimal strictly between the midpoints to the neighboring floats reads back as this float
+	const float below = std::nextafter(value, 0.0f);
+	const float above = std::nextafter(value, std::numeric_limits<float>::infinity());
+	const double low = (static_cast<double>(value) + static_cast<double>(below)) / 2.0;
+	const double high = (static_cast<double>(value) + static_cast<double>(above)) / 2.0;
+
+	// Try more and more significant digits until the rounded value falls inside that interval
+	for (int precision = 1; precision <= MAX_FLOAT_DIGITS; precision++) {
+		const int scale = precision - 1 - exponent;
+		if (scale > MAX_EXACT_POWER_OF_TEN || scale < -MAX_EXACT_POWER_OF_TEN) {
+			break;
+		}
+
+		const double power = POWERS_OF_TEN[scale >= 0 ? scale : -scale];
+		const double scaled = (scale >= 0) ? value * power : value / power;
+		const double rounded = std::floor(scaled + 0.5);
+		const double scaled_low = (scale >= 0) ? low * power : low / power;
+		const double scaled_high = (scale >= 0) ? high * power : high / power;
+		if (rounded <= scaled_low || rounded >= scaled_high) {
+			continue;
+		}
+
+		std::uint64_t digits = static_cast<std::uint64_t>(rounded);
+		int digits_exponent = exponent;
+		if (digits >= static_cast<std::uint64_t>(POWERS_OF_TEN[precision])) {
+			// Rounded up to an extra digit, such as 9.99 becoming 10.0
+			digits /= 10;
+			digits_exponent++;
+		}
+		while (digits % 10 == 0) {
+			digits /= 10;
+		}
+
+		const size_t length = write_decimal(digits, digits_exponent, out);
+
+		// The scaled interval is only accurate to a few double roundings, results right next to its edges are confirmed by parsing
+		const double margin = std::min(rounded - scaled_low, scaled_high - rounded);
+		if (margin > scaled * 1e-12) {
+			return (out - buffer) + length;
+		}
+		float parsed = 0.0f;
+		if (parse_float(StringSlice(out, length), parsed) == NumberParseResult::Success && parsed == value) {
+			return (out - buffer) + length;
+		}
+	}
+
+	// Very large or small values can not be scaled exactly, let a classic locale stream generate the digits instead
+	std::string text;
+	for (int precision = 1; precision <= MAX_FLOAT_DIGITS; precision++) {
+		std::ostringstream stream;
+		stream.imbue(std::locale::classic());
+		stream.precision(precision);
+		stream << value;
+		text = stream.str();
+
+		float parsed = 0.0f;
+		if (parse_float(StringSlice(text), parsed) == NumberParseResult::Success && parsed == value) {
+			break;
+		}
+	}
+	memcpy(out, text.data(), text.size());
+	return (out - buffer) + text.size();
+}
+
+size_t CyclesShaderEditor::format_int(int value, char* buffer)
+{
+	if (value < 0) {
+		buffer[0] = '-';
+		// Negate as unsigned so the smallest int does not overflow
+		return 1 + write_unsigned(0ull - static_cast<std::uint64_t>(static_cast<long long>(value)), buffer + 1);
+	}
+	return write_unsigned(static_cast<std::uint64_t>(value), buffer);
+}
+
+void CyclesShaderEditor::append_float(std::string& out, float value)
+{
+	char buffer[MAX_FORMATTED_NUMBER_LENGTH];
+	out.append(buffer, format_float(value, buffer));
+}
+
+void CyclesShaderEditor::append_int(std::string& out, int value)
+{
+	char buffer[MAX_FORMATTED_NUMBER_LENGTH];
+	out.append(buffer, format_int(value, buffer));
+}
\ No newline at end of file
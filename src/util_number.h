@@ -0,0 +1,37 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+
+#include "util_tokenizer.h"
+
+namespace CyclesShaderEditor {
+
+	enum class NumberParseResult {
+		Success,
+		// The text was empty
+		Empty,
+		// The text was not a number, or had characters after the number
+		Invalid,
+		// The number does not fit in the result type, the result is set to the nearest value that does
+		OutOfRange,
+	};
+
+	// Number parsing and formatting for serialized graphs
+	// These never throw and never look at the current locale, so '.' is always the decimal separator
+	// The whole text must be a number, leading or trailing characters make it invalid
+	NumberParseResult parse_float(StringSlice text, float& result);
+	NumberParseResult parse_int(StringSlice text, int& result);
+
+	// Largest number of characters written by format_float or format_int
+	constexpr size_t MAX_FORMATTED_NUMBER_LENGTH = 16;
+
+	// Writes the shortest text that parses back to exactly the same float, returns the number of characters written
+	// No terminator is written
+	size_t format_float(float value, char* buffer);
+	size_t format_int(int value, char* buffer);
+
+	void append_float(std::string& out, float value);
+	void append_int(std::string& out, int value);
+
+}
\ No newline at end of file
@@ -1,8 +1,15 @@
 #include "util_platform.h"
 
+#include <climits>
+
 #ifdef _WIN32
 #include <Windows.h>
+#include <io.h>
 #else
+#include <cerrno>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 #include <unistd.h>
 #endif
 
@@ -23,3 +30,153 @@ void CyclesShaderEditor::thread_usleep(int us)
 	usleep(us);
 #endif
 }
+
+size_t CyclesShaderEditor::read_file_descriptor(const int fd, char* const buffer, const size_t size)
+{
+#ifdef _WIN32
+	const unsigned int read_size = (size > INT_MAX) ? INT_MAX : static_cast<unsigned int>(size);
+	const int result = _read(fd, buffer, read_size);
+	return (result > 0) ? static_cast<size_t>(result) : 0;
+#else
+	const size_t read_size = (size > SSIZE_MAX) ? SSIZE_MAX : size;
+	while (true) {
+		const ssize_t result = read(fd, buffer, read_size);
+		if (result >= 0) {
+			return static_cast<size_t>(result);
+		}
+		if (errno != EINTR) {
+			return 0;
+		}
+	}
+#endif
+}
+
+FILE* CyclesShaderEditor::open_file_for_write(const PathString& path)
+{
+#ifdef _WIN32
+	return _wfopen(path.c_str(), L"wb");
+#else
+	return fopen(path.c_str(), "wb");
+#endif
+}
+
+bool CyclesShaderEditor::sync_file(FILE* const file)
+{
+	if (fflush(file) != 0) {
+		return false;
+	}
+#ifdef _WIN32
+	return _commit(_fileno(file)) == 0;
+#else
+	while (fsync(fileno(file)) != 0) {
+		if (errno != EINTR) {
+			return false;
+		}
+	}
+	return true;
+#endif
+}
+
+CyclesShaderEditor::MappedFile::MappedFile()
+{
+
+}
+
+CyclesShaderEditor::MappedFile::~MappedFile()
+{
+	close();
+}
+
+bool CyclesShaderEditor::MappedFile::open(const PathString& path)
+{
+	close();
+
+#ifdef _WIN32
+	HANDLE file = CreateFileW(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+	if (file == INVALID_HANDLE_VALUE) {
+		return false;
+	}
+
+	LARGE_INTEGER file_size;
+	if (GetFileSizeEx(file, &file_size) == 0 || file_size.QuadPart <= 0) {
+		CloseHandle(file);
+		return false;
+	}
+
+	HANDLE mapping = CreateFileMappingW(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	if (mapping == nullptr) {
+		CloseHandle(file);
+		return false;
+	}
+
+	const void* const view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+	if (view == nullptr) {
+		CloseHandle(mapping);
+		CloseHandle(file);
+		return false;
+	}
+
+	file_handle = file;
+	mapping_handle = mapping;
+	mapped_data = static_cast<const char*>(view);
+	mapped_size = static_cast<size_t>(file_size.QuadPart);
+#else
+	const int fd = ::open(path.c_str(), O_RDONLY);
+	if (fd < 0) {
+		return false;
+	}
+
+	struct stat file_stat;
+	if (fstat(fd, &file_stat) != 0 || file_stat.st_size <= 0) {
+		::close(fd);
+		return false;
+	}
+
+	void* const view = mmap(nullptr, static_cast<size_t>(file_stat.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+	// The mapping keeps its own reference to the file
+	::close(fd);
+	if (view == MAP_FAILED) {
+		return false;
+	}
+
+	mapped_data = static_cast<const char*>(view);
+	mapped_size = static_cast<size_t>(file_stat.st_size);
+#endif
+
+	return true;
+}
+
+void CyclesShaderEditor::MappedFile::close()
+{
+	if (mapped_data == nullptr) {
+		return;
+	}
+
+#ifdef _WIN32
+	UnmapViewOfFile(mapped_data);
+	CloseHandle(mapping_handle);
+	CloseHandle(file_handle);
+	mapping_handle = nullptr;
+	file_handle = nullptr;
+#else
+	munmap(const_cast<char*>(mapped_data), mapped_size);
+#endif
+
+	mapped_data = nullptr;
+	mapped_size = 0;
+}
+
+bool CyclesShaderEditor::MappedFile::is_open() const
+{
+	return mapped_data != nullptr;
+}
+
+const char* CyclesShaderEditor::MappedFile::data() const
+{
+	return mapped_data;
+}
+
+size_t CyclesShaderEditor::MappedFile::size() const
+{
+	return mapped_size;
+}
@@ -1,6 +1,8 @@
 // Platform-specific things go in this header
 #pragma once
 
+#include <cstddef>
+#include <cstdio>
 #include <string>
 
 namespace CyclesShaderEditor {
@@ -12,4 +14,39 @@ namespace CyclesShaderEditor {
 	PathString get_pathstring(const std::string& input);
 
 	void thread_usleep(int us);
+
+	// Reads up to size bytes from a file descriptor, retrying if interrupted
+	// Returns the number of bytes read, 0 at the end of the file or on error
+	size_t read_file_descriptor(int fd, char* buffer, size_t size);
+
+	// Opens a file for writing in binary mode, anything already in the file is thrown away
+	FILE* open_file_for_write(const PathString& path);
+
+	// Flushes a file's buffers and waits for the system to write its contents to disk
+	bool sync_file(FILE* file);
+
+	// Read-only mapping of a whole file into memory
+	class MappedFile {
+	public:
+		MappedFile();
+		~MappedFile();
+
+		MappedFile(const MappedFile&) = delete;
+		MappedFile& operator=(const MappedFile&) = delete;
+
+		bool open(const PathString& path);
+		void close();
+
+		bool is_open() const;
+		const char* data() const;
+		size_t size() const;
+
+	private:
+		const char* mapped_data = nullptr;
+		size_t mapped_size = 0;
+#ifdef _WIN32
+		void* file_handle = nullptr;
+		void* mapping_handle = nullptr;
+#endif
+	};
 }
@@ -0,0 +1,133 @@
+#include "util_tokenizer.h"
+
+#include <algorithm>
+#include <cstring>
+
+CyclesShaderEditor::StringSlice::StringSlice() :
+	begin(nullptr),
+	length(0)
+{
+
+}
+
+CyclesShaderEditor::StringSlice::StringSlice(const char* begin, size_t length) :
+	begin(begin),
+	length(length)
+{
+
+}
+
+CyclesShaderEditor::StringSlice::StringSlice(const std::string& str) :
+	begin(str.data()),
+	length(str.size())
+{
+
+}
+
+const char* CyclesShaderEditor::StringSlice::data() const
+{
+	return begin;
+}
+
+size_t CyclesShaderEditor::StringSlice::size() const
+{
+	return length;
+}
+
+bool CyclesShaderEditor::StringSlice::empty() const
+{
+	return length == 0;
+}
+
+std::string CyclesShaderEditor::StringSlice::to_string() const
+{
+	if (length == 0) {
+		return std::string();
+	}
+	return std::string(begin, length);
+}
+
+bool CyclesShaderEditor::StringSlice::operator==(const StringSlice& other) const
+{
+	if (length != other.length) {
+		return false;
+	}
+	return length == 0 || memcmp(begin, other.begin, length) == 0;
+}
+
+bool CyclesShaderEditor::StringSlice::operator==(const std::string& other) const
+{
+	return *this == StringSlice(other);
+}
+
+bool CyclesShaderEditor::StringSlice::operator==(const char* other) const
+{
+	return *this == StringSlice(other, strlen(other));
+}
+
+bool CyclesShaderEditor::StringSlice::operator!=(const StringSlice& other) const
+{
+	return !(*this == other);
+}
+
+bool CyclesShaderEditor::StringSlice::operator!=(const std::string& other) const
+{
+	return !(*this == other);
+}
+
+bool CyclesShaderEditor::StringSlice::operator!=(const char* other) const
+{
+	return !(*this == other);
+}
+
+bool CyclesShaderEditor::StringSlice::operator<(const StringSlice& other) const
+{
+	const size_t common_length = std::min(length, other.length);
+	if (common_length > 0) {
+		const int compare = memcmp(begin, other.begin, common_length);
+		if (compare != 0) {
+			return compare < 0;
+		}
+	}
+	return length < other.length;
+}
+
+CyclesShaderEditor::Tokenizer::Tokenizer(const char* begin, size_t length, char delim) :
+	pos(begin),
+	end(begin + length),
+	delim(delim),
+	done(length == 0)
+{
+
+}
+
+CyclesShaderEditor::Tokenizer::Tokenizer(StringSlice input, char delim) :
+	Tokenizer(input.data(), input.size(), delim)
+{
+
+}
+
+bool CyclesShaderEditor::Tokenizer::next(StringSlice& token)
+{
+	if (done) {
+		return false;
+	}
+
+	const char* const next_delim = static_cast<const char*>(memchr(pos, delim, end - pos));
+	if (next_delim == nullptr) {
+		token = StringSlice(pos, end - pos);
+		pos = end;
+		done = true;
+	}
+	else {
+		token = StringSlice(pos, next_delim - pos);
+		pos = next_delim + 1;
+	}
+
+	return true;
+}
+
+bool CyclesShaderEditor::Tokenizer::at_end() const
+{
+	return done;
+}
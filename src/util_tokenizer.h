@@ -0,0 +1,53 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+
+namespace CyclesShaderEditor {
+
+	// Non-owning view of a range of characters inside some other buffer
+	// The buffer must outlive every slice that points into it
+	class StringSlice {
+	public:
+		StringSlice();
+		StringSlice(const char* begin, size_t length);
+		explicit StringSlice(const std::string& str);
+
+		const char* data() const;
+		size_t size() const;
+		bool empty() const;
+
+		std::string to_string() const;
+
+		bool operator==(const StringSlice& other) const;
+		bool operator==(const std::string& other) const;
+		bool operator==(const char* other) const;
+		bool operator!=(const StringSlice& other) const;
+		bool operator!=(const std::string& other) const;
+		bool operator!=(const char* other) const;
+		bool operator<(const StringSlice& other) const;
+
+	private:
+		const char* begin;
+		size_t length;
+	};
+
+	// Splits a buffer on a single delimiter character in one forward pass
+	// Tokens are handed out as slices into the input buffer, nothing is copied
+	// Input ending with a delimiter produces a final empty token, the same as splitting "a|b|" into "a", "b", ""
+	class Tokenizer {
+	public:
+		Tokenizer(const char* begin, size_t length, char delim);
+		Tokenizer(StringSlice input, char delim);
+
+		bool next(StringSlice& token);
+		bool at_end() const;
+
+	private:
+		const char* pos;
+		const char* end;
+		char delim;
+		bool done;
+	};
+
+}
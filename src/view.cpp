@@ -1,5 +1,6 @@
 #include "view.h"
 
+#include <algorithm>
 #include <cassert>
 #include <cmath>
 #include <cstdio>
@@ -11,6 +12,28 @@
 static constexpr int GRID_SIZE_INT = 32;
 static constexpr float GRID_SIZE_FL = static_cast<float>(GRID_SIZE_INT);
 
+// Smallest world scale each level of node detail is used at, anything smaller is drawn as an outline
+static constexpr float FULL_DETAIL_MIN_SCALE = 0.6f;
+static constexpr float NO_VALUES_MIN_SCALE = 0.45f;
+static constexpr float TITLE_ONLY_MIN_SCALE = 0.3f;
+
+static CyclesShaderEditor::NodeDrawDetail get_node_draw_detail(const float world_scale)
+{
+	if (world_scale >= FULL_DETAIL_MIN_SCALE) {
+		return CyclesShaderEditor::NodeDrawDetail::Full;
+	}
+	else if (world_scale >= NO_VALUES_MIN_SCALE) {
+		return CyclesShaderEditor::NodeDrawDetail::NoValues;
+	}
+	else if (world_scale >= TITLE_ONLY_MIN_SCALE) {
+		return CyclesShaderEditor::NodeDrawDetail::TitleOnly;
+	}
+	return CyclesShaderEditor::NodeDrawDetail::Outline;
+}
+
+// World space distance things may be drawn outside their bounds, covers node borders, sockets and connection stroke widths
+static constexpr float CULL_MARGIN = 8.0f;
+
 CyclesShaderEditor::EditGraphView::EditGraphView(
 		std::list<EditorNode*>& nodes,
 		std::list<NodeConnection>& connections
@@ -23,7 +46,13 @@ CyclesShaderEditor::EditGraphView::EditGraphView(
 
 CyclesShaderEditor::EditorNode* CyclesShaderEditor::EditGraphView::get_node_under_mouse()
 {
-	for (EditorNode* this_node : nodes) {
+	node_index.find_nodes_at(indexed_mouse_position, hit_candidates);
+	// A node being moved counts as under the mouse wherever it is
+	if (moving_nodes.empty() == false) {
+		hit_candidates.insert(hit_candidates.end(), moving_nodes.begin(), moving_nodes.end());
+		node_index.sort_top_first(hit_candidates);
+	}
+	for (EditorNode* this_node : hit_candidates) {
 		if (this_node->is_mouse_over_node()) {
 			return this_node;
 		}
@@ -34,7 +63,8 @@ CyclesShaderEditor::EditorNode* CyclesShaderEditor::EditGraphView::get_node_unde
 
 CyclesShaderEditor::NodeSocket* CyclesShaderEditor::EditGraphView::get_socket_label_under_mouse()
 {
-	for (EditorNode* this_node : nodes) {
+	node_index.find_nodes_at(indexed_mouse_position, hit_candidates);
+	for (EditorNode* this_node : hit_candidates) {
 		NodeSocket* maybe_socket = this_node->get_socket_label_under_mouse();
 		if (maybe_socket != nullptr) {
 			return maybe_socket;
@@ -51,7 +81,8 @@ CyclesShaderEditor::NodeSocket* CyclesShaderEditor::EditGraphView::get_selected_
 
 CyclesShaderEditor::NodeSocket* CyclesShaderEditor::EditGraphView::get_socket_under_mouse()
 {
-	for (EditorNode* this_node : nodes) {
+	node_index.find_nodes_at(indexed_mouse_position, hit_candidates);
+	for (EditorNode* this_node : hit_candidates) {
 		NodeSocket* maybe_socket = this_node->get_socket_under_mouse();
 		if (maybe_socket != nullptr) {
 			return maybe_socket;
@@ -205,16 +236,32 @@ void CyclesShaderEditor::EditGraphView::draw(NVGcontext* draw_context)
 
 	nvgStroke(draw_context);
 
+	// Anything entirely outside this rectangle is not drawn
+	const Point2 view_low(border_left - CULL_MARGIN, border_top - CULL_MARGIN);
+	const Point2 view_high(border_right + CULL_MARGIN, border_bottom + CULL_MARGIN);
+
 	// Nodes
+	// The spatial index is brought up to date along the way, hit tests until the next frame use these positions
+	node_index.begin_sync();
+	indexed_mouse_position = mouse_world_position;
+	const NodeDrawDetail node_detail = get_node_draw_detail(zoom_scale);
 	std::list<EditorNode*>::reverse_iterator node_iterator;
 	for (node_iterator = nodes.rbegin(); node_iterator != nodes.rend(); ++node_iterator) {
 		CyclesShaderEditor::Point2 node_local_mouse_pos = mouse_world_position - (*node_iterator)->world_pos;
 		(*node_iterator)->set_mouse_position(node_local_mouse_pos);
+		const Point2 node_low = (*node_iterator)->world_pos;
+		const Point2 node_high = node_low + (*node_iterator)->get_dimensions();
+		node_index.place_node(*node_iterator, node_low - Point2(CULL_MARGIN, CULL_MARGIN), node_high + Point2(CULL_MARGIN, CULL_MARGIN));
+		if (do_rectangles_overlap(view_low, view_high, node_low, node_high) == false) {
+			(*node_iterator)->update_without_drawing();
+			continue;
+		}
 		nvgSave(draw_context);
 		nvgTranslate(draw_context, (*node_iterator)->world_pos.get_floor_pos_x(), (*node_iterator)->world_pos.get_floor_pos_y());
-		(*node_iterator)->draw_node(draw_context);
+		(*node_iterator)->draw_node(draw_context, node_detail);
 		nvgRestore(draw_context);
 	}
+	node_index.end_sync();
 
 	// Box selection indicator
 	if (box_select_active) {
@@ -242,6 +289,13 @@ void CyclesShaderEditor::EditGraphView::draw(NVGcontext* draw_context)
 		float dest_x = this_connection.end_socket->world_draw_position.get_pos_x();
 		float dest_y = this_connection.end_socket->world_draw_position.get_pos_y();
 
+		// The control points lie between the two ends, so the curve stays inside the rectangle they make
+		const Point2 curve_low(std::min(source_x, dest_x), std::min(source_y, dest_y));
+		const Point2 curve_high(std::max(source_x, dest_x), std::max(source_y, dest_y));
+		if (do_rectangles_overlap(view_low, view_high, curve_low, curve_high) == false) {
+			continue;
+		}
+
 		float mid_x = source_x + (dest_x - source_x) / 2;
 
 		nvgBeginPath(draw_context);
@@ -280,6 +334,7 @@ void CyclesShaderEditor::EditGraphView::add_node_at_mouse(EditorNode* node)
 
 	node->world_pos = mouse_world_position;
 	nodes.push_front(node);
+	node_index.place_node(node, node->world_pos - Point2(CULL_MARGIN, CULL_MARGIN), node->world_pos + node->get_dimensions() + Point2(CULL_MARGIN, CULL_MARGIN));
 	selected_nodes.clear();
 	selected_nodes.insert(node);
 }
@@ -376,6 +431,35 @@ void CyclesShaderEditor::EditGraphView::clear_node_selection()
 	selected_nodes.clear();
 }
 
+void CyclesShaderEditor::EditGraphView::forget_nodes(const std::vector<const EditorNode*>& removed_nodes)
+{
+	if (removed_nodes.empty()) {
+		return;
+	}
+	for (const EditorNode* const node : removed_nodes) {
+		selected_nodes.erase(const_cast<EditorNode*>(node));
+		node_index.remove_node(node);
+		moving_nodes.erase(std::remove(moving_nodes.begin(), moving_nodes.end(), node), moving_nodes.end());
+	}
+
+	// A deleted socket can not be asked for its parent, so sockets are kept only if a node that is still here has them
+	if (selected_label == nullptr && connection_in_progress_start == nullptr) {
+		return;
+	}
+	bool label_found = false;
+	bool connection_start_found = false;
+	for (EditorNode* const node : nodes) {
+		label_found = label_found || node->has_socket(selected_label);
+		connection_start_found = connection_start_found || node->has_socket(connection_in_progress_start);
+	}
+	if (label_found == false) {
+		selected_label = nullptr;
+	}
+	if (connection_start_found == false) {
+		connection_in_progress_start = nullptr;
+	}
+}
+
 void CyclesShaderEditor::EditGraphView::delete_selected_nodes()
 {
 	if (selected_nodes.empty()) {
@@ -415,6 +499,8 @@ void CyclesShaderEditor::EditGraphView::delete_node(EditorNode* const node)
 			}
 			// Finally erase node
 			nodes.erase(iter);
+			node_index.remove_node(this_node);
+			moving_nodes.erase(std::remove(moving_nodes.begin(), moving_nodes.end(), this_node), moving_nodes.end());
 			delete this_node;
 			return;
 		}
@@ -426,6 +512,7 @@ void CyclesShaderEditor::EditGraphView::node_move_begin()
 	for (EditorNode* this_node : selected_nodes) {
 		this_node->move_begin();
 	}
+	moving_nodes.assign(selected_nodes.begin(), selected_nodes.end());
 }
 
 void CyclesShaderEditor::EditGraphView::node_move_end()
@@ -433,6 +520,7 @@ void CyclesShaderEditor::EditGraphView::node_move_end()
 	for (EditorNode* this_node : nodes) {
 		this_node->move_end();
 	}
+	moving_nodes.clear();
 }
 
 void CyclesShaderEditor::EditGraphView::move_left()
@@ -554,6 +642,7 @@ void CyclesShaderEditor::EditGraphView::raise_node(EditorNode* node, SelectMode
 		if (this_node == node) {
 			nodes.remove(this_node);
 			nodes.push_front(this_node);
+			node_index.raise_node(this_node);
 
 			if (mode == SelectMode::EXCLUSIVE) {
 				selected_nodes.clear();
@@ -615,7 +704,9 @@ std::set<CyclesShaderEditor::EditorNode*> CyclesShaderEditor::EditGraphView::get
 	CyclesShaderEditor::Point2 min_position(min_x_pos, min_y_pos);
 	CyclesShaderEditor::Point2 max_position(max_x_pos, max_y_pos);
 
-	for (EditorNode* this_node : nodes) {
+	// The index only narrows down the nodes to check, the check itself uses each node's current bounds
+	node_index.find_nodes_in(min_position, max_position, hit_candidates);
+	for (EditorNode* this_node : hit_candidates) {
 		if (do_rectangles_overlap(min_position, max_position, this_node->world_pos, this_node->world_pos + this_node->get_dimensions())) {
 			result.insert(this_node);
 		}
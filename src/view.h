@@ -2,8 +2,10 @@
 
 #include <list>
 #include <set>
+#include <vector>
 
 #include "node_base.h"
+#include "node_index.h"
 #include "point2.h"
 #include "zoom.h"
 
@@ -45,6 +47,9 @@ namespace CyclesShaderEditor {
 		void complete_connection_at_mouse();
 		void clear_input_socket_under_mouse();
 		void clear_node_selection();
+		// Lets go of nodes that were deleted from outside the view, along with any of their sockets it was using
+		// The pointers are only compared, never followed
+		void forget_nodes(const std::vector<const EditorNode*>& removed_nodes);
 
 		void delete_selected_nodes();
 		void delete_node(EditorNode* const node);
@@ -93,6 +98,13 @@ namespace CyclesShaderEditor {
 
 		Point2 mouse_world_position;
 
+		// Node bounds as of the last frame drawn, along with the mouse position the nodes were given then
+		NodeSpatialIndex node_index;
+		Point2 indexed_mouse_position;
+		std::vector<EditorNode*> moving_nodes;
+		// Reused by hit tests
+		std::vector<EditorNode*> hit_candidates;
+
 		bool mouse_move_active = false;
 
 		ZoomManager zoom;